@@ -0,0 +1,63 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+// Page checksums of a PgRead buffer: the former one-page-at-a-time loop
+// against the page-vector and the parallel variants.
+//
+// Usage: bench_crc [buffer MiB] [iterations]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "XrdOuc/XrdOucCRC.hh"
+#include "XrdSys/XrdSysPageSize.hh"
+
+#include "HttpPageChecksum.hh"
+
+namespace {
+
+void PerPage(uint64_t, const void* data, size_t length, uint32_t* cksums) {
+  const char* input = static_cast<const char*>(data);
+  for (size_t done = 0; done < length; done += XrdSys::PageSize) {
+    const size_t size = std::min<size_t>(XrdSys::PageSize, length - done);
+    *cksums++ = XrdOucCRC::Calc32C(input + done, size);
+  }
+}
+
+template <typename F>
+void Run(const char* name, F checksums, const std::vector<char>& data,
+         std::vector<uint32_t>& cksums, int iterations) {
+  checksums(0, data.data(), data.size(), cksums.data());
+
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    checksums(0, data.data(), data.size(), cksums.data());
+  }
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  printf("%-10s %8.1f MiB/s  crc[0]=%08x\n", name,
+         double(data.size()) * iterations / (1024 * 1024) / elapsed.count(),
+         cksums[0]);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t mib = argc > 1 ? strtoul(argv[1], nullptr, 10) : 64;
+  const int iterations = argc > 2 ? atoi(argv[2]) : 20;
+
+  std::vector<char> data(mib * 1024 * 1024);
+  for (size_t i = 0; i < data.size(); ++i) data[i] = char(i * 2654435761U >> 13);
+  std::vector<uint32_t> cksums(XrdCl::PageCount(0, data.size()));
+
+  printf("%zu MiB, %d iterations\n", mib, iterations);
+  Run("per-page", PerPage, data, cksums, iterations);
+  Run("vector", XrdCl::PageChecksums, data, cksums, iterations);
+  Run("parallel", XrdCl::ParallelPageChecksums, data, cksums, iterations);
+  return 0;
+}
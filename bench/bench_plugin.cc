@@ -0,0 +1,447 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+// End-to-end workloads driving HttpFilePlugIn and HttpFileSystemPlugIn
+// against a server laid out by run_bench.sh under <url>:
+//
+//   large         256 MiB, for the read, vector read and PgRead workloads
+//   small/NNN     1000 files of 4 KiB
+//   listing/NNNNN 100000 empty files
+//   upload/       writable
+//
+// PgReads go to https-url when given. Offsets and chunk lists come from a
+// fixed seed, so that runs are comparable. One JSON report goes to stdout,
+// with per workload operations, bytes, rates, latency percentiles and the
+// CPU time of the whole process per byte and per operation.
+//
+// Usage: bench_plugin <url> [https-url] [workload...]
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "XrdCl/XrdClURL.hh"
+#include "XrdCl/XrdClXRootDResponses.hh"
+
+#include "HttpFilePlugIn.hh"
+#include "HttpFileSystemPlugIn.hh"
+
+using namespace XrdCl;
+
+namespace {
+
+const uint16_t kTimeout = 60;
+const uint64_t kSeed = 42;
+
+using Clock = std::chrono::steady_clock;
+
+// Blocks until the final response of an asynchronous call
+class Waiter : public ResponseHandler {
+ public:
+  ~Waiter() { delete response_; }
+
+  void HandleResponse(XRootDStatus* status, AnyObject* response) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    status_ = *status;
+    delete status;
+    delete response_;
+    response_ = response;
+    // Chunked listings answer several times
+    if (status_.code != suContinue) {
+      done_ = true;
+      cond_.notify_all();
+    }
+  }
+
+  XRootDStatus Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this] { return done_; });
+    return status_;
+  }
+
+  template <typename T>
+  T* Get() {
+    T* value = nullptr;
+    if (response_) response_->Get(value);
+    return value;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  bool done_ = false;
+  XRootDStatus status_;
+  AnyObject* response_ = nullptr;
+};
+
+// Issues a call and waits for its answer, giving up on the run on failure
+void Call(const char* what, Waiter& waiter,
+          const std::function<XRootDStatus(ResponseHandler*)>& call) {
+  auto status = call(&waiter);
+  if (status.IsOK()) status = waiter.Wait();
+  if (status.IsError()) {
+    fprintf(stderr, "%s failed: %s\n", what, status.ToStr().c_str());
+    exit(1);
+  }
+}
+
+class Recorder {
+ public:
+  // Times one operation, which returns the bytes it transferred
+  void Time(const std::function<uint64_t()>& operation) {
+    const auto start = Clock::now();
+    const uint64_t bytes = operation();
+    const std::chrono::duration<double, std::milli> elapsed =
+        Clock::now() - start;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    latencies_.push_back(elapsed.count());
+    bytes_ += bytes;
+  }
+
+  std::vector<double> Latencies() const { return latencies_; }
+  uint64_t Bytes() const { return bytes_; }
+
+ private:
+  std::mutex mutex_;
+  std::vector<double> latencies_;
+  uint64_t bytes_ = 0;
+};
+
+double CpuSeconds() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+         (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+double Percentile(const std::vector<double>& sorted, double fraction) {
+  if (sorted.empty()) return 0;
+  return sorted[std::min<size_t>(sorted.size() - 1,
+                                 size_t(sorted.size() * fraction))];
+}
+
+struct Workload {
+  std::string name;
+  std::function<void(Recorder&)> run;
+};
+
+bool first_result = true;
+
+void Measure(const Workload& workload) {
+  fprintf(stderr, "Running %s\n", workload.name.c_str());
+  Recorder recorder;
+  const double cpu_start = CpuSeconds();
+  const auto start = Clock::now();
+  workload.run(recorder);
+  const std::chrono::duration<double> elapsed = Clock::now() - start;
+  const double cpu = CpuSeconds() - cpu_start;
+
+  auto latencies = recorder.Latencies();
+  std::sort(latencies.begin(), latencies.end());
+  const double ops = latencies.size();
+  const double bytes = recorder.Bytes();
+  const double seconds = elapsed.count();
+
+  printf("%s\n    {\"name\": \"%s\", \"ops\": %.0f, \"bytes\": %.0f, "
+         "\"seconds\": %.6f, \"ops_per_s\": %.3f, \"mb_per_s\": %.3f, "
+         "\"p50_ms\": %.3f, \"p99_ms\": %.3f, \"cpu_seconds\": %.6f, "
+         "\"cpu_ns_per_byte\": %.3f, \"cpu_us_per_op\": %.3f}",
+         first_result ? "" : ",", workload.name.c_str(), ops, bytes, seconds,
+         ops / seconds, bytes / seconds / 1e6, Percentile(latencies, 0.5),
+         Percentile(latencies, 0.99), cpu, bytes ? cpu * 1e9 / bytes : 0.0,
+         ops ? cpu * 1e6 / ops : 0.0);
+  fflush(stdout);
+  first_result = false;
+}
+
+//------------------------------------------------------------------------------
+// Workloads
+//------------------------------------------------------------------------------
+
+uint64_t Open(HttpFilePlugIn& file, const std::string& url,
+              OpenFlags::Flags flags) {
+  Waiter opened;
+  Call("Open", opened, [&](ResponseHandler* handler) {
+    return file.Open(url, flags, Access::None, handler, kTimeout);
+  });
+  if (flags & OpenFlags::Write) return 0;
+
+  Waiter stated;
+  Call("Stat", stated, [&](ResponseHandler* handler) {
+    return file.Stat(false, handler, kTimeout);
+  });
+  return stated.Get<StatInfo>()->GetSize();
+}
+
+void Close(HttpFilePlugIn& file) {
+  Waiter closed;
+  Call("Close", closed, [&](ResponseHandler* handler) {
+    return file.Close(handler, kTimeout);
+  });
+}
+
+uint64_t Read(HttpFilePlugIn& file, uint64_t offset, uint32_t size,
+              char* buffer) {
+  Waiter read;
+  Call("Read", read, [&](ResponseHandler* handler) {
+    return file.Read(offset, size, buffer, handler, kTimeout);
+  });
+  return read.Get<ChunkInfo>()->length;
+}
+
+Workload SequentialRead(const std::string& url, uint32_t size,
+                        const std::string& name) {
+  return {name, [url, size](Recorder& recorder) {
+            HttpFilePlugIn file;
+            const uint64_t file_size = Open(file, url, OpenFlags::Read);
+            std::vector<char> buffer(size);
+            for (uint64_t offset = 0; offset < file_size; offset += size) {
+              recorder.Time([&] {
+                return Read(file, offset, size, buffer.data());
+              });
+            }
+            Close(file);
+          }};
+}
+
+Workload RandomRead(const std::string& url, uint32_t size, int count,
+                    const std::string& name) {
+  return {name, [url, size, count](Recorder& recorder) {
+            HttpFilePlugIn file;
+            const uint64_t file_size = Open(file, url, OpenFlags::Read);
+            std::mt19937_64 random(kSeed);
+            std::uniform_int_distribution<uint64_t> pages(
+                0, (file_size - size) / 4096);
+            std::vector<char> buffer(size);
+            for (int i = 0; i < count; ++i) {
+              const uint64_t offset = pages(random) * 4096;
+              recorder.Time([&] {
+                return Read(file, offset, size, buffer.data());
+              });
+            }
+            Close(file);
+          }};
+}
+
+// What a ROOT TTreeCache asks for when filling: the baskets of the read
+// branches over one cluster, from a few hundred bytes to some tens of KiB,
+// with the baskets of the other branches in between
+ChunkList ClusterChunks(std::mt19937_64& random, uint64_t* cluster,
+                        uint64_t file_size) {
+  std::uniform_int_distribution<uint32_t> lengths(512, 48 * 1024);
+  std::uniform_int_distribution<uint64_t> gaps(0, 64 * 1024);
+  ChunkList chunks;
+  uint64_t offset = *cluster;
+  while (chunks.size() < 200) {
+    offset += gaps(random);
+    const uint32_t length = lengths(random);
+    if (offset + length > file_size) {
+      offset = 0;
+      continue;
+    }
+    chunks.emplace_back(offset, length, nullptr);
+    offset += length;
+  }
+  *cluster = offset;
+  return chunks;
+}
+
+Workload VectorRead(const std::string& url, int count) {
+  return {"vector_read_root", [url, count](Recorder& recorder) {
+            HttpFilePlugIn file;
+            const uint64_t file_size = Open(file, url, OpenFlags::Read);
+            std::mt19937_64 random(kSeed);
+            uint64_t cluster = 0;
+            std::vector<char> buffer;
+            for (int i = 0; i < count; ++i) {
+              const auto chunks = ClusterChunks(random, &cluster, file_size);
+              uint64_t packed = 0;
+              for (const auto& chunk : chunks) packed += chunk.length;
+              buffer.resize(packed);
+              recorder.Time([&] {
+                Waiter read;
+                Call("VectorRead", read, [&](ResponseHandler* handler) {
+                  return file.VectorRead(chunks, buffer.data(), handler,
+                                         kTimeout);
+                });
+                return read.Get<VectorReadInfo>()->GetSize();
+              });
+            }
+            Close(file);
+          }};
+}
+
+Workload PgRead(const std::string& url, uint32_t size,
+                const std::string& name) {
+  return {name, [url, size](Recorder& recorder) {
+            HttpFilePlugIn file;
+            const uint64_t file_size = Open(file, url, OpenFlags::Read);
+            std::vector<char> buffer(size);
+            for (uint64_t offset = 0; offset < file_size; offset += size) {
+              recorder.Time([&] {
+                Waiter read;
+                Call("PgRead", read, [&](ResponseHandler* handler) {
+                  return file.PgRead(offset, size, buffer.data(), handler,
+                                     kTimeout);
+                });
+                return uint64_t(read.Get<PageInfo>()->GetLength());
+              });
+            }
+            Close(file);
+          }};
+}
+
+// Open, read and close, as jobs going through many small files do
+Workload SmallFiles(const std::string& url, int count) {
+  return {"small_files", [url, count](Recorder& recorder) {
+            char buffer[4096];
+            for (int i = 0; i < count; ++i) {
+              char name[16];
+              snprintf(name, sizeof(name), "/small/%03d", i);
+              recorder.Time([&] {
+                HttpFilePlugIn file;
+                Open(file, url + name, OpenFlags::Read);
+                const uint64_t bytes = Read(file, 0, sizeof(buffer), buffer);
+                Close(file);
+                return bytes;
+              });
+            }
+          }};
+}
+
+// Many clients stat-ing distinct files at once, none of them cached yet
+Workload StatStorm(const std::string& url, int threads, int per_thread) {
+  return {"stat_storm", [url, threads, per_thread](Recorder& recorder) {
+            const URL base(url);
+            HttpFileSystemPlugIn fs(url);
+            std::vector<std::thread> clients;
+            for (int t = 0; t < threads; ++t) {
+              clients.emplace_back([&, t] {
+                for (int i = 0; i < per_thread; ++i) {
+                  char name[16];
+                  snprintf(name, sizeof(name), "/listing/%05d",
+                           t * per_thread + i);
+                  recorder.Time([&] {
+                    Waiter stated;
+                    Call("Stat", stated, [&](ResponseHandler* handler) {
+                      return fs.Stat(base.GetPath() + name, handler,
+                                     kTimeout);
+                    });
+                    return uint64_t(0);
+                  });
+                }
+              });
+            }
+            for (auto& client : clients) client.join();
+          }};
+}
+
+Workload Upload(const std::string& url, uint64_t size, uint32_t write_size) {
+  return {"upload", [url, size, write_size](Recorder& recorder) {
+            const std::string name =
+                "/upload/bench-" + std::to_string(getpid());
+            HttpFilePlugIn file;
+            Open(file, url + name + "?oss.asize=" + std::to_string(size),
+                 OpenFlags::Delete | OpenFlags::Write);
+            std::vector<char> buffer(write_size);
+            std::mt19937_64 random(kSeed);
+            for (auto& byte : buffer) byte = char(random());
+            for (uint64_t offset = 0; offset < size; offset += write_size) {
+              const uint32_t length =
+                  std::min<uint64_t>(write_size, size - offset);
+              recorder.Time([&] {
+                Waiter written;
+                Call("Write", written, [&](ResponseHandler* handler) {
+                  return file.Write(offset, length, buffer.data(), handler,
+                                    kTimeout);
+                });
+                return uint64_t(length);
+              });
+            }
+            Close(file);
+
+            HttpFileSystemPlugIn fs(url);
+            Waiter removed;
+            Call("Rm", removed, [&](ResponseHandler* handler) {
+              return fs.Rm(URL(url).GetPath() + name, handler, kTimeout);
+            });
+          }};
+}
+
+Workload List(const std::string& url, int count) {
+  return {"list_100k", [url, count](Recorder& recorder) {
+            HttpFileSystemPlugIn fs(url);
+            const std::string path = URL(url).GetPath() + "/listing";
+            for (int i = 0; i < count; ++i) {
+              recorder.Time([&] {
+                Waiter listed;
+                Call("DirList", listed, [&](ResponseHandler* handler) {
+                  return fs.DirList(path, DirListFlags::Stat, handler,
+                                    kTimeout);
+                });
+                return uint64_t(0);
+              });
+            }
+          }};
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s <url> [https-url] [workload...]\n", argv[0]);
+    return 2;
+  }
+  std::string url = argv[1];
+  while (url.size() > 1 && url.back() == '/') url.pop_back();
+  int next_arg = 2;
+  std::string https_url = url;
+  if (argc > 2 && std::string(argv[2]).compare(0, 8, "https://") == 0) {
+    https_url = argv[next_arg++];
+    while (https_url.size() > 1 && https_url.back() == '/')
+      https_url.pop_back();
+  }
+  const std::vector<std::string> selected(argv + next_arg, argv + argc);
+
+  const std::string large = url + "/large";
+  const std::vector<Workload> workloads = {
+      SequentialRead(large, 64 * 1024, "seq_read_64k"),
+      SequentialRead(large, 1024 * 1024, "seq_read_1m"),
+      SequentialRead(large, 8 * 1024 * 1024, "seq_read_8m"),
+      RandomRead(large, 4 * 1024, 2000, "random_read_4k"),
+      RandomRead(large, 64 * 1024, 2000, "random_read_64k"),
+      RandomRead(large, 1024 * 1024, 200, "random_read_1m"),
+      VectorRead(large, 200),
+      PgRead(https_url + "/large", 4 * 1024 * 1024,
+             https_url == url ? "pgread_4m" : "pgread_https_4m"),
+      SmallFiles(url, 1000),
+      StatStorm(url, 16, 2000),
+      Upload(url, 512ULL * 1024 * 1024, 8 * 1024 * 1024),
+      List(url, 3),
+  };
+
+  printf("{\"url\": \"%s\", \"https_url\": \"%s\", \"results\": [",
+         url.c_str(), https_url.c_str());
+  for (const auto& workload : workloads) {
+    if (!selected.empty() &&
+        std::find(selected.begin(), selected.end(), workload.name) ==
+            selected.end())
+      continue;
+    Measure(workload);
+  }
+  printf("\n]}\n");
+  return 0;
+}
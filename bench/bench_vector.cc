@@ -0,0 +1,178 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+// Delivery of VectorRead answers into the chunk buffers: the former path,
+// each merged range landing in a scratch buffer and then copied out to its
+// chunks, against HttpRangeReader writing the response straight into the
+// chunks. The multipart answers are synthesized in memory.
+//
+// Usage: bench_vector [chunks] [iterations]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "HttpRangeReader.hh"
+#include "HttpVectorPlanner.hh"
+
+using namespace XrdCl;
+
+namespace {
+
+const char kBoundary[] = "3d6b6a416f9b5";
+
+struct Answer {
+  std::string body;
+  size_t position = 0;
+
+  int64_t Read(char* buffer, uint64_t size) {
+    size = std::min<uint64_t>(size, body.size() - position);
+    std::memcpy(buffer, body.data() + position, size);
+    position += size;
+    return size;
+  }
+};
+
+// What a server sends for one planned request
+std::string Multipart(const std::vector<char>& object,
+                      const HttpVectorPlanner::Batch& batch) {
+  std::string body;
+  for (const auto& range : batch) {
+    body += "\r\n--" + std::string(kBoundary) +
+            "\r\nContent-Type: application/octet-stream\r\n"
+            "Content-Range: bytes " + std::to_string(range.offset) + "-" +
+            std::to_string(range.offset + range.length - 1) + "/" +
+            std::to_string(object.size()) + "\r\n\r\n";
+    body.append(object.data() + range.offset, range.length);
+  }
+  return body + "\r\n--" + kBoundary + "--\r\n";
+}
+
+// The former delivery: the answer read into one scratch buffer per merged
+// range, then copied into the chunks
+uint64_t Scratch(const ChunkList& chunks,
+                 const HttpVectorPlanner::Batch& batch, Answer& answer) {
+  uint64_t copied = 0;
+  for (const auto& range : batch) {
+    // Part headers, up to the empty line following the Content-Range
+    std::string line;
+    bool ranged = false;
+    while (!ranged || line != "\r") {
+      line.clear();
+      char c;
+      while (answer.Read(&c, 1) == 1 && c != '\n') line.push_back(c);
+      ranged |= line.compare(0, 14, "Content-Range:") == 0;
+    }
+
+    // A range of exactly one chunk was read in place
+    const auto& first = chunks[range.chunks.front()];
+    if (range.chunks.size() == 1 && first.offset == range.offset &&
+        first.length == range.length) {
+      answer.Read(static_cast<char*>(first.buffer), range.length);
+      continue;
+    }
+
+    std::vector<char> scratch(range.length);
+    answer.Read(scratch.data(), range.length);
+    for (auto index : range.chunks) {
+      const auto& chunk = chunks[index];
+      std::memcpy(chunk.buffer, scratch.data() + (chunk.offset - range.offset),
+                  chunk.length);
+      copied += chunk.length;
+    }
+  }
+  return copied;
+}
+
+uint64_t Direct(const ChunkList& chunks, const HttpVectorPlanner::Batch& batch,
+                Answer& answer) {
+  ChunkList targets;
+  for (const auto& range : batch) {
+    for (auto index : range.chunks) targets.push_back(chunks[index]);
+  }
+  HttpRangeReader reader(targets);
+  auto status = reader.ReadMultipart(
+      kBoundary,
+      [&answer](char* buffer, uint64_t size) {
+        return answer.Read(buffer, size);
+      });
+  if (status.IsError() || !reader.Complete()) {
+    fprintf(stderr, "Delivery failed: %s\n", status.ToStr().c_str());
+    exit(1);
+  }
+  return reader.BytesCopied();
+}
+
+bool Verify(const std::vector<char>& object, const ChunkList& chunks) {
+  for (const auto& chunk : chunks) {
+    if (std::memcmp(chunk.buffer, object.data() + chunk.offset, chunk.length))
+      return false;
+  }
+  return true;
+}
+
+template <typename F>
+void Run(const char* name, F deliver, const std::vector<char>& object,
+         const ChunkList& chunks,
+         const std::vector<HttpVectorPlanner::Batch>& batches,
+         const std::vector<std::string>& answers, int iterations) {
+  uint64_t requested = 0;
+  for (const auto& chunk : chunks) requested += chunk.length;
+
+  uint64_t copied = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    for (size_t b = 0; b < batches.size(); ++b) {
+      Answer answer;
+      answer.body = answers[b];
+      copied += deliver(chunks, batches[b], answer);
+    }
+  }
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  printf("%-8s copied/read=%.3f %8.1f MiB/s %s\n", name,
+         double(copied) / (double(requested) * iterations),
+         double(requested) * iterations / (1024 * 1024) / elapsed.count(),
+         Verify(object, chunks) ? "ok" : "MISMATCH");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t num_chunks = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1024;
+  const int iterations = argc > 2 ? atoi(argv[2]) : 20;
+
+  std::mt19937_64 random(42);
+  std::vector<char> object(256 * 1024 * 1024);
+  for (size_t i = 0; i < object.size(); ++i) object[i] = char(random());
+
+  // Clustered chunks, as from a columnar file, with a few overlaps
+  std::vector<std::vector<char>> buffers;
+  ChunkList chunks;
+  uint64_t offset = 0;
+  for (size_t i = 0; i < num_chunks; ++i) {
+    const uint32_t length = 1024 + random() % (64 * 1024);
+    offset += random() % 4 ? random() % (32 * 1024) : random() % (1 << 20);
+    if (random() % 16 == 0 && offset > length) offset -= length / 2;
+    if (offset + length > object.size()) break;
+    buffers.emplace_back(length);
+    chunks.emplace_back(offset, length, buffers.back().data());
+    offset += length;
+  }
+
+  const auto batches = HttpVectorPlanner::Instance().Plan(chunks);
+  std::vector<std::string> answers;
+  for (const auto& batch : batches) answers.push_back(Multipart(object, batch));
+
+  printf("%zu chunks, %zu requests, %d iterations\n", chunks.size(),
+         batches.size(), iterations);
+  Run("scratch", Scratch, object, chunks, batches, answers, iterations);
+  Run("direct", Direct, object, chunks, batches, answers, iterations);
+  return 0;
+}
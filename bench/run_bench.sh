@@ -0,0 +1,71 @@
+#!/bin/sh
+
+set -e
+
+# Runs the bench_plugin workloads against a local Caddy serving generated
+# files, over HTTP and HTTPS, and writes the JSON report to the given file
+# (standard output by default). The same seed, sizes and layout are used on
+# every run, so that reports of two builds can be compared.
+#
+# With TEST_SERVER_EXEC set, the in-tree test server is used instead, over
+# HTTP only, with the faults given in TEST_SERVER_OPTIONS, e.g.
+# "--latency 20 --bandwidth 100000000" for a WAN link.
+#
+# Usage: run_bench.sh <bench_plugin> [report] [workload...]
+
+CADDY_URL=http://ecsft.cern.ch:80/dist/cvmfs/builddeps/caddy-linux-amd64
+CADDY_SHA1=0f3d1ea280ec744805cd557f123ec0d785bb1da0
+
+SCRIPT_LOCATION=$(cd "$(dirname "$0")"; pwd)
+. ${SCRIPT_LOCATION}/../test/common.sh
+
+BENCH_PLUGIN=$1
+REPORT=${2:-/dev/stdout}
+[ $# -gt 2 ] && shift 2 || set --
+[ -x "$BENCH_PLUGIN" ] || die "Usage: run_bench.sh <bench_plugin> [report] [workload...]"
+
+# Download the caddy HTTP server, if needed
+CADDY_EXEC=/tmp/caddy
+if [ x"$TEST_SERVER_EXEC" = x"" ]; then
+    check_executable wget
+    check_executable openssl
+    if [ ! -f $CADDY_EXEC ] || [ x"$(file_sha1 $CADDY_EXEC)" != x"$CADDY_SHA1" ]; then
+        echo "Downloading: $CADDY_URL" >&2
+        wget -q -O $CADDY_EXEC $CADDY_URL
+        chmod +x $CADDY_EXEC
+    fi
+fi
+
+WORKSPACE=$(create_workspace)
+trap 'stop_caddy >&2; rm -rf $WORKSPACE' EXIT
+
+# The files the workloads expect, see bench_plugin.cc
+echo "Generating files in $WORKSPACE" >&2
+DATA=$WORKSPACE/www/bench
+mkdir -p $DATA/small $DATA/listing $DATA/upload
+head -c 268435456 /dev/urandom > $DATA/large
+for i in $(seq -f %03g 0 999); do
+    head -c 4096 /dev/urandom > $DATA/small/$i
+done
+(cd $DATA/listing && seq -f %05g 0 99999 | xargs touch)
+
+if [ x"$TEST_SERVER_EXEC" != x"" ]; then
+    start_caddy $WORKSPACE/www >&2
+    $BENCH_PLUGIN http://localhost:8080/bench "$@" > $REPORT
+    exit 0
+fi
+
+# A self-signed certificate, trusted through X509_CERT_DIR
+CERT_DIR=$WORKSPACE/certificates
+mkdir -p $CERT_DIR
+openssl req -x509 -newkey rsa:2048 -nodes -days 1 -subj /CN=localhost \
+    -addext subjectAltName=DNS:localhost \
+    -keyout $CERT_DIR/key.pem -out $CERT_DIR/cert.pem 2> /dev/null
+openssl rehash $CERT_DIR
+export X509_CERT_DIR=$CERT_DIR
+
+cp $SCRIPT_LOCATION/config/caddyfile $WORKSPACE/caddyfile
+sed -i -e "s:<<CERT_DIR>>:$CERT_DIR:g" $WORKSPACE/caddyfile
+start_caddy $WORKSPACE/www $WORKSPACE/caddyfile >&2
+
+$BENCH_PLUGIN http://localhost:8080/bench https://localhost:8443/bench "$@" > $REPORT
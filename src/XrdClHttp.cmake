@@ -1,14 +1,8 @@
-set(lib${PROJECT_NAME}_sources
-  XrdClHttp/HttpPlugInFactory.cc
-  XrdClHttp/HttpPlugInUtil.cc
-  XrdClHttp/HttpFilePlugIn.cc
-  XrdClHttp/HttpFileSystemPlugIn.cc
-  XrdClHttp/Posix.cc)
-
 set(PLUGIN_NAME "${PROJECT_NAME}-${PLUGIN_VERSION}")
 
-add_library(${PLUGIN_NAME} MODULE ${lib${PROJECT_NAME}_sources})
+add_library(${PLUGIN_NAME} MODULE $<TARGET_OBJECTS:${PROJECT_NAME}Objects>)
 
-target_link_libraries(${PLUGIN_NAME} ${Davix_LIBRARIES} ${XrdCl_LIBRARIES})
+target_link_libraries(${PLUGIN_NAME} ${Davix_LIBRARIES} ${XrdCl_LIBRARIES}
+                      ${CMAKE_THREAD_LIBS_INIT})
 
 install(TARGETS ${PLUGIN_NAME} LIBRARY DESTINATION ${CMAKE_INSTALL_LIBDIR})
@@ -0,0 +1,227 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#include "HttpBlockCache.hh"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+
+#include "HttpPlugInUtil.hh"
+
+namespace {
+
+const uint64_t kDefaultBlockSize = 256 * 1024;
+const uint64_t kDefaultTTL = 60;
+
+}  // namespace
+
+namespace XrdCl {
+
+HttpBlockCache& HttpBlockCache::Instance() {
+  static HttpBlockCache* cache = new HttpBlockCache(
+      GetEnvUInt(HTTP_PLUG_IN_CACHE_SIZE_ENV, 0),
+      std::max<uint64_t>(
+          4096, std::min<uint64_t>(GetEnvUInt(HTTP_PLUG_IN_CACHE_BLOCK_ENV,
+                                              kDefaultBlockSize),
+                                   UINT32_MAX)),
+      GetEnvUInt(HTTP_PLUG_IN_CACHE_TTL_ENV, kDefaultTTL));
+  return *cache;
+}
+
+HttpBlockCache::HttpBlockCache(uint64_t capacity, uint32_t block_size,
+                               time_t ttl)
+    : capacity_(capacity),
+      block_size_(block_size),
+      ttl_(ttl),
+      hits_(0),
+      misses_(0),
+      evictions_(0),
+      revalidations_(0),
+      invalidations_(0) {}
+
+HttpBlockCache::Shard& HttpBlockCache::ShardFor(const std::string& key) {
+  return shards_[std::hash<std::string>()(key) % kNumShards];
+}
+
+std::string HttpBlockCache::BlockKey(const std::string& object,
+                                     uint64_t index) {
+  return object + "#" + std::to_string(index);
+}
+
+std::string HttpBlockCache::UrlOf(const std::string& key) {
+  return key.substr(0, key.rfind(' '));
+}
+
+void HttpBlockCache::CountBlock(const std::string& url, bool added) {
+  auto& shard = ShardFor(url);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.objects.find(url);
+  if (it == shard.objects.end()) {
+    if (!added) return;
+    it = shard.objects.insert(std::make_pair(url, Object())).first;
+    it->second.validated = time(NULL);
+  }
+  if (added) {
+    ++it->second.blocks;
+  }
+  else if (--it->second.blocks == 0 && it->second.stale.empty()) {
+    shard.objects.erase(it);
+  }
+}
+
+std::string HttpBlockCache::ObjectKey(const std::string& url,
+                                      const std::string& validator) {
+  auto& shard = ShardFor(url);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.objects.find(url);
+  if (it != shard.objects.end() && it->second.stale.count(validator)) return "";
+  return url + " " + validator;
+}
+
+bool HttpBlockCache::NeedsRevalidation(const std::string& url) {
+  auto& shard = ShardFor(url);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.objects.find(url);
+  // Nothing cached in memory, the validator is the one read at open
+  if (it == shard.objects.end()) return false;
+
+  const time_t now = time(NULL);
+  if (now - it->second.validated < ttl_) return false;
+
+  // Claim this round so concurrent readers keep using the blocks meanwhile
+  it->second.validated = now;
+  return true;
+}
+
+void HttpBlockCache::Validated(const std::string& url,
+                               const std::string& validator, bool modified) {
+  ++revalidations_;
+  auto& shard = ShardFor(url);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.objects.find(url);
+  if (it == shard.objects.end()) {
+    if (!modified) return;
+    it = shard.objects.insert(std::make_pair(url, Object())).first;
+  }
+  it->second.validated = time(NULL);
+  if (modified) {
+    // Blocks under the old key are never looked up again and age out
+    it->second.stale.insert(validator);
+    ++invalidations_;
+  }
+}
+
+std::shared_ptr<const HttpBlockCache::Block> HttpBlockCache::Get(
+    const std::string& object, uint64_t index) {
+  const auto key = BlockKey(object, index);
+  auto& shard = ShardFor(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.blocks.find(key);
+  if (it == shard.blocks.end()) {
+    ++misses_;
+    return nullptr;
+  }
+  shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+  ++hits_;
+  return it->second->second;
+}
+
+void HttpBlockCache::Put(const std::string& object, uint64_t index,
+                         std::shared_ptr<const Block> block) {
+  const auto key = BlockKey(object, index);
+  auto& shard = ShardFor(key);
+  const uint64_t shard_capacity = capacity_ / kNumShards;
+  if (block->size() > shard_capacity) return;
+
+  const auto url = UrlOf(object);
+  CountBlock(url, true);
+
+  // Blocks are released after the lock is dropped
+  std::vector<std::shared_ptr<const Block>> evicted;
+  std::vector<std::string> evicted_keys;
+  bool replaced = false;
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.blocks.find(key);
+    if (it != shard.blocks.end()) {
+      shard.bytes -= it->second->second->size();
+      evicted.push_back(std::move(it->second->second));
+      shard.lru.erase(it->second);
+      shard.blocks.erase(it);
+      replaced = true;
+    }
+
+    shard.bytes += block->size();
+    shard.lru.emplace_front(key, std::move(block));
+    shard.blocks[key] = shard.lru.begin();
+
+    while (shard.bytes > shard_capacity) {
+      auto& victim = shard.lru.back();
+      shard.bytes -= victim.second->size();
+      evicted.push_back(std::move(victim.second));
+      shard.blocks.erase(victim.first);
+      evicted_keys.push_back(std::move(victim.first));
+      shard.lru.pop_back();
+      ++evictions_;
+    }
+  }
+
+  // Objects live in the shards of their URLs, never locked with a block's
+  if (replaced) CountBlock(url, false);
+  for (const auto& evicted_key : evicted_keys) {
+    CountBlock(UrlOf(evicted_key), false);
+  }
+}
+
+bool HttpBlockCache::Read(const std::string& object, uint64_t offset,
+                          uint32_t size, void* buffer) {
+  if (size == 0) return false;
+
+  const uint64_t first = offset / block_size_;
+  const uint64_t last = (offset + size - 1) / block_size_;
+  const uint64_t end = offset + size;
+  std::vector<std::shared_ptr<const Block>> blocks;
+  for (uint64_t index = first; index <= last; ++index) {
+    auto block = Get(object, index);
+    // A short block is the tail of the object
+    if (!block || index * block_size_ + block->size() <
+                      std::min(end, (index + 1) * block_size_))
+      return false;
+    blocks.push_back(std::move(block));
+  }
+
+  char* output = static_cast<char*>(buffer);
+  for (uint64_t index = first; index <= last; ++index) {
+    const auto& block = blocks[index - first];
+    const uint64_t block_offset = index * block_size_;
+    const uint64_t from = std::max(offset, block_offset);
+    const uint64_t to = std::min(end, block_offset + block->size());
+    std::memcpy(output + (from - offset),
+                block->data() + (from - block_offset), to - from);
+  }
+  return true;
+}
+
+std::string HttpBlockCache::GetStatistics() {
+  uint64_t bytes = 0;
+  for (auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    bytes += shard.bytes;
+  }
+
+  char buffer[192];
+  snprintf(buffer, sizeof(buffer),
+           "hits=%llu misses=%llu bytes=%llu evictions=%llu "
+           "revalidations=%llu invalidations=%llu",
+           (unsigned long long)hits_, (unsigned long long)misses_,
+           (unsigned long long)bytes, (unsigned long long)evictions_,
+           (unsigned long long)revalidations_,
+           (unsigned long long)invalidations_);
+  return buffer;
+}
+
+}  // namespace XrdCl
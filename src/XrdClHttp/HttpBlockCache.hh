@@ -0,0 +1,133 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#ifndef __HTTP_BLOCK_CACHE_
+#define __HTTP_BLOCK_CACHE_
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Memory budget of the block cache in bytes, 0 (the default) disables it
+#define HTTP_PLUG_IN_CACHE_SIZE_ENV "XRDCLHTTP_CACHE_SIZE"
+// Size of the aligned cache blocks in bytes
+#define HTTP_PLUG_IN_CACHE_BLOCK_ENV "XRDCLHTTP_CACHE_BLOCK"
+// Seconds after which cached blocks of an object are revalidated
+#define HTTP_PLUG_IN_CACHE_TTL_ENV "XRDCLHTTP_CACHE_TTL"
+
+// GetProperty() name returning the block cache counters
+#define HTTP_PLUG_IN_CACHE_STATS_PROPERTY "HttpCacheStats"
+
+namespace XrdCl {
+
+//----------------------------------------------------------------------------
+//! Process-wide LRU cache of aligned blocks of remote objects, shared by all
+//! HttpFilePlugIn instances. Blocks are keyed by sanitized URL, validator
+//! (mtime and size) and block index, and spread over independently locked
+//! shards.
+//----------------------------------------------------------------------------
+class HttpBlockCache {
+ public:
+  using Block = std::vector<char>;
+
+  static HttpBlockCache& Instance();
+
+  bool Enabled() const { return capacity_ > 0; }
+
+  uint32_t GetBlockSize() const { return block_size_; }
+
+  //--------------------------------------------------------------------------
+  //! Key prefix of the blocks of url at the given validator, or an empty
+  //! string once revalidation found the object no longer matches it. Also
+  //! used by the disk tier to know whether a validator is still good. Only
+  //! looks up: objects are tracked once they have blocks or stale validators.
+  //--------------------------------------------------------------------------
+  std::string ObjectKey(const std::string& url, const std::string& validator);
+
+  //--------------------------------------------------------------------------
+  //! true if the blocks of url were last validated longer than the TTL ago.
+  //! Only one caller is told so per TTL period; it has to revalidate and
+  //! report back through Validated().
+  //--------------------------------------------------------------------------
+  bool NeedsRevalidation(const std::string& url);
+
+  void Validated(const std::string& url, const std::string& validator,
+                 bool modified);
+
+  std::shared_ptr<const Block> Get(const std::string& object, uint64_t index);
+
+  void Put(const std::string& object, uint64_t index,
+           std::shared_ptr<const Block> block);
+
+  //--------------------------------------------------------------------------
+  //! Copy [offset, offset + size) out of the cache. Returns false, without
+  //! touching buffer, unless every block of the range is cached.
+  //--------------------------------------------------------------------------
+  bool Read(const std::string& object, uint64_t offset, uint32_t size,
+            void* buffer);
+
+  //--------------------------------------------------------------------------
+  //! Counters as "hits=N misses=N bytes=N evictions=N revalidations=N
+  //! invalidations=N"
+  //--------------------------------------------------------------------------
+  std::string GetStatistics();
+
+ private:
+  // Erased once it has neither blocks, under any validator, nor stale
+  // validators left
+  struct Object {
+    time_t validated;
+    // Validators found out of date; their blocks age out of the LRU
+    std::set<std::string> stale;
+    uint64_t blocks = 0;
+  };
+
+  struct Shard {
+    std::mutex mutex;
+    // Most recently used first
+    std::list<std::pair<std::string, std::shared_ptr<const Block>>> lru;
+    std::unordered_map<std::string, decltype(lru)::iterator> blocks;
+    uint64_t bytes = 0;
+    std::unordered_map<std::string, Object> objects;
+  };
+
+  HttpBlockCache(uint64_t capacity, uint32_t block_size, time_t ttl);
+
+  Shard& ShardFor(const std::string& key);
+
+  static std::string BlockKey(const std::string& object, uint64_t index);
+
+  // URL of an object or block key, the validator holding no space
+  static std::string UrlOf(const std::string& key);
+
+  // Blocks are counted in before they are cached and out after they are
+  // evicted, so an object is never erased while it still has some
+  void CountBlock(const std::string& url, bool added);
+
+  static const size_t kNumShards = 16;
+
+  const uint64_t capacity_;
+  const uint32_t block_size_;
+  const time_t ttl_;
+
+  Shard shards_[kNumShards];
+
+  std::atomic<uint64_t> hits_;
+  std::atomic<uint64_t> misses_;
+  std::atomic<uint64_t> evictions_;
+  std::atomic<uint64_t> revalidations_;
+  std::atomic<uint64_t> invalidations_;
+};
+
+}  // namespace XrdCl
+
+#endif  // __HTTP_BLOCK_CACHE_
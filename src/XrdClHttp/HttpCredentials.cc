@@ -0,0 +1,91 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#include "HttpCredentials.hh"
+
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <utility>
+
+#include "davix/auth/davixx509cred.hpp"
+
+namespace {
+
+// Seconds during which the proxy file isn't even stat()-ed again
+const time_t kProxyCheckInterval = 5;
+
+std::string GetEnv(const char* name) {
+  const char* value = getenv(name);
+  return value ? value : "";
+}
+
+}  // namespace
+
+namespace XrdCl {
+
+HttpCredentials& HttpCredentials::Instance() {
+  static HttpCredentials* credentials = new HttpCredentials();
+  return *credentials;
+}
+
+HttpCredentials::HttpCredentials()
+    : proxy_dev_(0), proxy_ino_(0), proxy_mtime_{0, 0}, proxy_checked_(0) {
+  s3_.access_key = GetEnv("AWS_ACCESS_KEY_ID");
+  s3_.secret_key = GetEnv("AWS_SECRET_ACCESS_KEY");
+  // Without a region, Davix uses the old AWS signature v2
+  s3_.region = GetEnv("AWS_REGION");
+  if (s3_.region.empty() && !getenv("AWS_SIGNATURE_V2")) s3_.region = "mars";
+
+  ca_path_ = GetEnv("X509_CERT_DIR");
+  if (ca_path_.empty()) ca_path_ = "/etc/grid-security/certificates";
+
+  proxy_path_ = GetEnv("X509_USER_PROXY");
+  if (proxy_path_.empty())
+    proxy_path_ = "/tmp/x509up_u" + std::to_string(geteuid());
+}
+
+std::string HttpCredentials::Identity() const {
+  if (S3Enabled()) return "aws:" + s3_.access_key;
+  return "x509:" + proxy_path_;
+}
+
+int HttpCredentials::LoadX509(Davix::X509Credential* cert,
+                              Davix::DavixError** err) {
+  std::lock_guard<std::mutex> lock(proxy_mutex_);
+
+  const time_t now = time(NULL);
+  if (!proxy_ || now - proxy_checked_ >= kProxyCheckInterval) {
+    proxy_checked_ = now;
+
+    struct stat info;
+    if (stat(proxy_path_.c_str(), &info)) {
+      proxy_.reset();
+      return 1;
+    }
+
+    // A renewed proxy is usually a new file moved in place
+    if (!proxy_ || info.st_dev != proxy_dev_ || info.st_ino != proxy_ino_ ||
+        info.st_mtim.tv_sec != proxy_mtime_.tv_sec ||
+        info.st_mtim.tv_nsec != proxy_mtime_.tv_nsec) {
+      std::unique_ptr<Davix::X509Credential> proxy(
+          new Davix::X509Credential());
+      const int res = proxy->loadFromFilePEM(proxy_path_, proxy_path_, "", err);
+      if (res) {
+        proxy_.reset();
+        return res;
+      }
+      proxy_ = std::move(proxy);
+      proxy_dev_ = info.st_dev;
+      proxy_ino_ = info.st_ino;
+      proxy_mtime_ = info.st_mtim;
+    }
+  }
+
+  *cert = *proxy_;
+  return 0;
+}
+
+}  // namespace XrdCl
@@ -0,0 +1,84 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#ifndef __HTTP_CREDENTIALS_
+#define __HTTP_CREDENTIALS_
+
+#include <davix.hpp>
+
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <sys/types.h>
+
+namespace XrdCl {
+
+//----------------------------------------------------------------------------
+//! Process-wide holder of what requests authenticate with. The S3 keys and
+//! region, and the CA path, are resolved from the environment once. The X509
+//! proxy is parsed once and kept in memory, then parsed again only when the
+//! proxy file is replaced or modified.
+//----------------------------------------------------------------------------
+class HttpCredentials {
+ public:
+  struct S3Keys {
+    std::string access_key;
+    std::string secret_key;
+    // Empty for AWS signature v2
+    std::string region;
+  };
+
+  static HttpCredentials& Instance();
+
+  //--------------------------------------------------------------------------
+  //! true when requests are signed with the AWS keys rather than the proxy
+  //--------------------------------------------------------------------------
+  bool S3Enabled() const {
+    return !s3_.access_key.empty() && !s3_.secret_key.empty();
+  }
+
+  //--------------------------------------------------------------------------
+  //! true as soon as AWS_ACCESS_KEY_ID is set, which is what makes URLs
+  //! lose their CGI and files get S3 permissions
+  //--------------------------------------------------------------------------
+  bool S3AccessKeySet() const { return !s3_.access_key.empty(); }
+
+  const S3Keys& GetS3Keys() const { return s3_; }
+
+  const std::string& GetCaPath() const { return ca_path_; }
+
+  const std::string& GetProxyPath() const { return proxy_path_; }
+
+  //--------------------------------------------------------------------------
+  //! What sessions are authenticated as, "aws:<key id>" or "x509:<proxy>"
+  //--------------------------------------------------------------------------
+  std::string Identity() const;
+
+  //--------------------------------------------------------------------------
+  //! Set cert to the parsed proxy, for the client certificate callback of
+  //! Davix. Returns 0 on success, as the callback does.
+  //--------------------------------------------------------------------------
+  int LoadX509(Davix::X509Credential* cert, Davix::DavixError** err);
+
+ private:
+  HttpCredentials();
+
+  S3Keys s3_;
+  std::string ca_path_;
+  std::string proxy_path_;
+
+  std::mutex proxy_mutex_;
+  std::unique_ptr<Davix::X509Credential> proxy_;
+  // Identity of the file proxy_ was parsed from
+  dev_t proxy_dev_;
+  ino_t proxy_ino_;
+  struct timespec proxy_mtime_;
+  time_t proxy_checked_;
+};
+
+}  // namespace XrdCl
+
+#endif  // __HTTP_CREDENTIALS_
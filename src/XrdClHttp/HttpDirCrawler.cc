@@ -0,0 +1,175 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#include "HttpDirCrawler.hh"
+
+#include <algorithm>
+#include <cctype>
+#include <atomic>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+#include "XrdCl/XrdClDefaultEnv.hh"
+#include "XrdCl/XrdClLog.hh"
+
+#include "HttpExecutor.hh"
+#include "HttpPlugInUtil.hh"
+
+namespace {
+
+const uint64_t kDefaultListStreams = 8;
+
+// Deeper than any sane tree: what lies below is assumed to be a loop
+const unsigned kMaxDepth = 64;
+
+// Failed subdirectories named in the status message, the others counted
+const size_t kMaxReportedFailures = 10;
+
+struct Directory {
+  std::string url;
+  // Path relative to the root of the listing, empty for the root
+  std::string relative;
+  unsigned depth;
+};
+
+// Key of a directory URL: no empty or "." segments, ".." applied, no
+// trailing slash
+std::string Normalize(const std::string& url) {
+  const auto scheme = url.find("://");
+  const auto start =
+      url.find('/', scheme == std::string::npos ? 0 : scheme + 3);
+  if (start == std::string::npos) return url;
+
+  const auto query = url.find('?', start);
+  const std::string path = url.substr(start, query - start);
+  std::vector<std::string> segments;
+  for (size_t from = 0; from < path.size();) {
+    auto to = path.find('/', from);
+    if (to == std::string::npos) to = path.size();
+    const std::string segment = path.substr(from, to - from);
+    if (segment == "..") {
+      if (!segments.empty()) segments.pop_back();
+    }
+    else if (!segment.empty() && segment != ".") {
+      segments.push_back(segment);
+    }
+    from = to + 1;
+  }
+
+  std::string key = url.substr(0, start);
+  for (const auto& segment : segments) key += "/" + segment;
+  return key;
+}
+
+// Percent-encoding of a path segment: listings give the names decoded
+std::string PathEscape(const std::string& name) {
+  static const char kHex[] = "0123456789ABCDEF";
+  std::string escaped;
+  for (unsigned char c : name) {
+    if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+      escaped += c;
+    }
+    else {
+      escaped += '%';
+      escaped += kHex[c >> 4];
+      escaped += kHex[c & 15];
+    }
+  }
+  return escaped;
+}
+
+std::string Child(const std::string& url, const std::string& name) {
+  const auto query = url.find('?');
+  std::string path = url.substr(0, query);
+  if (path.empty() || path.back() != '/') path += "/";
+  path += PathEscape(name);
+  return query == std::string::npos ? path : path + url.substr(query);
+}
+
+}  // namespace
+
+namespace XrdCl {
+
+std::pair<DirectoryList*, XRootDStatus> RecursiveDirList(
+    const std::string& url, const HttpDirLister& list) {
+  static const uint64_t streams = std::max<uint64_t>(
+      1, GetEnvUInt(HTTP_PLUG_IN_LIST_STREAMS_ENV, kDefaultListStreams));
+
+  std::unique_ptr<DirectoryList> result(new DirectoryList());
+  std::vector<std::string> failures;
+  std::unordered_set<std::string> visited{Normalize(url)};
+  std::vector<Directory> level{Directory{url, "", 0}};
+
+  while (!level.empty()) {
+    std::vector<std::pair<DirectoryList*, XRootDStatus>> listings(
+        level.size());
+    std::atomic<size_t> next(0);
+    std::vector<HttpExecutor::Task> lanes(
+        std::min<size_t>(streams, level.size()), [&] {
+          for (size_t i = next++; i < level.size(); i = next++)
+            listings[i] = list(level[i].url);
+        });
+    HttpExecutor::Instance().RunAll(std::move(lanes));
+
+    std::vector<Directory> deeper;
+    for (size_t i = 0; i < level.size(); ++i) {
+      const auto& directory = level[i];
+      std::unique_ptr<DirectoryList> listing(listings[i].first);
+      const auto& status = listings[i].second;
+      if (status.IsError()) {
+        if (directory.depth == 0) {
+          for (size_t j = i + 1; j < listings.size(); ++j)
+            delete listings[j].first;
+          return std::make_pair(nullptr, status);
+        }
+        DefaultEnv::GetLog()->Warning(
+            kLogXrdClHttp, "Could not list %s, left out: %s",
+            directory.url.c_str(), status.ToStr().c_str());
+        failures.push_back(directory.relative + " (" + status.ToStr() + ")");
+        continue;
+      }
+      if (!listing) continue;
+
+      for (auto it = listing->Begin(); it != listing->End(); ++it) {
+        auto entry = *it;
+        const auto& name = entry->GetName();
+        if (name.empty() || name == "." || name == "..") continue;
+
+        const std::string relative =
+            directory.relative.empty() ? name
+                                       : directory.relative + "/" + name;
+        auto stat_info = entry->GetStatInfo();
+        // Ownership moves to the merged entry
+        entry->SetStatInfo(nullptr);
+        result->Add(new DirectoryList::ListEntry(entry->GetHostAddress(),
+                                                 relative, stat_info));
+
+        if (!stat_info || !stat_info->TestFlags(StatInfo::IsDir)) continue;
+        const auto child = Child(directory.url, name);
+        if (!visited.insert(Normalize(child)).second) continue;
+        if (directory.depth + 1 >= kMaxDepth) {
+          failures.push_back(relative + " (too deep)");
+          continue;
+        }
+        deeper.push_back(Directory{child, relative, directory.depth + 1});
+      }
+    }
+    level.swap(deeper);
+  }
+
+  if (failures.empty()) {
+    return std::make_pair(result.release(), XRootDStatus());
+  }
+
+  std::string message =
+      "Could not list " + std::to_string(failures.size()) + " directories:";
+  for (size_t i = 0; i < std::min(failures.size(), kMaxReportedFailures); ++i)
+    message += " " + failures[i];
+  if (failures.size() > kMaxReportedFailures) message += " ...";
+  return std::make_pair(result.release(),
+                        XRootDStatus(stOK, suPartial, 0, message));
+}
+
+}  // namespace XrdCl
@@ -0,0 +1,41 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#ifndef __HTTP_DIR_CRAWLER_
+#define __HTTP_DIR_CRAWLER_
+
+#include "XrdCl/XrdClXRootDResponses.hh"
+
+#include <functional>
+#include <string>
+#include <utility>
+
+// Number of directories a recursive listing lists at the same time
+#define HTTP_PLUG_IN_LIST_STREAMS_ENV "XRDCLHTTP_LIST_STREAMS"
+
+namespace XrdCl {
+
+//----------------------------------------------------------------------------
+//! Lists one directory, with the StatInfo of every entry
+//----------------------------------------------------------------------------
+using HttpDirLister =
+    std::function<std::pair<DirectoryList*, XRootDStatus>(const std::string&)>;
+
+//----------------------------------------------------------------------------
+//! Recursive listing of the directory at url, breadth first: the
+//! subdirectories found at one depth are all listed concurrently, up to
+//! XRDCLHTTP_LIST_STREAMS at a time, before going one level deeper.
+//!
+//! Entries are named relative to url ("sub/dir/file") and merged into one
+//! list. Against loops through links, a directory already visited is not
+//! listed again and the crawl stops at a maximum depth. Subdirectories that
+//! can't be listed, or are too deep, are named in a suPartial status; only a
+//! failure to list url itself fails the call.
+//----------------------------------------------------------------------------
+std::pair<DirectoryList*, XRootDStatus> RecursiveDirList(
+    const std::string& url, const HttpDirLister& list);
+
+}  // namespace XrdCl
+
+#endif  // __HTTP_DIR_CRAWLER_
@@ -0,0 +1,340 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#include "HttpDiskCache.hh"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <utility>
+
+#include "XrdCl/XrdClDefaultEnv.hh"
+#include "XrdCl/XrdClLog.hh"
+
+#include "HttpPlugInUtil.hh"
+
+namespace {
+
+const char kIndexMagic[8] = {'X', 'R', 'D', 'C', 'L', 'H', 'D', '1'};
+
+const uint64_t kDefaultQuota = 10ULL * 1024 * 1024 * 1024;
+
+// Granularity of the access time kept on the index files for LRU eviction
+const time_t kTouchInterval = 60;
+
+// Stable across processes and builds, unlike std::hash
+uint64_t Fnv1a(const std::string& input) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char c : input) {
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+bool TestBit(const std::vector<uint8_t>& bitmap, uint64_t bit) {
+  return bitmap[bit / 8] & (1 << (bit % 8));
+}
+
+// Closes the descriptor, releasing its flock(), when going out of scope
+struct FileDescriptor {
+  explicit FileDescriptor(int fd) : fd(fd) {}
+  ~FileDescriptor() {
+    if (fd >= 0) close(fd);
+  }
+  int fd;
+};
+
+}  // namespace
+
+namespace XrdCl {
+
+HttpDiskCache& HttpDiskCache::Instance() {
+  static HttpDiskCache* cache = new HttpDiskCache(
+      getenv(HTTP_PLUG_IN_DISKCACHE_DIR_ENV) ?
+          getenv(HTTP_PLUG_IN_DISKCACHE_DIR_ENV) : "",
+      GetEnvUInt(HTTP_PLUG_IN_DISKCACHE_SIZE_ENV, kDefaultQuota));
+  return *cache;
+}
+
+HttpDiskCache::HttpDiskCache(const std::string& directory, uint64_t quota)
+    : directory_(directory),
+      quota_(quota),
+      usage_(0),
+      hits_(0),
+      misses_(0),
+      bytes_saved_(0),
+      bytes_written_(0),
+      evictions_(0) {
+  if (directory_.empty()) return;
+
+  if (mkdir(directory_.c_str(), 0755) && errno != EEXIST) {
+    DefaultEnv::GetLog()->Error(kLogXrdClHttp,
+                                "Could not create disk cache directory %s: %s",
+                                directory_.c_str(), strerror(errno));
+  }
+  Evict();
+}
+
+std::string HttpDiskCache::PathFor(const std::string& url) const {
+  char name[32];
+  snprintf(name, sizeof(name), "/%016llx",
+           (unsigned long long)Fnv1a(url));
+  return directory_ + name;
+}
+
+int HttpDiskCache::OpenLocked(const std::string& path, int flags,
+                              int operation) {
+  while (true) {
+    int fd = open(path.c_str(), flags, 0644);
+    if (fd < 0) return -1;
+    if (flock(fd, operation)) {
+      close(fd);
+      return -1;
+    }
+
+    struct stat by_fd, by_path;
+    if (fstat(fd, &by_fd) == 0 && stat(path.c_str(), &by_path) == 0 &&
+        by_fd.st_ino == by_path.st_ino && by_fd.st_dev == by_path.st_dev)
+      return fd;
+
+    // Evicted while we were waiting, start over on the new file
+    close(fd);
+    if (!(flags & O_CREAT)) return -1;
+  }
+}
+
+bool HttpDiskCache::LoadIndex(int fd, Index& index) {
+  struct stat info;
+  if (fstat(fd, &info) || info.st_size < 28) return false;
+
+  std::vector<char> raw(info.st_size);
+  if (pread(fd, raw.data(), raw.size(), 0) != info.st_size) return false;
+  if (memcmp(raw.data(), kIndexMagic, sizeof(kIndexMagic))) return false;
+
+  uint32_t url_length, validator_length;
+  memcpy(&index.block_size, raw.data() + 8, 4);
+  memcpy(&url_length, raw.data() + 12, 4);
+  memcpy(&validator_length, raw.data() + 16, 4);
+  memcpy(&index.object_size, raw.data() + 20, 8);
+  if (index.block_size == 0) return false;
+
+  const uint64_t num_blocks =
+      (index.object_size + index.block_size - 1) / index.block_size;
+  const uint64_t expected =
+      28 + uint64_t(url_length) + validator_length + (num_blocks + 7) / 8;
+  if (uint64_t(info.st_size) != expected) return false;
+
+  const char* p = raw.data() + 28;
+  index.url.assign(p, url_length);
+  p += url_length;
+  index.validator.assign(p, validator_length);
+  p += validator_length;
+  index.bitmap.assign(reinterpret_cast<const uint8_t*>(p),
+                      reinterpret_cast<const uint8_t*>(raw.data() + raw.size()));
+  return true;
+}
+
+bool HttpDiskCache::StoreIndex(int fd, const Index& index) {
+  std::vector<char> raw(28);
+  uint32_t url_length = index.url.size();
+  uint32_t validator_length = index.validator.size();
+  memcpy(raw.data(), kIndexMagic, sizeof(kIndexMagic));
+  memcpy(raw.data() + 8, &index.block_size, 4);
+  memcpy(raw.data() + 12, &url_length, 4);
+  memcpy(raw.data() + 16, &validator_length, 4);
+  memcpy(raw.data() + 20, &index.object_size, 8);
+  raw.insert(raw.end(), index.url.begin(), index.url.end());
+  raw.insert(raw.end(), index.validator.begin(), index.validator.end());
+  raw.insert(raw.end(), index.bitmap.begin(), index.bitmap.end());
+
+  return pwrite(fd, raw.data(), raw.size(), 0) == ssize_t(raw.size()) &&
+         ftruncate(fd, raw.size()) == 0;
+}
+
+bool HttpDiskCache::Read(const std::string& url, const std::string& validator,
+                         uint64_t object_size, uint32_t block_size,
+                         uint64_t offset, uint32_t size, void* buffer) {
+  if (size == 0 || offset + size > object_size) return false;
+
+  const auto path = PathFor(url);
+  FileDescriptor index_fd(OpenLocked(path + ".idx", O_RDWR, LOCK_SH));
+  Index index;
+  if (index_fd.fd < 0 || !LoadIndex(index_fd.fd, index) || index.url != url ||
+      index.validator != validator || index.object_size != object_size ||
+      index.block_size != block_size) {
+    ++misses_;
+    return false;
+  }
+
+  const uint64_t first = offset / block_size;
+  const uint64_t last = (offset + size - 1) / block_size;
+  for (uint64_t block = first; block <= last; ++block) {
+    if (!TestBit(index.bitmap, block)) {
+      ++misses_;
+      return false;
+    }
+  }
+
+  FileDescriptor data_fd(open((path + ".data").c_str(), O_RDONLY));
+  if (data_fd.fd < 0) {
+    ++misses_;
+    return false;
+  }
+
+  const uint64_t page = sysconf(_SC_PAGESIZE);
+  const uint64_t map_offset = offset - offset % page;
+  const size_t map_length = offset + size - map_offset;
+  void* map = mmap(nullptr, map_length, PROT_READ, MAP_SHARED, data_fd.fd,
+                   map_offset);
+  if (map == MAP_FAILED) {
+    ++misses_;
+    return false;
+  }
+  memcpy(buffer, static_cast<char*>(map) + (offset - map_offset), size);
+  munmap(map, map_length);
+
+  // The index mtime is the LRU clock of the object
+  struct stat info;
+  const time_t now = time(NULL);
+  if (fstat(index_fd.fd, &info) == 0 && now - info.st_mtime > kTouchInterval)
+    futimens(index_fd.fd, nullptr);
+
+  ++hits_;
+  bytes_saved_ += size;
+  return true;
+}
+
+void HttpDiskCache::Write(const std::string& url,
+                          const std::string& validator, uint64_t object_size,
+                          uint32_t block_size, uint64_t offset,
+                          const void* data, uint64_t size) {
+  if (size == 0 || offset % block_size || offset + size > object_size) return;
+  if (size % block_size && offset + size != object_size) return;
+
+  const auto path = PathFor(url);
+  FileDescriptor index_fd(
+      OpenLocked(path + ".idx", O_RDWR | O_CREAT, LOCK_EX));
+  if (index_fd.fd < 0) return;
+
+  Index index;
+  bool reset = !LoadIndex(index_fd.fd, index) || index.url != url ||
+               index.validator != validator ||
+               index.object_size != object_size ||
+               index.block_size != block_size;
+  if (reset) {
+    index.url = url;
+    index.validator = validator;
+    index.object_size = object_size;
+    index.block_size = block_size;
+    index.bitmap.assign(
+        ((object_size + block_size - 1) / block_size + 7) / 8, 0);
+  }
+
+  FileDescriptor data_fd(open((path + ".data").c_str(),
+                              O_RDWR | O_CREAT | (reset ? O_TRUNC : 0), 0644));
+  if (data_fd.fd < 0) return;
+
+  // Sparse: only the blocks written take space
+  struct stat info;
+  if (fstat(data_fd.fd, &info) ||
+      (uint64_t(info.st_size) != object_size &&
+       ftruncate(data_fd.fd, object_size)))
+    return;
+
+  if (pwrite(data_fd.fd, data, size, offset) != ssize_t(size)) return;
+
+  const uint64_t first = offset / block_size;
+  const uint64_t last = (offset + size - 1) / block_size;
+  for (uint64_t block = first; block <= last; ++block) {
+    index.bitmap[block / 8] |= 1 << (block % 8);
+  }
+  if (!StoreIndex(index_fd.fd, index)) return;
+
+  bytes_written_ += size;
+  if ((usage_ += size) > quota_) Evict();
+}
+
+void HttpDiskCache::Evict() {
+  std::unique_lock<std::mutex> lock(evict_mutex_, std::try_to_lock);
+  if (!lock.owns_lock()) return;
+
+  DIR* dir = opendir(directory_.c_str());
+  if (!dir) return;
+
+  struct Entry {
+    time_t last_used;
+    uint64_t bytes;
+    std::string path;
+  };
+  std::vector<Entry> entries;
+  uint64_t usage = 0;
+
+  while (struct dirent* entry = readdir(dir)) {
+    std::string name = entry->d_name;
+    if (name.size() < 4 || name.compare(name.size() - 4, 4, ".idx")) continue;
+
+    const auto path = directory_ + "/" + name.substr(0, name.size() - 4);
+    struct stat index_info, data_info;
+    if (stat((path + ".idx").c_str(), &index_info)) continue;
+    uint64_t bytes = index_info.st_blocks * 512;
+    if (stat((path + ".data").c_str(), &data_info) == 0)
+      bytes += data_info.st_blocks * 512;
+
+    usage += bytes;
+    entries.push_back(Entry{index_info.st_mtime, bytes, path});
+  }
+  closedir(dir);
+
+  if (usage > quota_) {
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry& a, const Entry& b) {
+                return a.last_used < b.last_used;
+              });
+
+    // Leave some headroom so that we don't evict on every write
+    const uint64_t target = quota_ / 10 * 9;
+    for (const auto& entry : entries) {
+      if (usage <= target) break;
+
+      // Skip objects other threads or processes are using right now
+      FileDescriptor index_fd(open((entry.path + ".idx").c_str(), O_RDWR));
+      if (index_fd.fd < 0 || flock(index_fd.fd, LOCK_EX | LOCK_NB)) continue;
+
+      unlink((entry.path + ".data").c_str());
+      unlink((entry.path + ".idx").c_str());
+      usage -= std::min(usage, entry.bytes);
+      ++evictions_;
+    }
+  }
+
+  usage_ = usage;
+}
+
+std::string HttpDiskCache::GetStatistics() {
+  const uint64_t hits = hits_;
+  const uint64_t lookups = hits + misses_;
+  char buffer[256];
+  snprintf(buffer, sizeof(buffer),
+           "hits=%llu misses=%llu hit_rate=%.3f bytes_saved=%llu "
+           "bytes_written=%llu evictions=%llu usage=%llu",
+           (unsigned long long)hits, (unsigned long long)(lookups - hits),
+           lookups ? double(hits) / lookups : 0.0,
+           (unsigned long long)bytes_saved_,
+           (unsigned long long)bytes_written_,
+           (unsigned long long)evictions_, (unsigned long long)usage_);
+  return buffer;
+}
+
+}  // namespace XrdCl
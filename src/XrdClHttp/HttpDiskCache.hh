@@ -0,0 +1,102 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#ifndef __HTTP_DISK_CACHE_
+#define __HTTP_DISK_CACHE_
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Directory of the local disk cache, unset disables it
+#define HTTP_PLUG_IN_DISKCACHE_DIR_ENV "XRDCLHTTP_DISKCACHE_DIR"
+// Size quota of the disk cache in bytes
+#define HTTP_PLUG_IN_DISKCACHE_SIZE_ENV "XRDCLHTTP_DISKCACHE_SIZE"
+
+// GetProperty() name returning the disk cache counters
+#define HTTP_PLUG_IN_DISKCACHE_STATS_PROPERTY "HttpDiskCacheStats"
+
+namespace XrdCl {
+
+//----------------------------------------------------------------------------
+//! Persistent cache of fetched blocks on local disk, surviving restarts and
+//! shared by all processes using the same directory.
+//!
+//! Each object is a sparse <hash>.data file of the object's size, read
+//! through mmap, plus a <hash>.idx file holding the URL, the validator and
+//! a bitmap of the blocks present. The index is flock()ed, shared for
+//! lookups and exclusive for updates. The least recently used objects are
+//! removed when the directory grows over its quota.
+//----------------------------------------------------------------------------
+class HttpDiskCache {
+ public:
+  static HttpDiskCache& Instance();
+
+  bool Enabled() const { return !directory_.empty(); }
+
+  //--------------------------------------------------------------------------
+  //! Copy [offset, offset + size) of the object into buffer. Returns false,
+  //! as a miss, unless every block of the range is on disk for this
+  //! validator.
+  //--------------------------------------------------------------------------
+  bool Read(const std::string& url, const std::string& validator,
+            uint64_t object_size, uint32_t block_size, uint64_t offset,
+            uint32_t size, void* buffer);
+
+  //--------------------------------------------------------------------------
+  //! Store whole blocks: offset must be block aligned and size a multiple
+  //! of block_size, unless the range ends at the end of the object.
+  //--------------------------------------------------------------------------
+  void Write(const std::string& url, const std::string& validator,
+             uint64_t object_size, uint32_t block_size, uint64_t offset,
+             const void* data, uint64_t size);
+
+  //--------------------------------------------------------------------------
+  //! Counters as "hits=N misses=N hit_rate=R bytes_saved=N bytes_written=N
+  //! evictions=N usage=N"
+  //--------------------------------------------------------------------------
+  std::string GetStatistics();
+
+ private:
+  struct Index {
+    uint32_t block_size;
+    uint64_t object_size;
+    std::string url;
+    std::string validator;
+    std::vector<uint8_t> bitmap;
+  };
+
+  HttpDiskCache(const std::string& directory, uint64_t quota);
+
+  std::string PathFor(const std::string& url) const;
+
+  // Open and flock() the index, making sure it wasn't unlinked by an
+  // eviction while we waited for the lock. Returns -1 on failure.
+  static int OpenLocked(const std::string& path, int flags, int operation);
+
+  static bool LoadIndex(int fd, Index& index);
+  static bool StoreIndex(int fd, const Index& index);
+
+  // Remove the least recently used objects until usage is below the quota.
+  // Also recomputes usage_ from the directory contents.
+  void Evict();
+
+  const std::string directory_;
+  const uint64_t quota_;
+
+  std::mutex evict_mutex_;
+  std::atomic<uint64_t> usage_;
+
+  std::atomic<uint64_t> hits_;
+  std::atomic<uint64_t> misses_;
+  std::atomic<uint64_t> bytes_saved_;
+  std::atomic<uint64_t> bytes_written_;
+  std::atomic<uint64_t> evictions_;
+};
+
+}  // namespace XrdCl
+
+#endif  // __HTTP_DISK_CACHE_
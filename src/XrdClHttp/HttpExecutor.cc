@@ -0,0 +1,151 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#include "HttpExecutor.hh"
+
+#include <atomic>
+
+#include "XrdCl/XrdClXRootDResponses.hh"
+
+#include "HttpPlugInUtil.hh"
+#include "HttpTrace.hh"
+
+namespace XrdCl {
+
+HttpExecutor::Strand::Strand() : queue_(std::make_shared<Queue>()) {}
+
+void HttpExecutor::Strand::Submit(Task task) {
+  std::lock_guard<std::mutex> lock(queue_->mutex);
+  queue_->tasks.push_back(std::move(task));
+  if (!queue_->active) {
+    queue_->active = true;
+    auto queue = queue_;
+    HttpExecutor::Instance().Submit([queue] { Drain(queue); });
+  }
+}
+
+void HttpExecutor::Strand::Drain(std::shared_ptr<Queue> queue) {
+  while (true) {
+    Task task;
+    {
+      std::lock_guard<std::mutex> lock(queue->mutex);
+      if (queue->tasks.empty()) {
+        queue->active = false;
+        return;
+      }
+      task = std::move(queue->tasks.front());
+      queue->tasks.pop_front();
+    }
+    task();
+  }
+}
+
+HttpExecutor& HttpExecutor::Instance() {
+  // Never destroyed: the threads must survive static destruction, since
+  // XrdCl may still be tearing down files when the process exits
+  static HttpExecutor* executor =
+      new HttpExecutor(GetEnvUInt(HTTP_PLUG_IN_WORKERS_ENV, 32),
+                       GetEnvUInt(HTTP_PLUG_IN_CALLBACKS_ENV, 3));
+  return *executor;
+}
+
+HttpExecutor::HttpExecutor(unsigned num_workers,
+                           unsigned num_callback_threads) {
+  if (num_workers == 0) num_workers = 1;
+  if (num_callback_threads == 0) num_callback_threads = 1;
+
+  for (unsigned i = 0; i < num_workers; ++i) {
+    threads_.emplace_back(&HttpExecutor::RunWorker, this);
+  }
+  for (unsigned i = 0; i < num_callback_threads; ++i) {
+    threads_.emplace_back(&HttpExecutor::RunCompletions, this);
+  }
+  for (auto& thread : threads_) {
+    thread.detach();
+  }
+}
+
+void HttpExecutor::Submit(Task task) {
+  {
+    std::lock_guard<std::mutex> lock(task_mutex_);
+    tasks_.push_back(std::move(task));
+  }
+  task_cond_.notify_one();
+}
+
+void HttpExecutor::RunAll(std::vector<Task> tasks) {
+  struct Batch {
+    std::vector<Task> tasks;
+    std::atomic<size_t> next{0};
+    std::mutex mutex;
+    std::condition_variable cond;
+    size_t done = 0;
+    // The caller waits for the tasks, so its trace outlives them
+    HttpTrace* trace = HttpTrace::Current();
+
+    // Whoever gets there first runs the next task, worker or caller
+    void Run() {
+      HttpTrace::Adopt adopt(trace);
+      size_t ran = 0;
+      for (size_t i = next++; i < tasks.size(); i = next++) {
+        tasks[i]();
+        ++ran;
+      }
+      if (ran == 0) return;
+      std::lock_guard<std::mutex> lock(mutex);
+      if ((done += ran) == tasks.size()) cond.notify_all();
+    }
+  };
+
+  if (tasks.empty()) return;
+
+  auto batch = std::make_shared<Batch>();
+  batch->tasks = std::move(tasks);
+  for (size_t i = 1; i < batch->tasks.size(); ++i) {
+    Submit([batch] { batch->Run(); });
+  }
+  batch->Run();
+
+  std::unique_lock<std::mutex> lock(batch->mutex);
+  batch->cond.wait(lock,
+                   [&batch] { return batch->done == batch->tasks.size(); });
+}
+
+void HttpExecutor::Complete(ResponseHandler* handler, XRootDStatus* status,
+                            AnyObject* response) {
+  {
+    std::lock_guard<std::mutex> lock(completion_mutex_);
+    completions_.push_back(Completion{handler, status, response});
+  }
+  completion_cond_.notify_one();
+}
+
+void HttpExecutor::RunWorker() {
+  while (true) {
+    Task task;
+    {
+      std::unique_lock<std::mutex> lock(task_mutex_);
+      task_cond_.wait(lock, [this] { return !tasks_.empty(); });
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    task();
+  }
+}
+
+void HttpExecutor::RunCompletions() {
+  while (true) {
+    Completion completion;
+    {
+      std::unique_lock<std::mutex> lock(completion_mutex_);
+      completion_cond_.wait(lock, [this] { return !completions_.empty(); });
+      completion = completions_.front();
+      completions_.pop_front();
+    }
+    completion.handler->HandleResponse(completion.status,
+                                       completion.response);
+  }
+}
+
+}  // namespace XrdCl
@@ -0,0 +1,108 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#ifndef __HTTP_EXECUTOR_
+#define __HTTP_EXECUTOR_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Number of threads running the blocking Davix calls
+#define HTTP_PLUG_IN_WORKERS_ENV "XRDCLHTTP_WORKERS"
+// Number of threads invoking the XrdCl response handlers
+#define HTTP_PLUG_IN_CALLBACKS_ENV "XRDCLHTTP_CALLBACK_THREADS"
+
+namespace XrdCl {
+
+class AnyObject;
+class ResponseHandler;
+class XRootDStatus;
+
+//----------------------------------------------------------------------------
+//! Process-wide request executor. Davix only offers a blocking API, so every
+//! plug-in operation is queued here and run on a bounded pool of worker
+//! threads; the caller returns immediately and the ResponseHandler is later
+//! invoked from a dedicated completion thread.
+//----------------------------------------------------------------------------
+class HttpExecutor {
+ public:
+  using Task = std::function<void()>;
+
+  //--------------------------------------------------------------------------
+  //! Runs its tasks one at a time, in submission order, on the shared worker
+  //! pool. Used for operations on one file that must not be reordered
+  //! (Open, Write, Sync, Close).
+  //--------------------------------------------------------------------------
+  class Strand {
+   public:
+    Strand();
+
+    void Submit(Task task);
+
+   private:
+    struct Queue {
+      std::mutex mutex;
+      std::deque<Task> tasks;
+      bool active = false;
+    };
+
+    static void Drain(std::shared_ptr<Queue> queue);
+
+    // Shared with the draining worker, so the strand owner may go away as
+    // soon as the last response handler fires
+    std::shared_ptr<Queue> queue_;
+  };
+
+  static HttpExecutor& Instance();
+
+  //--------------------------------------------------------------------------
+  //! Queue a task on the worker pool
+  //--------------------------------------------------------------------------
+  void Submit(Task task);
+
+  //--------------------------------------------------------------------------
+  //! Run tasks concurrently on the worker pool and wait for all of them.
+  //! The calling thread runs tasks too, so this may be called from a
+  //! worker without starving the pool.
+  //--------------------------------------------------------------------------
+  void RunAll(std::vector<Task> tasks);
+
+  //--------------------------------------------------------------------------
+  //! Hand a finished operation over to the completion threads. Ownership of
+  //! status and response passes to the handler, as with a direct call.
+  //--------------------------------------------------------------------------
+  void Complete(ResponseHandler* handler, XRootDStatus* status,
+                AnyObject* response = nullptr);
+
+ private:
+  struct Completion {
+    ResponseHandler* handler;
+    XRootDStatus* status;
+    AnyObject* response;
+  };
+
+  HttpExecutor(unsigned num_workers, unsigned num_callback_threads);
+
+  void RunWorker();
+  void RunCompletions();
+
+  std::mutex task_mutex_;
+  std::condition_variable task_cond_;
+  std::deque<Task> tasks_;
+
+  std::mutex completion_mutex_;
+  std::condition_variable completion_cond_;
+  std::deque<Completion> completions_;
+
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace XrdCl
+
+#endif  // __HTTP_EXECUTOR_
@@ -6,18 +6,52 @@
 
 #include <unistd.h>
 
+#include <algorithm>
 #include <cassert>
-
+#include <cstdlib>
+#include <cstring>
+
+#include "HttpBlockCache.hh"
+#include "HttpDiskCache.hh"
+#include "HttpHedge.hh"
+#include "HttpMetrics.hh"
+#include "HttpPageChecksum.hh"
 #include "HttpPlugInUtil.hh"
+#include "HttpRangeReader.hh"
+#include "HttpReadAhead.hh"
+#include "HttpReplicas.hh"
+#include "HttpS3Upload.hh"
+#include "HttpSessionPool.hh"
+#include "HttpStreamRead.hh"
+#include "HttpStreamUpload.hh"
+#include "HttpVectorPlanner.hh"
+#include "HttpStatCache.hh"
+#include "HttpTrace.hh"
 #include "Posix.hh"
 #include "XrdCl/XrdClDefaultEnv.hh"
 #include "XrdCl/XrdClLog.hh"
 #include "XrdCl/XrdClStatus.hh"
 
+#include "XProtocol/XProtocol.hh"
 #include "XrdOuc/XrdOucCRC.hh"
 
 namespace {
 
+const uint64_t kDefaultReadStreams = 4;
+const uint64_t kDefaultReadSplit = 8 * 1024 * 1024;
+// Attempts per part of a split read
+const int kPartAttempts = 3;
+
+// PgReads at least twice this size are fetched in page-aligned segments
+// of this size, each checksummed as soon as it arrives
+const uint32_t kPageSegmentSize = 1024 * 1024;
+
+uint64_t ReadStreams() {
+  static const uint64_t streams = XrdCl::GetEnvUInt(
+      HTTP_FILE_PLUG_IN_READ_STREAMS_ENV, kDefaultReadStreams);
+  return streams;
+}
+
 int MakePosixOpenFlags(XrdCl::OpenFlags::Flags flags) {
   int posix_flags = 0;
   if (flags & XrdCl::OpenFlags::New) {
@@ -42,49 +76,68 @@ int MakePosixOpenFlags(XrdCl::OpenFlags::Flags flags) {
 
 namespace XrdCl {
 
-Davix::Context *root_davix_context_ = NULL;
-Davix::DavPosix *root_davix_client_file_ = NULL;
-
 HttpFilePlugIn::HttpFilePlugIn()
-    : davix_fd_(nullptr),
-      curr_offset(0),
-      is_open_(false),
+    : davix_context_(nullptr),
+      davix_client_(nullptr),
+      davix_fd_(nullptr),
+      posix_open_flags_(0),
+      state_(State::kClosed),
+      in_flight_(0),
+      close_handler_(nullptr),
+      writable_(false),
       filesize(0),
+      filemtime_(0),
       url_(),
+      replica_(0),
       properties_(),
       logger_(DefaultEnv::GetLog()) {
   SetUpLogging(logger_);
   logger_->Debug(kLogXrdClHttp, "HttpFilePlugin constructed.");
+}
 
-  std::string origin = getenv("XRDXROOTD_PROXY")? getenv("XRDXROOTD_PROXY") : "";
-  if ( origin.empty() || origin.find("=") == 0) {
-      davix_context_ = new Davix::Context();
-      davix_client_ = new Davix::DavPosix(davix_context_);
-  }
-  else {
-      if (root_davix_context_ == NULL) {
-          root_davix_context_ = new Davix::Context();
-          root_davix_client_file_ = new Davix::DavPosix(root_davix_context_);
-      }
-      davix_context_ = root_davix_context_;
-      davix_client_ = root_davix_client_file_;
+HttpFilePlugIn::~HttpFilePlugIn() noexcept {
+  // Tasks still queued or running use this file
+  {
+    std::unique_lock<std::mutex> lock(state_mutex_);
+    state_cond_.wait(lock, [this] { return in_flight_ == 0; });
   }
+  // Dropped without Close
+  if (read_ahead_) read_ahead_->Shutdown();
+}
 
+bool HttpFilePlugIn::BeginOperation() {
+  std::lock_guard<std::mutex> lock(state_mutex_);
+  if (state_ != State::kOpen) return false;
+  ++in_flight_;
+  return true;
 }
 
-HttpFilePlugIn::~HttpFilePlugIn() noexcept {
-    if (root_davix_context_ == NULL) {
-        delete davix_client_;
-        delete davix_context_;
+HttpFilePlugIn::Operation::~Operation() {
+  ResponseHandler *close_handler = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(file_->state_mutex_);
+    // The close waiting for this last operation is counted in its stead
+    if (--file_->in_flight_ == 0 && file_->close_handler_) {
+      std::swap(close_handler, file_->close_handler_);
+      ++file_->in_flight_;
     }
+    file_->state_cond_.notify_all();
+  }
+  if (close_handler) file_->SubmitClose(close_handler);
 }
 
 XRootDStatus HttpFilePlugIn::Open(const std::string &url,
                                   OpenFlags::Flags flags, Access::Mode /*mode*/,
                                   ResponseHandler *handler, uint16_t timeout) {
-  if (is_open_) {
-    logger_->Error(kLogXrdClHttp, "URL %s already open", url.c_str());
-    return XRootDStatus(stError, errInvalidOp);
+  {
+    // A second Open must fail even before the first one has completed
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    if (state_ != State::kClosed) {
+      logger_->Error(kLogXrdClHttp, "URL %s already open", url.c_str());
+      return XRootDStatus(stError, errInvalidOp);
+    }
+    state_ = State::kOpening;
+    ++in_flight_;
   }
 
   if (XrdCl::URL(url).GetProtocol().find("https") == 0) 
@@ -102,17 +155,44 @@ XRootDStatus HttpFilePlugIn::Open(const std::string &url,
       avoid_pread_ = true;
   }
 
-  Davix::RequestParams params;
-  if (timeout != 0) {
-    struct timespec ts = {timeout, 0};
-    params.setOperationTimeout(&ts);
-  }
+  session_ = HttpSessionPool::Instance().Acquire(XrdCl::URL(url));
+  davix_context_ = &session_->context;
+  davix_client_ = &session_->posix;
+
+  handler = HttpMetrics::Instance().Track(HttpMetrics::kOpen, handler);
+  const auto queued = HttpTrace::Clock::now();
+
+  strand_.Submit([this, url, flags, handler, timeout, queued] {
+    Operation operation(this);
+    HttpTrace trace("open", url, queued);
+    auto status = DoOpen(url, flags, timeout);
+    {
+      std::lock_guard<std::mutex> lock(state_mutex_);
+      state_ = status.IsOK() ? State::kOpen : State::kClosed;
+    }
+    HttpExecutor::Instance().Complete(handler, new XRootDStatus(status));
+  });
+
+  return XRootDStatus();
+}
+
+XRootDStatus HttpFilePlugIn::DoOpen(const std::string &url,
+                                    OpenFlags::Flags flags,
+                                    uint16_t timeout) {
+  auto &stat_cache = HttpStatCache::Instance();
+  writable_ = flags & (OpenFlags::Write | OpenFlags::Update | OpenFlags::New);
+  head_.clear();
+  int round_trips = 0;
+
+  if (writable_) {
+    stat_cache.Invalidate(url);
 
-  if (flags & (OpenFlags::Write | OpenFlags::Update | OpenFlags::New)) {
     auto full_path = XrdCl::URL(url).GetLocation();
     auto pos = full_path.find_last_of('/');
     auto base_dir =
         pos != std::string::npos ? full_path.substr(0, pos) : full_path;
+    // Posix::MkDir returns straight away, servers create the parents of
+    // what is uploaded: no round trip
     auto mkdir_status =
         Posix::MkDir(*davix_client_, base_dir, XrdCl::MkDirFlags::MakePath,
                     XrdCl::Access::None, timeout);
@@ -124,112 +204,650 @@ XRootDStatus HttpFilePlugIn::Open(const std::string &url,
     }
   }
 
-  if (((flags & OpenFlags::Write) || (flags & OpenFlags::Update)) &&
-      (flags & OpenFlags::Delete)) {
-    auto stat_info = new StatInfo();
-    auto status = Posix::Stat(*davix_client_, url, timeout, stat_info);
-    if (status.IsOK()) {
-      auto unlink_status = Posix::Unlink(*davix_client_, url, timeout);
-      if (unlink_status.IsError()) {
-        logger_->Error(
-            kLogXrdClHttp,
-            "Could not delete existing destination file: %s. Error: %s",
-            url.c_str(), unlink_status.GetErrorMessage().c_str());
-        return unlink_status;
+  // Truncating writes (OpenFlags::Delete) need no stat and unlink of the
+  // destination beforehand: the PUT issued on close overwrites it
+  if ((flags & OpenFlags::Read) &&
+      !(((flags & OpenFlags::Write) || (flags & OpenFlags::Update)) &&
+        (flags & OpenFlags::Delete))) {
+    StatInfo *stat_info = nullptr;
+    XRootDStatus status;
+    bool known = stat_cache.Lookup(url, &stat_info, &status);
+
+    if (!known && !avoid_pread_) {
+      // A ranged GET of the first block tells the size and mtime, and the
+      // block is there for the first read
+      ++round_trips;
+      uint64_t size = 0;
+      time_t mtime = 0;
+      head_.resize(HttpBlockCache::Instance().GetBlockSize());
+      auto res = Posix::ReadHead(*davix_context_, url, timeout, head_.data(),
+                                 head_.size(), &size, &mtime);
+      if (res.second.IsOK()) {
+        filesize = size;
+        filemtime_ = mtime;
+        head_.resize(res.first);
+        known = true;
+      }
+      else {
+        head_.clear();
+        status = res.second;
+        known = status.errNo == kXR_NotFound;
       }
     }
-    delete stat_info;
-  }
-  else if (flags & OpenFlags::Read) {
-    auto stat_info = new StatInfo();
-    auto status = Posix::Stat(*davix_client_, url, timeout, stat_info);
-    if (status.IsOK()) {
+    if (!known) {
+      ++round_trips;
+      status = stat_cache.Stat(*davix_client_, url, timeout, false, &stat_info);
+    }
+
+    if (stat_info) {
       filesize = stat_info->GetSize();
+      filemtime_ = stat_info->GetModTime();
+      delete stat_info;
+    }
+    else if (status.errNo == kXR_NotFound && !(flags & OpenFlags::New)) {
+      // Known missing, possibly from a cached answer: spare the open request.
+      // Opens with OpenFlags::New go on and create the file.
+      logger_->Debug(kLogXrdClHttp, "Not opening missing file: %s",
+                     url.c_str());
+      return status;
     }
-    delete stat_info;
   }
 
-  auto posix_open_flags = MakePosixOpenFlags(flags);
+  posix_open_flags_ = MakePosixOpenFlags(flags);
 
   logger_->Debug(kLogXrdClHttp,
                  "Open: URL: %s, XRootD flags: %d, POSIX flags: %d",
-                 url.c_str(), flags, posix_open_flags);
+                 url.c_str(), flags, posix_open_flags_);
+
+  url_ = url;
+  host_ = XrdCl::URL(url).GetHostId();
+  cache_url_ = Posix::SanitizedURL(url);
+
+  replicas_.clear();
+  if ((flags & OpenFlags::Read) && !writable_ && !avoid_pread_ &&
+      filesize > 0 && HttpReplicas::Instance().Enabled()) {
+    ++round_trips;
+    FindReplicas(timeout);
+  }
+
+  // Pure uploads bypass the davix fd, which would hold the whole file in
+  // memory until close: S3 gets a parallel multipart upload, other servers
+  // a PUT streamed as the file is written when its size is known
+  const bool upload =
+      writable_ && !(flags & (OpenFlags::Read | OpenFlags::Update));
+  // xrdcp tells the size of the file to come
+  uint64_t expected_size = 0;
+  auto cgi = XrdCl::URL(url).GetParams();
+  auto asize = cgi.find(HTTP_FILE_PLUG_IN_ASIZE_CGI);
+  if (asize != cgi.end())
+    expected_size = strtoull(asize->second.c_str(), nullptr, 10);
+  const bool s3_upload = upload && HttpS3Upload::Enabled();
+  const bool stream_upload = upload && !s3_upload && expected_size > 0 &&
+                             HttpStreamUpload::Enabled();
+
+  if (s3_upload || stream_upload) {
+    if (flags & OpenFlags::New) {
+      ++round_trips;
+      StatInfo *stat_info = nullptr;
+      auto status =
+          stat_cache.Stat(*davix_client_, url, timeout, true, &stat_info);
+      delete stat_info;
+      if (status.IsOK()) {
+        url_.clear();
+        return XRootDStatus(stError, errErrorResponse, kXR_ItExists,
+                            "File exists: " + url);
+      }
+    }
+    if (s3_upload) {
+      s3_upload_ = std::make_shared<HttpS3Upload>(session_, url,
+                                                  expected_size, timeout);
+    }
+    else {
+      ++round_trips;
+      stream_upload_.reset(
+          new HttpStreamUpload(session_, url, expected_size, timeout));
+    }
+  }
+  // The davix fd is opened by the first operation needing it, except when
+  // the file must not exist yet: that is for the open to report
+  else if (flags & OpenFlags::New) {
+    ++round_trips;
+    auto status = EnsureOpen(timeout);
+    if (status.IsError()) {
+      url_.clear();
+      return status;
+    }
+  }
+
+  if (!head_.empty() && filemtime_ != 0 &&
+      (HttpBlockCache::Instance().Enabled() ||
+       HttpDiskCache::Instance().Enabled())) {
+    SeedCaches();
+  }
+
+  if ((flags & OpenFlags::Read) && avoid_pread_) {
+    stream_read_.reset(new HttpStreamRead(session_, url_));
+  }
+
+  // Background fetches are range requests of their own; a file being
+  // written would have them queue up on its davix fd instead
+  if ((flags & OpenFlags::Read) && !writable_ && !avoid_pread_ &&
+      filesize > 0 && HttpReadAhead::Enabled()) {
+    read_ahead_ = std::make_shared<HttpReadAhead>(
+        [this](void *buffer, uint32_t size, uint64_t offset) {
+          return FetchRange(buffer, size, offset);
+        },
+        filesize);
+  }
+
+  logger_->Debug(kLogXrdClHttp, "Opened: %s, round trips: %d", url.c_str(),
+                 round_trips);
+
+  return XRootDStatus();
+}
+
+XRootDStatus HttpFilePlugIn::EnsureOpen(uint16_t timeout) {
+  std::lock_guard<std::mutex> lock(fd_mutex_);
+  if (davix_fd_) return XRootDStatus();
 
   // res == std::pair<fd, XRootDStatus>
-  auto res = Posix::Open(*davix_client_, url, posix_open_flags, timeout);
+  auto res = Posix::Open(*davix_client_, url_, posix_open_flags_, timeout);
   if (!res.first) {
-    logger_->Error(kLogXrdClHttp, "Could not open: %s, error: %s", url.c_str(),
-                   res.second.ToStr().c_str());
+    logger_->Error(kLogXrdClHttp, "Could not open: %s, error: %s",
+                   url_.c_str(), res.second.ToStr().c_str());
     return res.second;
   }
 
   davix_fd_ = res.first;
+  return XRootDStatus();
+}
 
-  logger_->Debug(kLogXrdClHttp, "Opened: %s", url.c_str());
+std::pair<int, XRootDStatus> HttpFilePlugIn::RemoteRead(void *buffer,
+                                                        uint32_t size,
+                                                        uint64_t offset) {
+  // Each read is a GET of its own on a pooled session, so that concurrent
+  // reads don't queue up on the davix fd. It must stay within the object,
+  // as it has to be answered in full.
+  if (!writable_) {
+    if (size == 0 || offset >= filesize) {
+      return std::make_pair(0, XRootDStatus());
+    }
+    const uint32_t length = std::min<uint64_t>(size, filesize - offset);
+    ChunkList targets{ChunkInfo(offset, length, buffer)};
+    auto status = RangeRead(targets, {{offset, length}}, false);
+    return std::make_pair(status.IsOK() ? static_cast<int>(length) : -1,
+                          status);
+  }
 
-  is_open_ = true;
-  url_ = url;
+  auto status = EnsureOpen(0);
+  if (status.IsError()) return std::make_pair(-1, status);
+  return Posix::PRead(*davix_client_, davix_fd_, buffer, size, offset);
+}
 
-  auto status = new XRootDStatus();
-  handler->HandleResponse(status, nullptr);
+XRootDStatus HttpFilePlugIn::RangeRead(
+    const ChunkList &targets,
+    const std::vector<std::pair<uint64_t, uint64_t>> &ranges,
+    bool vector_read) {
+  auto &hedge = HttpHedge::Instance();
+  if (replicas_.empty()) {
+    return hedge.Read(
+        host_, targets,
+        RangeAttempt({url_, host_, session_}, ranges, vector_read));
+  }
 
-  return XRootDStatus();
+  // Each replica is tried once, starting from the current one, which the
+  // first to answer becomes
+  auto &scores = HttpReplicas::Instance();
+  size_t index = replica_.load();
+  XRootDStatus status;
+  for (size_t tried = 0; tried < replicas_.size(); ++tried) {
+    const auto &replica = replicas_[index];
+    status = hedge.Read(replica.host, targets,
+                        RangeAttempt(replica, ranges, vector_read));
+    const size_t next = (index + 1) % replicas_.size();
+    size_t expected = index;
+    if (status.IsOK()) {
+      // Served, but too slowly: the next reads go elsewhere
+      if (!scores.Usable(replica.host) &&
+          replica_.compare_exchange_strong(expected, next)) {
+        scores.Demoted();
+        logger_->Info(kLogXrdClHttp, "Replica %s too slow, switching to %s",
+                      replica.url.c_str(), replicas_[next].url.c_str());
+      }
+      return status;
+    }
+
+    scores.Failed(replica.host);
+    if (tried + 1 == replicas_.size()) break;
+    if (replica_.compare_exchange_strong(expected, next)) scores.FailedOver();
+    logger_->Warning(kLogXrdClHttp, "Read from replica %s failed: %s, "
+                     "failing over to %s", replica.url.c_str(),
+                     status.ToStr().c_str(), replicas_[next].url.c_str());
+    index = next;
+  }
+  return status;
 }
 
-XRootDStatus HttpFilePlugIn::Close(ResponseHandler *handler,
-                                   uint16_t /*timeout*/) {
-  if (!is_open_) {
-    logger_->Error(kLogXrdClHttp,
-                   "Cannot close. URL hasn't been previously opened");
-    return XRootDStatus(stError, errInvalidOp);
+HttpHedge::Attempt HttpFilePlugIn::RangeAttempt(
+    const HttpReplicas::Replica &replica,
+    const std::vector<std::pair<uint64_t, uint64_t>> &ranges,
+    bool vector_read) {
+  uint64_t bytes = 0;
+  for (const auto &range : ranges) bytes += range.second;
+  return [replica, ranges, bytes, vector_read](
+             const ChunkList &targets, const std::function<void()> &answered,
+             const std::atomic<bool> &cancelled) {
+    const auto start = HttpReplicas::Clock::now();
+    auto first_byte = start;
+    HttpRangeReader reader(targets);
+    auto status = Posix::ReadRanges(
+        replica.session->context, replica.url, 0, ranges, reader,
+        [&answered, &first_byte] {
+          first_byte = HttpReplicas::Clock::now();
+          if (answered) answered();
+        },
+        &cancelled);
+    if (vector_read) {
+      HttpVectorPlanner::Instance().Delivered(reader.BytesCopied(),
+                                              reader.BytesDiscarded());
+    }
+    auto &scores = HttpReplicas::Instance();
+    if (status.IsOK() && scores.Enabled()) {
+      scores.Record(replica.host, first_byte - start, bytes,
+                    HttpReplicas::Clock::now() - first_byte);
+    }
+    return status;
+  };
+}
+
+void HttpFilePlugIn::FindReplicas(uint16_t timeout) {
+  auto res = Posix::Replicas(*davix_context_, url_, timeout);
+  if (res.second.IsError()) {
+    logger_->Debug(kLogXrdClHttp, "No replicas of %s: %s", url_.c_str(),
+                   res.second.ToStr().c_str());
+    return;
   }
 
-  logger_->Debug(kLogXrdClHttp, "Closing davix fd: %ld", davix_fd_);
+  // The URL opened is a replica too, whether listed or not
+  std::vector<std::string> urls{url_};
+  for (const auto &url : res.first) {
+    const auto sanitized = Posix::SanitizedURL(url);
+    if (sanitized == cache_url_) continue;
+    if (std::find(urls.begin() + 1, urls.end(), url) == urls.end()) {
+      urls.push_back(url);
+    }
+  }
+  if (urls.size() < 2) return;
 
-  auto status = Posix::Close(*davix_client_, davix_fd_);
-  if (status.IsError()) {
-    logger_->Error(kLogXrdClHttp, "Could not close davix fd: %ld, error: %s",
-                   davix_fd_, status.ToStr().c_str());
-    return status;
+  for (const auto &url : urls) {
+    XrdCl::URL parsed(url);
+    replicas_.push_back(HttpReplicas::Replica{
+        url, parsed.GetHostId(), HttpSessionPool::Instance().Acquire(parsed)});
+  }
+  auto &scores = HttpReplicas::Instance();
+  scores.Rank(replicas_);
+  scores.Listed(replicas_.size());
+  replica_ = 0;
+  logger_->Debug(kLogXrdClHttp, "%zu replicas of %s, reading from %s",
+                 replicas_.size(), url_.c_str(), replicas_[0].url.c_str());
+}
+
+void HttpFilePlugIn::SeedCaches() {
+  auto &cache = HttpBlockCache::Instance();
+  const uint64_t block_size = cache.GetBlockSize();
+  // Only a complete first block is a valid cache block
+  if (head_.size() != std::min<uint64_t>(block_size, filesize)) return;
+
+  // The validator was just read from the server, no revalidation needed
+  const auto object = cache.ObjectKey(cache_url_, CacheValidator());
+  if (object.empty()) return;
+
+  if (cache.Enabled()) {
+    cache.Put(object, 0, std::make_shared<HttpBlockCache::Block>(head_));
+  }
+  if (HttpDiskCache::Instance().Enabled()) {
+    HttpDiskCache::Instance().Write(cache_url_, CacheValidator(), filesize,
+                                    block_size, 0, head_.data(), head_.size());
+  }
+}
+
+std::string HttpFilePlugIn::CacheValidator() const {
+  return std::to_string(filemtime_) + ":" + std::to_string(filesize);
+}
+
+std::string HttpFilePlugIn::CacheObject() {
+  auto &cache = HttpBlockCache::Instance();
+  // Without a validator a changed object could not be told apart
+  if ((!cache.Enabled() && !HttpDiskCache::Instance().Enabled()) ||
+      avoid_pread_ || filemtime_ == 0)
+    return "";
+
+  if (cache.NeedsRevalidation(cache_url_)) {
+    bool modified = false;
+    auto status = Posix::Revalidate(*davix_context_, url_, 0, filemtime_,
+                                    filesize, &modified);
+    if (status.IsError()) {
+      logger_->Warning(kLogXrdClHttp, "Could not revalidate URL: %s, error: %s",
+                       url_.c_str(), status.ToStr().c_str());
+    }
+    else {
+      if (modified) {
+        logger_->Warning(kLogXrdClHttp,
+                         "URL %s changed on the server, dropping cached blocks",
+                         url_.c_str());
+      }
+      cache.Validated(cache_url_, CacheValidator(), modified);
+    }
+  }
+
+  return cache.ObjectKey(cache_url_, CacheValidator());
+}
+
+std::pair<int, XRootDStatus> HttpFilePlugIn::FetchRange(void *buffer,
+                                                        uint32_t size,
+                                                        uint64_t offset) {
+  if (size == 0) return std::make_pair(0, XRootDStatus());
+
+  // Served from the block fetched by Open, when it covers the range
+  if (offset < head_.size() &&
+      (offset + size <= head_.size() || head_.size() == filesize)) {
+    const uint32_t length =
+        std::min<uint64_t>(size, head_.size() - offset);
+    std::memcpy(buffer, head_.data() + offset, length);
+    return std::make_pair(static_cast<int>(length), XRootDStatus());
+  }
+
+  const auto object = offset < filesize ? CacheObject() : "";
+  if (object.empty()) {
+    return RemoteRead(buffer, size, offset);
+  }
+
+  auto &cache = HttpBlockCache::Instance();
+  auto &disk_cache = HttpDiskCache::Instance();
+  const uint64_t block_size = cache.GetBlockSize();
+  const uint64_t end = std::min<uint64_t>(offset + size, filesize);
+  const uint64_t first = offset / block_size;
+  const uint64_t last = (end - 1) / block_size;
+
+  std::vector<std::shared_ptr<const HttpBlockCache::Block>> blocks;
+  for (uint64_t index = first; index <= last; ++index) {
+    blocks.push_back(cache.Enabled() ? cache.Get(object, index) : nullptr);
+  }
+
+  // Each run of blocks missing from memory is read from disk or, failing
+  // that, fetched with a single ranged read
+  for (size_t i = 0; i < blocks.size();) {
+    if (blocks[i]) {
+      ++i;
+      continue;
+    }
+    size_t j = i;
+    while (j < blocks.size() && !blocks[j]) ++j;
+
+    const uint64_t run_offset = (first + i) * block_size;
+    const uint64_t run_size =
+        std::min<uint64_t>((first + j) * block_size, filesize) - run_offset;
+    std::vector<char> data(run_size);
+    if (!disk_cache.Enabled() ||
+        !disk_cache.Read(cache_url_, CacheValidator(), filesize, block_size,
+                         run_offset, run_size, data.data())) {
+      auto res = RemoteRead(data.data(), run_size, run_offset);
+      if (res.second.IsError()) {
+        return res;
+      }
+      if (static_cast<uint64_t>(res.first) < run_size) {
+        // Shorter than its stat said, don't cache anything of it
+        return RemoteRead(buffer, size, offset);
+      }
+      if (disk_cache.Enabled()) {
+        disk_cache.Write(cache_url_, CacheValidator(), filesize, block_size,
+                         run_offset, data.data(), run_size);
+      }
+    }
+
+    for (size_t k = i; k < j; ++k) {
+      const uint64_t from = (k - i) * block_size;
+      const uint64_t to = std::min(from + block_size, run_size);
+      auto block = std::make_shared<HttpBlockCache::Block>(
+          data.begin() + from, data.begin() + to);
+      if (cache.Enabled()) cache.Put(object, first + k, block);
+      blocks[k] = block;
+    }
+    i = j;
+  }
+
+  char *output = static_cast<char *>(buffer);
+  for (size_t k = 0; k < blocks.size(); ++k) {
+    const uint64_t block_offset = (first + k) * block_size;
+    const uint64_t from = std::max(offset, block_offset);
+    const uint64_t to = std::min(end, block_offset + blocks[k]->size());
+    std::memcpy(output + (from - offset),
+                blocks[k]->data() + (from - block_offset), to - from);
+  }
+
+  return std::make_pair(static_cast<int>(end - offset), XRootDStatus());
+}
+
+std::pair<int, XRootDStatus> HttpFilePlugIn::ParallelFetch(void *buffer,
+                                                           uint32_t size,
+                                                           uint64_t offset) {
+  const uint64_t streams = ReadStreams();
+  static const uint64_t min_split = std::max<uint64_t>(
+      1, GetEnvUInt(HTTP_FILE_PLUG_IN_READ_SPLIT_ENV, kDefaultReadSplit));
+  // Reads of a file being written share the davix fd, one at a time
+  if (streams < 2 || writable_ || size < 2 * min_split) {
+    return FetchRange(buffer, size, offset);
   }
 
-  is_open_ = false;
-  url_.clear();
+  // Parts are whole cache blocks, so that the caches are filled too
+  const uint64_t block_size = HttpBlockCache::Instance().GetBlockSize();
+  const uint64_t num_parts = std::min<uint64_t>(streams, size / min_split);
+  uint64_t part_size = (size + num_parts - 1) / num_parts;
+  part_size = (part_size + block_size - 1) / block_size * block_size;
+
+  // Sized up front: the tasks keep pointers into it
+  std::vector<std::pair<int, XRootDStatus>> results(
+      (size + part_size - 1) / part_size);
+  std::vector<HttpExecutor::Task> tasks;
+  for (uint64_t from = 0; from < size; from += part_size) {
+    const uint32_t length = std::min<uint64_t>(part_size, size - from);
+    auto *res = &results[from / part_size];
+    tasks.push_back([this, buffer, from, length, offset, res] {
+      for (int attempt = 1; attempt <= kPartAttempts; ++attempt) {
+        if (attempt > 1) HttpMetrics::Instance().Retried();
+        *res = FetchRange(static_cast<char *>(buffer) + from, length,
+                          offset + from);
+        if (res->second.IsOK()) return;
+        logger_->Warning(kLogXrdClHttp,
+                         "Part %u bytes at offset %llu of URL: %s failed "
+                         "(attempt %d): %s",
+                         length, (unsigned long long)(offset + from),
+                         url_.c_str(), attempt, res->second.ToStr().c_str());
+      }
+    });
+  }
+  HttpExecutor::Instance().RunAll(std::move(tasks));
+
+  // Bytes up to the first short part, the way a single read would end
+  int num_bytes_read = 0;
+  for (uint64_t i = 0; i < results.size(); ++i) {
+    if (results[i].second.IsError()) return results[i];
+    num_bytes_read += results[i].first;
+    if (static_cast<uint64_t>(results[i].first) <
+        std::min<uint64_t>(part_size, size - i * part_size))
+      break;
+  }
+  return std::make_pair(num_bytes_read, XRootDStatus());
+}
+
+std::pair<int, XRootDStatus> HttpFilePlugIn::FetchPages(
+    void *buffer, uint32_t size, uint64_t offset,
+    std::vector<uint32_t> *cksums) {
+  std::vector<std::pair<uint64_t, uint32_t>> segments;
+  for (uint64_t from = offset; from < offset + size;) {
+    const uint64_t to = std::min<uint64_t>(
+        offset + size, (from / kPageSegmentSize + 1) * kPageSegmentSize);
+    segments.emplace_back(from, to - from);
+    from = to;
+  }
+  if (cksums) cksums->assign(PageCount(offset, size), 0);
+
+  // Segments are range requests of their own, except for a file being
+  // written, whose reads share the davix fd and are fetched one at a time
+  const uint64_t streams = writable_ ? 1 : std::max<uint64_t>(1, ReadStreams());
+  std::vector<std::pair<int, XRootDStatus>> results(segments.size());
+  std::atomic<size_t> next(0);
+  std::vector<HttpExecutor::Task> lanes(
+      std::min<size_t>(streams, segments.size()),
+      [&] {
+        for (size_t i = next++; i < segments.size(); i = next++) {
+          const uint64_t from = segments[i].first;
+          const uint32_t length = segments[i].second;
+          char *data = static_cast<char *>(buffer) + (from - offset);
+          auto &res = results[i];
+          for (int attempt = 1; attempt <= kPartAttempts; ++attempt) {
+            if (attempt > 1) HttpMetrics::Instance().Retried();
+            res = FetchRange(data, length, from);
+            if (res.second.IsOK()) break;
+            logger_->Warning(kLogXrdClHttp,
+                             "Segment %u bytes at offset %llu of URL: %s "
+                             "failed (attempt %d): %s",
+                             length, (unsigned long long)from, url_.c_str(),
+                             attempt, res.second.ToStr().c_str());
+          }
+          // Checksummed while the other segments are still in flight
+          if (cksums && res.second.IsOK() && res.first > 0) {
+            PageChecksums(from, data, res.first,
+                          cksums->data() + PageCount(offset, from - offset));
+          }
+        }
+      });
+  HttpExecutor::Instance().RunAll(std::move(lanes));
+
+  int num_bytes_read = 0;
+  for (size_t i = 0; i < results.size(); ++i) {
+    if (results[i].second.IsError()) return results[i];
+    num_bytes_read += results[i].first;
+    if (static_cast<uint32_t>(results[i].first) < segments[i].second) break;
+  }
+  if (cksums) cksums->resize(PageCount(offset, num_bytes_read));
+  return std::make_pair(num_bytes_read, XRootDStatus());
+}
 
-  handler->HandleResponse(new XRootDStatus(), nullptr);
+XRootDStatus HttpFilePlugIn::Close(ResponseHandler *handler,
+                                   uint16_t /*timeout*/) {
+  {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    if (state_ != State::kOpen) {
+      logger_->Error(kLogXrdClHttp,
+                     "Cannot close. URL hasn't been previously opened");
+      return XRootDStatus(stError, errInvalidOp);
+    }
+    // No new operation starts from now on. Operations still running use
+    // what Close tears down: the last of them submits it.
+    state_ = State::kClosing;
+    if (in_flight_ > 0) {
+      close_handler_ = handler;
+      return XRootDStatus();
+    }
+    ++in_flight_;
+  }
 
+  SubmitClose(handler);
   return XRootDStatus();
 }
 
-XRootDStatus HttpFilePlugIn::Stat(bool /*force*/, ResponseHandler *handler,
+void HttpFilePlugIn::SubmitClose(ResponseHandler *handler) {
+  strand_.Submit([this, handler] {
+    Operation operation(this);
+    // No background read may touch the fd past this point
+    if (read_ahead_) read_ahead_->Shutdown();
+    stream_read_.reset();
+
+    XRootDStatus status;
+    // An upload is over once closed, failed or not: closing again must not
+    // go through EnsureOpen and write an empty file over the destination
+    bool upload_ended = false;
+    if (s3_upload_) {
+      status = s3_upload_->Close();
+      s3_upload_.reset();
+      upload_ended = true;
+    }
+    else if (stream_upload_) {
+      status = stream_upload_->Close();
+      stream_upload_.reset();
+      upload_ended = true;
+    }
+    // Without any write the upload still has to create the empty file
+    else if (writable_) {
+      status = EnsureOpen(0);
+    }
+    if (davix_fd_) {
+      logger_->Debug(kLogXrdClHttp, "Closing davix fd: %ld", davix_fd_);
+      auto close_status = Posix::Close(*davix_client_, davix_fd_);
+      if (status.IsOK()) status = close_status;
+    }
+    // The upload completes on close
+    if (writable_) HttpStatCache::Instance().Invalidate(url_);
+    if (status.IsError()) {
+      logger_->Error(kLogXrdClHttp, "Could not close davix fd: %ld, error: %s",
+                     davix_fd_, status.ToStr().c_str());
+    }
+    const bool closed = status.IsOK() || upload_ended;
+    if (closed) {
+      davix_fd_ = nullptr;
+      url_.clear();
+      head_.clear();
+      replicas_.clear();
+    }
+    {
+      std::lock_guard<std::mutex> lock(state_mutex_);
+      state_ = closed ? State::kClosed : State::kOpen;
+    }
+
+    HttpExecutor::Instance().Complete(handler, new XRootDStatus(status));
+  });
+}
+
+XRootDStatus HttpFilePlugIn::Stat(bool force, ResponseHandler *handler,
                                   uint16_t timeout) {
-  if (!is_open_) {
+  if (!BeginOperation()) {
     logger_->Error(kLogXrdClHttp,
                    "Cannot stat. URL hasn't been previously opened");
     return XRootDStatus(stError, errInvalidOp);
   }
 
-  auto stat_info = new StatInfo();
-  auto status = Posix::Stat(*davix_client_, url_, timeout, stat_info);
-  // A file that is_open_ = true should not retune 400/3011. the only time this
-  // happen is a newly created file. Davix doesn't issue a http PUT so this file
-  // won't show up for Stat(). Here we fake a response.
-  if (status.IsError() && status.code == 400 && status.errNo == 3011) {
-    std::ostringstream data;
-    data << 140737018595560 << " " << filesize << " " << 33261 << " " << time(NULL);
-    stat_info->ParseServerResponse(data.str().c_str());
-  }
-  else if (status.IsError()) {
-    logger_->Error(kLogXrdClHttp, "Stat failed: %s", status.ToStr().c_str());
-    return status;
-  }
+  handler = HttpMetrics::Instance().Track(HttpMetrics::kStat, handler);
+  const auto queued = HttpTrace::Clock::now();
+
+  HttpExecutor::Instance().Submit([this, force, handler, timeout, queued] {
+    Operation operation(this);
+    HttpTrace trace("stat", url_, queued);
+    StatInfo *stat_info = nullptr;
+    auto status = HttpStatCache::Instance().Stat(*davix_client_, url_, timeout,
+                                                 force, &stat_info);
+    // A file that is_open_ = true should not retune 400/3011. the only time this
+    // happen is a newly created file. Davix doesn't issue a http PUT so this file
+    // won't show up for Stat(). Here we fake a response.
+    if (status.IsError() && status.code == 400 && status.errNo == 3011) {
+      stat_info = new StatInfo();
+      std::ostringstream data;
+      data << 140737018595560 << " " << filesize << " " << 33261 << " " << time(NULL);
+      stat_info->ParseServerResponse(data.str().c_str());
+    }
+    else if (status.IsError()) {
+      logger_->Error(kLogXrdClHttp, "Stat failed: %s", status.ToStr().c_str());
+      HttpExecutor::Instance().Complete(handler, new XRootDStatus(status));
+      return;
+    }
 
-  logger_->Debug(kLogXrdClHttp, "Stat-ed URL: %s", url_.c_str());
+    logger_->Debug(kLogXrdClHttp, "Stat-ed URL: %s", url_.c_str());
 
-  auto obj = new AnyObject();
-  obj->Set(stat_info);
+    auto obj = new AnyObject();
+    obj->Set(stat_info);
 
-  handler->HandleResponse(new XRootDStatus(), obj);
+    HttpExecutor::Instance().Complete(handler, new XRootDStatus(), obj);
+  });
 
   return XRootDStatus();
 }
@@ -237,47 +855,51 @@ XRootDStatus HttpFilePlugIn::Stat(bool /*force*/, ResponseHandler *handler,
 XRootDStatus HttpFilePlugIn::Read(uint64_t offset, uint32_t size, void *buffer,
                                   ResponseHandler *handler,
                                   uint16_t /*timeout*/) {
-  if (!is_open_) {
+  if (!BeginOperation()) {
     logger_->Error(kLogXrdClHttp,
                    "Cannot read. URL hasn't previously been opened");
     return XRootDStatus(stError, errInvalidOp);
   }
 
-  // DavPosix::pread will return -1 if the pread goes beyond the file size
-  size = (offset + size > filesize)? filesize - offset : size;
-  std::pair<int, XRootDStatus> res;
-  if (! avoid_pread_) {
-    res = Posix::PRead(*davix_client_, davix_fd_, buffer, size, offset);
-  }
-  else { 
-    offset_locker.lock();
-    if (offset == curr_offset) {
-      res = Posix::Read(*davix_client_, davix_fd_, buffer, size);
+  handler = HttpMetrics::Instance().Track(
+      HttpMetrics::kRead, handler,
+      offset < filesize ? std::min<uint64_t>(size, filesize - offset) : 0);
+  const auto queued = HttpTrace::Clock::now();
+
+  HttpExecutor::Instance().Submit([this, offset, size, buffer, handler,
+                                   queued] {
+    Operation operation(this);
+    HttpTrace trace("read", url_, queued);
+    // DavPosix::pread will return -1 if the pread goes beyond the file size
+    const uint64_t end = filesize;
+    uint32_t len =
+        offset < end ? std::min<uint64_t>(size, end - offset) : 0;
+    std::pair<int, XRootDStatus> res;
+    if (stream_read_) {
+      res = stream_read_->Read(offset, len, buffer);
     }
-    else {
-      res = Posix::PRead(*davix_client_, davix_fd_, buffer, size, offset);
+    else if (!read_ahead_ || !read_ahead_->Read(offset, len, buffer, res)) {
+      res = ParallelFetch(buffer, len, offset);
     }
-  }
 
-  if (res.second.IsError()) {
-    logger_->Error(kLogXrdClHttp, "Could not read URL: %s, error: %s",
-                   url_.c_str(), res.second.ToStr().c_str());
-    if (avoid_pread_) offset_locker.unlock();
-    return res.second;
-  }
+    if (res.second.IsError()) {
+      logger_->Error(kLogXrdClHttp, "Could not read URL: %s, error: %s",
+                     url_.c_str(), res.second.ToStr().c_str());
+      HttpExecutor::Instance().Complete(handler, new XRootDStatus(res.second));
+      return;
+    }
 
-  int num_bytes_read = res.first;
-  curr_offset = offset + num_bytes_read;
-  if (avoid_pread_) offset_locker.unlock();
+    int num_bytes_read = res.first;
 
-  logger_->Debug(kLogXrdClHttp, "Read %d bytes, at offset %d, from URL: %s",
-                 num_bytes_read, offset, url_.c_str());
+    logger_->Debug(kLogXrdClHttp, "Read %d bytes, at offset %d, from URL: %s",
+                   num_bytes_read, offset, url_.c_str());
 
-  auto status = new XRootDStatus();
-  auto chunk_info = new ChunkInfo(offset, num_bytes_read, buffer);
-  auto obj = new AnyObject();
-  obj->Set(chunk_info);
-  handler->HandleResponse(status, obj);
+    auto status = new XRootDStatus();
+    auto chunk_info = new ChunkInfo(offset, num_bytes_read, buffer);
+    auto obj = new AnyObject();
+    obj->Set(chunk_info);
+    HttpExecutor::Instance().Complete(handler, status, obj);
+  });
 
   return XRootDStatus();
 }
@@ -310,23 +932,9 @@ class PgReadSubstitutionHandler : public XrdCl::ResponseHandler {
     std::vector<uint32_t> cksums;
     if( isChannelEncrypted )
     {
-      size_t nbpages = chunk->length / XrdSys::PageSize;
-      if( chunk->length % XrdSys::PageSize )
-        ++nbpages;
-      cksums.reserve( nbpages );
-
-      size_t  size = chunk->length;
-      char   *buffer = reinterpret_cast<char*>( chunk->buffer );
-
-      for( size_t pg = 0; pg < nbpages; ++pg )
-      {
-        size_t pgsize = XrdSys::PageSize;
-        if( pgsize > size ) pgsize = size;
-        uint32_t crcval = XrdOucCRC::Calc32C( buffer, pgsize );
-        cksums.push_back( crcval );
-        buffer += pgsize;
-        size   -= pgsize;
-      }
+      cksums.resize( PageCount( chunk->offset, chunk->length ) );
+      ParallelPageChecksums( chunk->offset, chunk->buffer, chunk->length,
+                             cksums.data() );
     }
 
     PageInfo *pages = new PageInfo(chunk->offset, chunk->length, chunk->buffer, std::move(cksums));
@@ -342,6 +950,44 @@ class PgReadSubstitutionHandler : public XrdCl::ResponseHandler {
 XRootDStatus HttpFilePlugIn::PgRead(uint64_t offset, uint32_t size, void *buffer,
                                     ResponseHandler *handler,
                                     uint16_t timeout) {
+  if (!avoid_pread_ && size >= 2 * kPageSegmentSize && BeginOperation()) {
+    // Counted as a read, as the smaller PgReads served by Read() are
+    handler = HttpMetrics::Instance().Track(
+        HttpMetrics::kRead, handler,
+        offset < filesize ? std::min<uint64_t>(size, filesize - offset) : 0);
+    const auto queued = HttpTrace::Clock::now();
+    HttpExecutor::Instance().Submit([this, offset, size, buffer, handler,
+                                     queued] {
+      Operation operation(this);
+      HttpTrace trace("pgread", url_, queued);
+      // Nothing left to read past the end of the file
+      const uint64_t end = filesize;
+      uint32_t len =
+          offset < end ? std::min<uint64_t>(size, end - offset) : 0;
+      std::vector<uint32_t> cksums;
+      auto res = FetchPages(buffer, len, offset,
+                            isChannelEncrypted ? &cksums : nullptr);
+      if (res.second.IsError()) {
+        logger_->Error(kLogXrdClHttp, "Could not read URL: %s, error: %s",
+                       url_.c_str(), res.second.ToStr().c_str());
+        HttpExecutor::Instance().Complete(handler,
+                                          new XRootDStatus(res.second));
+        return;
+      }
+
+      logger_->Debug(kLogXrdClHttp,
+                     "PgRead %d bytes, at offset %d, from URL: %s", res.first,
+                     offset, url_.c_str());
+
+      auto pages =
+          new PageInfo(offset, res.first, buffer, std::move(cksums));
+      auto obj = new AnyObject();
+      obj->Set(pages);
+      HttpExecutor::Instance().Complete(handler, new XRootDStatus(), obj);
+    });
+    return XRootDStatus();
+  }
+
   ResponseHandler *substitHandler = new PgReadSubstitutionHandler( handler, isChannelEncrypted );
   XRootDStatus st = Read(offset, size, buffer, substitHandler, timeout);
   return st;
@@ -350,90 +996,207 @@ XRootDStatus HttpFilePlugIn::PgRead(uint64_t offset, uint32_t size, void *buffer
 XRootDStatus HttpFilePlugIn::Write(uint64_t offset, uint32_t size,
                                    const void *buffer, ResponseHandler *handler,
                                    uint16_t timeout) {
-  if (!is_open_) {
+  if (!BeginOperation()) {
     logger_->Error(kLogXrdClHttp,
                    "Cannot write. URL hasn't previously been opened");
     return XRootDStatus(stError, errInvalidOp);
   }
 
-  // res == std::pair<int, XRootDStatus>
-  auto res =
-      Posix::PWrite(*davix_client_, davix_fd_, offset, size, buffer, timeout);
-  if (res.second.IsError()) {
-    logger_->Error(kLogXrdClHttp, "Could not write URL: %s, error: %s",
-                   url_.c_str(), res.second.ToStr().c_str());
-    return res.second;
-  }
-  else
-    filesize += res.first;
+  handler = HttpMetrics::Instance().Track(HttpMetrics::kWrite, handler, size);
+  const auto queued = HttpTrace::Clock::now();
+
+  strand_.Submit([this, offset, size, buffer, handler, timeout, queued] {
+    Operation operation(this);
+    HttpTrace trace("write", url_, queued);
+
+    // res == std::pair<int, XRootDStatus>
+    std::pair<int, XRootDStatus> res;
+    if (s3_upload_) {
+      res = std::make_pair(size, s3_upload_->Write(offset, buffer, size));
+    }
+    else if (stream_upload_) {
+      res = std::make_pair(size, stream_upload_->Write(offset, buffer, size));
+    }
+    else {
+      auto status = EnsureOpen(timeout);
+      if (status.IsError())
+        res = std::make_pair(-1, status);
+      else
+        res = Posix::PWrite(*davix_client_, davix_fd_, offset, size, buffer,
+                            timeout);
+    }
+    if (res.second.IsError()) {
+      logger_->Error(kLogXrdClHttp, "Could not write URL: %s, error: %s",
+                     url_.c_str(), res.second.ToStr().c_str());
+      HttpExecutor::Instance().Complete(handler, new XRootDStatus(res.second));
+      return;
+    }
+    else
+      filesize += res.first;
 
-  logger_->Debug(kLogXrdClHttp, "Wrote %d bytes, at offset %d, to URL: %s",
-                 res.first, offset, url_.c_str());
+    logger_->Debug(kLogXrdClHttp, "Wrote %d bytes, at offset %d, to URL: %s",
+                   res.first, offset, url_.c_str());
 
-  handler->HandleResponse(new XRootDStatus(), nullptr);
+    HttpExecutor::Instance().Complete(handler, new XRootDStatus());
+  });
 
   return XRootDStatus();
 }
 
 XRootDStatus HttpFilePlugIn::Sync(ResponseHandler *handler, uint16_t timeout) {
-  (void)handler;
   (void)timeout;
 
   logger_->Debug(kLogXrdClHttp, "Sync is a no-op for HTTP.");
 
+  // Still goes through the strand so that the response only arrives once
+  // all previously submitted writes have been handed to Davix
+  strand_.Submit([handler] {
+    HttpExecutor::Instance().Complete(handler, new XRootDStatus());
+  });
+
   return XRootDStatus();
 }
 
 XRootDStatus HttpFilePlugIn::VectorRead(const ChunkList &chunks, void *buffer,
                                         ResponseHandler *handler,
                                         uint16_t /*timeout*/) {
-  if (!is_open_) {
+  // Chunks without a buffer of their own land in buffer, packed in the
+  // order of the list; the response reports where each chunk went
+  ChunkList placed(chunks);
+  uint64_t packed = 0;
+  for (auto &chunk : placed) {
+    if (!chunk.buffer) {
+      if (!buffer) {
+        logger_->Error(kLogXrdClHttp,
+                       "Cannot vectorRead a chunk with no buffer to land in");
+        return XRootDStatus(stError, errInvalidArgs);
+      }
+      chunk.buffer = static_cast<char *>(buffer) + packed;
+    }
+    packed += chunk.length;
+  }
+
+  if (!BeginOperation()) {
     logger_->Error(kLogXrdClHttp,
                    "Cannot read. URL hasn't previously been opened");
     return XRootDStatus(stError, errInvalidOp);
   }
 
-  const auto num_chunks = chunks.size();
-  std::vector<Davix::DavIOVecInput> input_vector(num_chunks);
-  std::vector<Davix::DavIOVecOuput> output_vector(num_chunks);
+  handler =
+      HttpMetrics::Instance().Track(HttpMetrics::kVectorRead, handler, packed);
+  const auto queued = HttpTrace::Clock::now();
+
+  HttpExecutor::Instance().Submit([this, placed, handler, queued] {
+    Operation operation(this);
+    HttpTrace trace("vector read", url_, queued);
+    // Chunks fully present in the block caches need no request
+    const auto object = CacheObject();
+    ChunkList remote_chunks;
+    int num_cached_bytes = 0;
+    for (const auto &chunk : placed) {
+      if (!object.empty() &&
+          ((HttpBlockCache::Instance().Enabled() &&
+            HttpBlockCache::Instance().Read(object, chunk.offset,
+                                            chunk.length, chunk.buffer)) ||
+           (HttpDiskCache::Instance().Enabled() &&
+            HttpDiskCache::Instance().Read(
+                cache_url_, CacheValidator(), filesize,
+                HttpBlockCache::Instance().GetBlockSize(), chunk.offset,
+                chunk.length, chunk.buffer)))) {
+        num_cached_bytes += chunk.length;
+      }
+      else {
+        remote_chunks.push_back(chunk);
+      }
+    }
 
-  for (size_t i = 0; i < num_chunks; ++i) {
-    input_vector[i].diov_offset = chunks[i].offset;
-    input_vector[i].diov_size = chunks[i].length;
-    input_vector[i].diov_buffer = chunks[i].buffer;
-  }
+    // res == std::pair<int, XRootDStatus>
+    std::pair<int, XRootDStatus> res(0, XRootDStatus());
+    if (!remote_chunks.empty()) res = VectorFetch(remote_chunks);
+    if (res.second.IsError()) {
+      logger_->Error(kLogXrdClHttp, "Could not vectorRead URL: %s, error: %s",
+                     url_.c_str(), res.second.ToStr().c_str());
+      HttpExecutor::Instance().Complete(handler, new XRootDStatus(res.second));
+      return;
+    }
 
-  // res == std::pair<int, XRootDStatus>
-  auto res = Posix::PReadVec(*davix_client_, davix_fd_, chunks, buffer);
-  if (res.second.IsError()) {
-    logger_->Error(kLogXrdClHttp, "Could not vectorRead URL: %s, error: %s",
-                   url_.c_str(), res.second.ToStr().c_str());
-    return res.second;
-  }
+    int num_bytes_read = res.first + num_cached_bytes;
 
-  int num_bytes_read = res.first;
+    logger_->Debug(kLogXrdClHttp, "VecRead %d bytes, from URL: %s",
+                   num_bytes_read, url_.c_str());
 
-  logger_->Debug(kLogXrdClHttp, "VecRead %d bytes, from URL: %s",
-                 num_bytes_read, url_.c_str());
+    auto status = new XRootDStatus();
+    auto read_info = new VectorReadInfo();
+    read_info->SetSize(num_bytes_read);
+    read_info->GetChunks() = placed;
+    auto obj = new AnyObject();
+    obj->Set(read_info);
+    HttpExecutor::Instance().Complete(handler, status, obj);
+  });
 
-  char *output = static_cast<char *>(buffer);
-  for (size_t i = 0; i < num_chunks; ++i) {
-    std::memcpy(output + input_vector[i].diov_offset,
-                output_vector[i].diov_buffer, output_vector[i].diov_size);
+  return XRootDStatus();
+}
+
+std::pair<int, XRootDStatus> HttpFilePlugIn::VectorFetch(
+    const ChunkList &chunks) {
+  // Multi-range requests would be answered with the whole object each time
+  if (stream_read_) {
+    int num_bytes_read = 0;
+    for (const auto &chunk : chunks) {
+      auto res = stream_read_->Read(chunk.offset, chunk.length, chunk.buffer);
+      if (res.second.IsError()) return res;
+      num_bytes_read += res.first;
+    }
+    return std::make_pair(num_bytes_read, XRootDStatus());
   }
 
-  auto status = new XRootDStatus();
-  auto read_info = new VectorReadInfo();
-  read_info->SetSize(num_bytes_read);
-  read_info->GetChunks() = chunks;
-  auto obj = new AnyObject();
-  obj->Set(read_info);
-  handler->HandleResponse(status, obj);
+  auto &planner = HttpVectorPlanner::Instance();
+  const auto batches = planner.Plan(chunks);
+
+  // Each lane takes the next batch until none is left
+  std::vector<XRootDStatus> results(batches.size());
+  std::atomic<size_t> next(0);
+  std::vector<HttpExecutor::Task> lanes(
+      std::min<size_t>(planner.GetFanOut(), batches.size()),
+      [this, &chunks, &batches, &results, &next] {
+        for (size_t i = next++; i < batches.size(); i = next++)
+          results[i] = ReadBatch(chunks, batches[i]);
+      });
+  HttpExecutor::Instance().RunAll(std::move(lanes));
+
+  int num_bytes_read = 0;
+  for (const auto &result : results) {
+    if (result.IsError()) return std::make_pair(-1, result);
+  }
+  for (const auto &chunk : chunks) num_bytes_read += chunk.length;
+  return std::make_pair(num_bytes_read, XRootDStatus());
+}
 
-  return XRootDStatus();
+XRootDStatus HttpFilePlugIn::ReadBatch(const ChunkList &chunks,
+                                       const HttpVectorPlanner::Batch &batch) {
+  // Every byte lands straight in its chunk's buffer
+  ChunkList targets;
+  std::vector<std::pair<uint64_t, uint64_t>> ranges;
+  for (const auto &range : batch) {
+    ranges.emplace_back(range.offset, range.length);
+    for (auto index : range.chunks) targets.push_back(chunks[index]);
+  }
+
+  if (HttpHedge::Instance().Enabled() || !replicas_.empty()) {
+    return RangeRead(targets, ranges, true);
+  }
+
+  HttpRangeReader reader(targets);
+  auto status = Posix::ReadRanges(*davix_context_, url_, 0, ranges, reader);
+  HttpVectorPlanner::Instance().Delivered(reader.BytesCopied(),
+                                          reader.BytesDiscarded());
+  return status;
 }
 
-bool HttpFilePlugIn::IsOpen() const { return is_open_; }
+bool HttpFilePlugIn::IsOpen() const {
+  std::lock_guard<std::mutex> lock(state_mutex_);
+  return state_ == State::kOpen || state_ == State::kClosing;
+}
 
 bool HttpFilePlugIn::SetProperty(const std::string &name,
                                  const std::string &value) {
@@ -443,6 +1206,49 @@ bool HttpFilePlugIn::SetProperty(const std::string &name,
 
 bool HttpFilePlugIn::GetProperty(const std::string &name,
                                  std::string &value) const {
+  if (name == HTTP_PLUG_IN_SESSION_STATS_PROPERTY) {
+    value = HttpSessionPool::Instance().GetStatistics();
+    return true;
+  }
+  if (name == HTTP_PLUG_IN_CACHE_STATS_PROPERTY) {
+    value = HttpBlockCache::Instance().GetStatistics();
+    return true;
+  }
+  if (name == HTTP_PLUG_IN_DISKCACHE_STATS_PROPERTY) {
+    value = HttpDiskCache::Instance().GetStatistics();
+    return true;
+  }
+  if (name == HTTP_PLUG_IN_STATCACHE_STATS_PROPERTY) {
+    value = HttpStatCache::Instance().GetStatistics();
+    return true;
+  }
+  if (name == HTTP_PLUG_IN_REPLICA_STATS_PROPERTY) {
+    value = HttpReplicas::Instance().GetStatistics();
+    return true;
+  }
+  if (name == HTTP_PLUG_IN_HEDGE_STATS_PROPERTY) {
+    value = HttpHedge::Instance().GetStatistics();
+    return true;
+  }
+  if (name == HTTP_PLUG_IN_VECTOR_STATS_PROPERTY) {
+    value = HttpVectorPlanner::Instance().GetStatistics();
+    return true;
+  }
+  if (name == HTTP_PLUG_IN_STREAM_STATS_PROPERTY) {
+    if (!stream_read_) return false;
+    value = stream_read_->GetStatistics();
+    return true;
+  }
+  if (name == HTTP_PLUG_IN_READAHEAD_STATS_PROPERTY) {
+    if (!read_ahead_) return false;
+    value = read_ahead_->GetStatistics();
+    return true;
+  }
+  if (name == HTTP_PLUG_IN_METRICS_PROPERTY) {
+    value = HttpMetrics::Instance().GetStatistics();
+    return true;
+  }
+
   const auto p = properties_.find(name);
   if (p == std::end(properties_)) {
     return false;
@@ -11,10 +11,21 @@
 #include "XrdCl/XrdClFileSystem.hh"
 #include "XrdCl/XrdClPlugInInterface.hh"
 
+#include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <ctime>
 #include <limits>
 #include <mutex>
+#include <memory>
 #include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "HttpExecutor.hh"
+#include "HttpHedge.hh"
+#include "HttpReplicas.hh"
+#include "HttpVectorPlanner.hh"
 
 // Indicate desire to avoid http "Range: bytes=234-567" header
 // Some HTTP(s) data source does not honor Range request, and always start from
@@ -26,9 +37,23 @@
 // 2. via CGI in URl, this only affect the associated URL
 #define HTTP_FILE_PLUG_IN_AVOIDRANGE_CGI "xrdclhttp_avoidrange"
 
+// CGI with the expected size of a file opened for writing, set by xrdcp
+#define HTTP_FILE_PLUG_IN_ASIZE_CGI "oss.asize"
+
+// Number of concurrent range requests a large read is split into, 1 disables
+// splitting
+#define HTTP_FILE_PLUG_IN_READ_STREAMS_ENV "XRDCLHTTP_READ_STREAMS"
+// Smallest part in bytes a large read is split into
+#define HTTP_FILE_PLUG_IN_READ_SPLIT_ENV "XRDCLHTTP_READ_SPLIT_MIN"
+
 namespace XrdCl {
 
+class HttpReadAhead;
+class HttpS3Upload;
+class HttpStreamRead;
+class HttpStreamUpload;
 class Log;
+struct HttpSession;
 
 class HttpFilePlugIn : public FilePlugIn {
  public:
@@ -117,24 +142,189 @@ class HttpFilePlugIn : public FilePlugIn {
 
  private:
 
+  //------------------------------------------------------------------------
+  //! Count an operation about to be submitted, for Close and the destructor
+  //! to wait for. Fails unless the file is open.
+  //------------------------------------------------------------------------
+  bool BeginOperation();
+
+  //------------------------------------------------------------------------
+  //! Ends the counted operation of a task when going out of scope, the last
+  //! thing the task does with the file
+  //------------------------------------------------------------------------
+  class Operation {
+   public:
+    explicit Operation( HttpFilePlugIn *file ) : file_( file ) {}
+    ~Operation();
+
+   private:
+    HttpFilePlugIn *file_;
+  };
+
+  //------------------------------------------------------------------------
+  //! Tear the file down on the strand, once no operation is in flight
+  //------------------------------------------------------------------------
+  void SubmitClose( ResponseHandler *handler );
+
+  //------------------------------------------------------------------------
+  //! The Open sequence, run as a single job on the file's strand. Takes as
+  //! few round trips as possible: a known parent directory is not created
+  //! again, reads learn the file size from a ranged GET of the first block
+  //! and the davix fd is only opened when first needed.
+  //------------------------------------------------------------------------
+  XRootDStatus DoOpen( const std::string &url,
+                       OpenFlags::Flags   flags,
+                       uint16_t           timeout );
+
+  //------------------------------------------------------------------------
+  //! Open the davix fd, if not done yet
+  //------------------------------------------------------------------------
+  XRootDStatus EnsureOpen( uint16_t timeout );
+
+  //------------------------------------------------------------------------
+  //! A single-range RangeRead, or, for a file opened for writing,
+  //! Posix::PRead on the davix fd, opening it first if needed
+  //------------------------------------------------------------------------
+  std::pair<int, XRootDStatus> RemoteRead( void     *buffer,
+                                           uint32_t  size,
+                                           uint64_t  offset );
+
+  //------------------------------------------------------------------------
+  //! Hand the first block, fetched by Open, to the shared block caches
+  //------------------------------------------------------------------------
+  void SeedCaches();
+
+  //------------------------------------------------------------------------
+  //! Ranged read going through the shared block caches (memory, then
+  //! disk), same contract as Posix::PRead
+  //------------------------------------------------------------------------
+  std::pair<int, XRootDStatus> FetchRange( void     *buffer,
+                                           uint32_t  size,
+                                           uint64_t  offset );
+
+  //------------------------------------------------------------------------
+  //! FetchRange, split into concurrent range requests for large reads.
+  //! Each part lands directly at its place in buffer and is retried on its
+  //! own if it fails.
+  //------------------------------------------------------------------------
+  std::pair<int, XRootDStatus> ParallelFetch( void     *buffer,
+                                              uint32_t  size,
+                                              uint64_t  offset );
+
+  //------------------------------------------------------------------------
+  //! Large PgRead: page-aligned segments fetched concurrently, each one's
+  //! page checksums computed as soon as it has arrived. cksums may be null
+  //! when no checksums are wanted.
+  //------------------------------------------------------------------------
+  std::pair<int, XRootDStatus> FetchPages( void                  *buffer,
+                                           uint32_t               size,
+                                           uint64_t               offset,
+                                           std::vector<uint32_t> *cksums );
+
+  //------------------------------------------------------------------------
+  //! Remote part of a VectorRead: chunks planned into multi-range requests
+  //! by HttpVectorPlanner, run concurrently up to its fan-out
+  //------------------------------------------------------------------------
+  std::pair<int, XRootDStatus> VectorFetch( const ChunkList &chunks );
+
+  //------------------------------------------------------------------------
+  //! One request of a planned VectorRead, its answer read straight into
+  //! the chunk buffers
+  //------------------------------------------------------------------------
+  XRootDStatus ReadBatch( const ChunkList                 &chunks,
+                          const HttpVectorPlanner::Batch  &batch );
+
+  //------------------------------------------------------------------------
+  //! One GET for ranges into targets, hedged by HttpHedge and, when the
+  //! file has replicas, failing over from one replica to the next
+  //------------------------------------------------------------------------
+  XRootDStatus RangeRead(
+      const ChunkList                                  &targets,
+      const std::vector<std::pair<uint64_t, uint64_t>> &ranges,
+      bool                                              vector_read );
+
+  //------------------------------------------------------------------------
+  //! HttpHedge attempt at one GET for ranges from replica, scored in
+  //! HttpReplicas. It holds on to the session, as a losing attempt may
+  //! still run after this file is gone.
+  //------------------------------------------------------------------------
+  static HttpHedge::Attempt RangeAttempt(
+      const HttpReplicas::Replica                      &replica,
+      const std::vector<std::pair<uint64_t, uint64_t>> &ranges,
+      bool                                              vector_read );
+
+  //------------------------------------------------------------------------
+  //! Look up the replicas of the file, from its Metalink, and rank them
+  //------------------------------------------------------------------------
+  void FindReplicas( uint16_t timeout );
+
+  //------------------------------------------------------------------------
+  //! Key of this file in the shared block caches, revalidating the cached
+  //! blocks when due. Empty if the caches can't be used for this file.
+  //------------------------------------------------------------------------
+  std::string CacheObject();
+
+  //------------------------------------------------------------------------
+  //! Identifies the version of the file the cached blocks belong to
+  //------------------------------------------------------------------------
+  std::string CacheValidator() const;
+
+  // Shared with every other file on the same endpoint, see HttpSessionPool
+  std::shared_ptr<HttpSession> session_;
   Davix::Context *davix_context_;
   Davix::DavPosix *davix_client_;
 
+  // Opened lazily by EnsureOpen(), with these flags
+  std::mutex fd_mutex_;
   DAVIX_FD* davix_fd_;
-
-  std::mutex offset_locker;
-  uint64_t curr_offset;
+  int posix_open_flags_;
 
   bool avoid_pread_;
+  // Single GET serving all reads when the server doesn't do Range
+  std::unique_ptr<HttpStreamRead> stream_read_;
+
+  // Multipart upload replacing the davix fd for files written to S3
+  std::shared_ptr<HttpS3Upload> s3_upload_;
+  // PUT streamed as the file is written, for other servers
+  std::unique_ptr<HttpStreamUpload> stream_upload_;
+
+  // Sequential read-ahead, set up by Open for files opened for reading
+  std::shared_ptr<HttpReadAhead> read_ahead_;
   bool isChannelEncrypted;
 
-  bool is_open_;
-  uint64_t filesize;
+  enum class State { kClosed, kOpening, kOpen, kClosing };
+  // Guards state_ and in_flight_
+  mutable std::mutex state_mutex_;
+  std::condition_variable state_cond_;
+  State state_;
+  // Operations submitted and not finished yet, tasks using this file
+  unsigned in_flight_;
+  // Close waiting for the operations in flight to finish
+  ResponseHandler *close_handler_;
+
+  // Opened for writing; our writes invalidate the cached stat of the file
+  bool writable_;
+  // Grown by writes while reads run
+  std::atomic<uint64_t> filesize;
+  time_t filemtime_;
+  // First block of the file, read by Open along with its size
+  std::vector<char> head_;
 
   std::string url_;
+  // Endpoint of url_, whose answer latencies HttpHedge tracks
+  std::string host_;
+  // Replicas of the file, best first, when HttpReplicas is enabled and the
+  // server lists more than one; reads go to replicas_[replica_]
+  std::vector<HttpReplicas::Replica> replicas_;
+  std::atomic<size_t> replica_;
+  // Sanitized url_, the block cache key
+  std::string cache_url_;
 
   std::unordered_map<std::string, std::string> properties_;
 
+  // Serializes Open, Write, Sync and Close; reads run concurrently
+  HttpExecutor::Strand strand_;
+
   Log* logger_;
 };
 
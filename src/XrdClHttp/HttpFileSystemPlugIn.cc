@@ -4,6 +4,7 @@
 
 #include "HttpFileSystemPlugIn.hh"
 
+#include <algorithm>
 #include <mutex>
 
 #include "davix.hpp"
@@ -12,46 +13,41 @@
 #include "XrdCl/XrdClLog.hh"
 #include "XrdCl/XrdClXRootDResponses.hh"
 
+#include "HttpDirCrawler.hh"
+#include "HttpExecutor.hh"
 #include "HttpFilePlugIn.hh"
+#include "HttpMetrics.hh"
 #include "HttpPlugInUtil.hh"
+#include "HttpS3List.hh"
+#include "HttpSessionPool.hh"
+#include "HttpStatCache.hh"
+#include "HttpTrace.hh"
 #include "Posix.hh"
 
-namespace XrdCl {
+namespace {
+
+const uint64_t kDefaultListBatch = 10000;
 
-Davix::Context *root_ctx_ = NULL;
-Davix::DavPosix *root_davix_client_ = NULL;
+}  // namespace
+
+namespace XrdCl {
 
 HttpFileSystemPlugIn::HttpFileSystemPlugIn(const std::string &url)
-    : url_(url), logger_(DefaultEnv::GetLog()) {
+    : url_(url),
+      endpoint_(url_.GetProtocol() + "://" + url_.GetHostName() + ":" +
+                std::to_string(url_.GetPort())),
+      logger_(DefaultEnv::GetLog()) {
   SetUpLogging(logger_);
   logger_->Debug(kLogXrdClHttp,
                  "HttpFileSystemPlugIn constructed with URL: %s.",
                  url_.GetURL().c_str());
-  std::string origin = getenv("XRDXROOTD_PROXY")? getenv("XRDXROOTD_PROXY") : "";
-  if ( origin.empty() || origin.find("=") == 0) {
-      ctx_ = new Davix::Context();
-      davix_client_ = new Davix::DavPosix(ctx_);
-  }
-  else {
-      if (root_ctx_ == NULL) {
-          root_ctx_ = new Davix::Context();
-          root_davix_client_ = new Davix::DavPosix(root_ctx_); 
-      }
-      ctx_ = root_ctx_;
-      davix_client_ = root_davix_client_;
-  }
+  session_ = HttpSessionPool::Instance().Acquire(url_);
 }
 
-// destructor of davix_client_ or ctx_ will call something in ssl3 lib
-// which reset errno. We need to preserve errno so that XrdPssSys::Stat
-// will see it.
+// Releasing the last reference to a session may destroy its Davix context,
+// which calls something in ssl3 lib that resets errno. HttpSessionPool
+// preserves errno so that XrdPssSys::Stat will see it.
 HttpFileSystemPlugIn::~HttpFileSystemPlugIn() noexcept {
-    int rc = errno;
-    if (root_ctx_ == NULL) {
-        delete davix_client_;
-        delete ctx_;
-    }
-    errno = rc;
 }
 
 XRootDStatus HttpFileSystemPlugIn::Mv(const std::string &source,
@@ -60,28 +56,33 @@ XRootDStatus HttpFileSystemPlugIn::Mv(const std::string &source,
                                       uint16_t timeout) {
   //const auto full_source_path = url_.GetLocation() + source;
   //const auto full_dest_path = url_.GetLocation() + dest;
-  const auto full_source_path = url_.GetProtocol() + "://"
-                              + url_.GetHostName() + ":"
-                              + std::to_string(url_.GetPort())
-                              + source;
-  const auto full_dest_path = url_.GetProtocol() + "://"
-                            + url_.GetHostName() + ":"
-                            + std::to_string(url_.GetPort())
-                            + dest;
+  const auto full_source_path = endpoint_ + source;
+  const auto full_dest_path = endpoint_ + dest;
 
   logger_->Debug(kLogXrdClHttp,
                  "HttpFileSystemPlugIn::Mv - src = %s, dest = %s, timeout = %d",
                  full_source_path.c_str(), full_dest_path.c_str(), timeout);
 
-  auto status =
-      Posix::Rename(*davix_client_, full_source_path, full_dest_path, timeout);
-
-  if (status.IsError()) {
-    logger_->Error(kLogXrdClHttp, "Mv failed: %s", status.ToStr().c_str());
-    return status;
-  }
+  handler = HttpMetrics::Instance().Track(HttpMetrics::kMv, handler);
+  const auto queued = HttpTrace::Clock::now();
+
+  // Tasks own what they use: the file system may be gone before they run
+  auto session = session_;
+  auto logger = logger_;
+  HttpExecutor::Instance().Submit([session, logger, full_source_path,
+                                   full_dest_path, handler, timeout, queued] {
+    HttpTrace trace("mv", full_source_path, queued);
+    auto status = Posix::Rename(session->posix, full_source_path,
+                                full_dest_path, timeout);
+    HttpStatCache::Instance().Invalidate(full_source_path);
+    HttpStatCache::Instance().Invalidate(full_dest_path);
+
+    if (status.IsError()) {
+      logger->Error(kLogXrdClHttp, "Mv failed: %s", status.ToStr().c_str());
+    }
 
-  handler->HandleResponse(new XRootDStatus(status), nullptr);
+    HttpExecutor::Instance().Complete(handler, new XRootDStatus(status));
+  });
 
   return XRootDStatus();
 }
@@ -96,14 +97,23 @@ XRootDStatus HttpFileSystemPlugIn::Rm(const std::string &path,
                  "HttpFileSystemPlugIn::Rm - path = %s, timeout = %d",
                  url.GetURL().c_str(), timeout);
 
-  auto status = Posix::Unlink(*davix_client_, url.GetURL(), timeout);
+  handler = HttpMetrics::Instance().Track(HttpMetrics::kRm, handler);
+  const auto queued = HttpTrace::Clock::now();
 
-  if (status.IsError()) {
-    logger_->Error(kLogXrdClHttp, "Rm failed: %s", status.ToStr().c_str());
-    return status;
-  }
+  auto session = session_;
+  auto logger = logger_;
+  HttpExecutor::Instance().Submit([session, logger, url, handler, timeout,
+                                   queued] {
+    HttpTrace trace("rm", url.GetURL(), queued);
+    auto status = Posix::Unlink(session->posix, url.GetURL(), timeout);
+    HttpStatCache::Instance().Invalidate(url.GetURL());
+
+    if (status.IsError()) {
+      logger->Error(kLogXrdClHttp, "Rm failed: %s", status.ToStr().c_str());
+    }
 
-  handler->HandleResponse(new XRootDStatus(status), nullptr);
+    HttpExecutor::Instance().Complete(handler, new XRootDStatus(status));
+  });
 
   return XRootDStatus();
 }
@@ -121,13 +131,23 @@ XRootDStatus HttpFileSystemPlugIn::MkDir(const std::string &path,
       "HttpFileSystemPlugIn::MkDir - path = %s, flags = %d, timeout = %d",
       url.GetURL().c_str(), flags, timeout);
 
-  auto status = Posix::MkDir(*davix_client_, url.GetURL(), flags, mode, timeout);
-  if (status.IsError()) {
-    logger_->Error(kLogXrdClHttp, "MkDir failed: %s", status.ToStr().c_str());
-    return status;
-  }
+  handler = HttpMetrics::Instance().Track(HttpMetrics::kMkDir, handler);
+  const auto queued = HttpTrace::Clock::now();
+
+  auto session = session_;
+  auto logger = logger_;
+  HttpExecutor::Instance().Submit([session, logger, url, flags, mode, handler,
+                                   timeout, queued] {
+    HttpTrace trace("mkdir", url.GetURL(), queued);
+    auto status =
+        Posix::MkDir(session->posix, url.GetURL(), flags, mode, timeout);
+    HttpStatCache::Instance().Invalidate(url.GetURL());
+    if (status.IsError()) {
+      logger->Error(kLogXrdClHttp, "MkDir failed: %s", status.ToStr().c_str());
+    }
 
-  handler->HandleResponse(new XRootDStatus(status), nullptr);
+    HttpExecutor::Instance().Complete(handler, new XRootDStatus(status));
+  });
 
   return XRootDStatus();
 }
@@ -142,13 +162,23 @@ XRootDStatus HttpFileSystemPlugIn::RmDir(const std::string &path,
                  "HttpFileSystemPlugIn::RmDir - path = %s, timeout = %d",
                  url.GetURL().c_str(), timeout);
 
-  auto status = Posix::RmDir(*davix_client_, url.GetURL(), timeout);
-  if (status.IsError()) {
-    logger_->Error(kLogXrdClHttp, "RmDir failed: %s", status.ToStr().c_str());
-    return status;
-  }
+  handler = HttpMetrics::Instance().Track(HttpMetrics::kRmDir, handler);
+  const auto queued = HttpTrace::Clock::now();
+
+  auto session = session_;
+  auto logger = logger_;
+  HttpExecutor::Instance().Submit([session, logger, url, handler, timeout,
+                                   queued] {
+    HttpTrace trace("rmdir", url.GetURL(), queued);
+    auto status = Posix::RmDir(session->posix, url.GetURL(), timeout);
+    HttpStatCache::Instance().Invalidate(url.GetURL());
+    if (status.IsError()) {
+      logger->Error(kLogXrdClHttp, "RmDir failed: %s", status.ToStr().c_str());
+    }
+
+    HttpExecutor::Instance().Complete(handler, new XRootDStatus(status));
+  });
 
-  handler->HandleResponse(new XRootDStatus(status), nullptr);
   return XRootDStatus();
 }
 
@@ -168,19 +198,99 @@ XRootDStatus HttpFileSystemPlugIn::DirList(const std::string &path,
   const bool details = flags & DirListFlags::Stat;
   const bool recursive = flags & DirListFlags::Recursive;
 
-  // res == std::pair<DirectoryList*, XRootDStatus>
-  auto res =
-      Posix::DirList(*davix_client_, full_path, details, recursive, timeout);
-  if (res.second.IsError()) {
-    logger_->Error(kLogXrdClHttp, "Could not list dir: %s, error: %s",
-                   full_path.c_str(), res.second.ToStr().c_str());
-    return res.second;
+  handler = HttpMetrics::Instance().Track(HttpMetrics::kDirList, handler);
+  const auto queued = HttpTrace::Clock::now();
+  auto session = session_;
+  auto logger = logger_;
+
+  if ((flags & DirListFlags::Chunked) && !recursive) {
+    HttpExecutor::Instance().Submit([session, logger, full_path, details,
+                                     handler, timeout, queued] {
+      HttpTrace trace("dirlist", full_path, queued);
+      static const size_t batch_size = std::max<uint64_t>(
+          1, GetEnvUInt(HTTP_PLUG_IN_LIST_BATCH_ENV, kDefaultListBatch));
+
+      // A batch is held back until the next one shows up, so that the last
+      // goes out with the final status. The others are handed over right
+      // here, in order, and the listing waits for the handler meanwhile:
+      // at most two batches are ever in memory.
+      std::unique_ptr<DirectoryList> pending;
+      auto sink = [&pending, handler](DirectoryList *batch) {
+        if (pending) {
+          auto obj = new AnyObject();
+          obj->Set(pending.release());
+          handler->HandleResponse(new XRootDStatus(stOK, suContinue), obj);
+        }
+        pending.reset(batch);
+        return true;
+      };
+
+      auto status =
+          S3ListEnabled()
+              ? S3DirList(session->context, full_path, details, false,
+                          timeout, batch_size, sink)
+              : Posix::DirList(session->posix, full_path, details, timeout,
+                               batch_size, sink);
+      if (status.IsError()) {
+        logger->Error(kLogXrdClHttp, "Could not list dir: %s, error: %s",
+                       full_path.c_str(), status.ToStr().c_str());
+        HttpExecutor::Instance().Complete(handler, new XRootDStatus(status));
+        return;
+      }
+
+      if (!pending) pending.reset(new DirectoryList());
+      auto obj = new AnyObject();
+      obj->Set(pending.release());
+      HttpExecutor::Instance().Complete(handler, new XRootDStatus(status),
+                                        obj);
+    });
+    return XRootDStatus();
   }
 
-  auto obj = new AnyObject();
-  obj->Set(res.first);
+  HttpExecutor::Instance().Submit([session, logger, full_path, details,
+                                   recursive, handler, timeout, queued] {
+    HttpTrace trace("dirlist", full_path, queued);
+    // res == std::pair<DirectoryList*, XRootDStatus>
+    std::pair<DirectoryList *, XRootDStatus> res;
+    if (S3ListEnabled()) {
+      res = S3DirList(session->context, full_path, details, recursive,
+                      timeout);
+    }
+    else if (recursive) {
+      // Telling directories apart takes the stat of every entry
+      res = RecursiveDirList(
+          full_path, [session, timeout](const std::string &url) {
+            return Posix::DirList(session->posix, url, true, timeout);
+          });
+      if (res.first && !details) {
+        for (auto it = res.first->Begin(); it != res.first->End(); ++it) {
+          delete (*it)->GetStatInfo();
+          (*it)->SetStatInfo(nullptr);
+        }
+      }
+    }
+    else {
+      res = Posix::DirList(session->posix, full_path, details, timeout);
+    }
+    if (res.second.IsError()) {
+      logger->Error(kLogXrdClHttp, "Could not list dir: %s, error: %s",
+                     full_path.c_str(), res.second.ToStr().c_str());
+      HttpExecutor::Instance().Complete(handler, new XRootDStatus(res.second));
+      return;
+    }
+    if (res.second.code == suPartial) {
+      logger->Warning(kLogXrdClHttp, "Partial listing of %s: %s",
+                       full_path.c_str(),
+                       res.second.GetErrorMessage().c_str());
+    }
+
+    auto obj = new AnyObject();
+    obj->Set(res.first);
+
+    HttpExecutor::Instance().Complete(handler, new XRootDStatus(res.second),
+                                      obj);
+  });
 
-  handler->HandleResponse(new XRootDStatus(), obj);
   return XRootDStatus();
 }
 
@@ -188,27 +298,35 @@ XRootDStatus HttpFileSystemPlugIn::Stat(const std::string &path,
                                         ResponseHandler *handler,
                                         uint16_t timeout) {
   //const auto full_path = url_.GetLocation() + path;
-  const auto full_path = url_.GetProtocol() + "://" +
-                         url_.GetHostName() + ":" +
-                         std::to_string(url_.GetPort()) + "/" + path;
+  const auto full_path = endpoint_ + "/" + path;
 
   logger_->Debug(kLogXrdClHttp,
                  "HttpFileSystemPlugIn::Stat - path = %s, timeout = %d",
                  full_path.c_str(), timeout);
 
-  auto stat_info = new StatInfo();
-  //XRootDStatus status;
-  auto status = Posix::Stat(*davix_client_, full_path, timeout, stat_info);
-
-  if (status.IsError()) {
-    logger_->Error(kLogXrdClHttp, "Stat failed: %s", status.ToStr().c_str());
-    return status;
-  }
+  handler = HttpMetrics::Instance().Track(HttpMetrics::kStat, handler);
+  const auto queued = HttpTrace::Clock::now();
+
+  auto session = session_;
+  auto logger = logger_;
+  HttpExecutor::Instance().Submit([session, logger, full_path, handler,
+                                   timeout, queued] {
+    HttpTrace trace("stat", full_path, queued);
+    StatInfo *stat_info = nullptr;
+    auto status = HttpStatCache::Instance().Stat(session->posix, full_path,
+                                                 timeout, false, &stat_info);
+
+    if (status.IsError()) {
+      logger->Error(kLogXrdClHttp, "Stat failed: %s", status.ToStr().c_str());
+      HttpExecutor::Instance().Complete(handler, new XRootDStatus(status));
+      return;
+    }
 
-  auto obj = new AnyObject();
-  obj->Set(stat_info);
+    auto obj = new AnyObject();
+    obj->Set(stat_info);
 
-  handler->HandleResponse(new XRootDStatus(), obj);
+    HttpExecutor::Instance().Complete(handler, new XRootDStatus(), obj);
+  });
 
   return XRootDStatus();
 }
@@ -221,6 +339,19 @@ bool HttpFileSystemPlugIn::SetProperty(const std::string &name,
 
 bool HttpFileSystemPlugIn::GetProperty(const std::string &name,
                                        std::string &value) const {
+  if (name == HTTP_PLUG_IN_SESSION_STATS_PROPERTY) {
+    value = HttpSessionPool::Instance().GetStatistics();
+    return true;
+  }
+  if (name == HTTP_PLUG_IN_STATCACHE_STATS_PROPERTY) {
+    value = HttpStatCache::Instance().GetStatistics();
+    return true;
+  }
+  if (name == HTTP_PLUG_IN_METRICS_PROPERTY) {
+    value = HttpMetrics::Instance().GetStatistics();
+    return true;
+  }
+
   const auto p = properties_.find(name);
   if (p == std::end(properties_)) {
     return false;
@@ -10,10 +10,15 @@
 #include "XrdCl/XrdClPlugInInterface.hh"
 #include "XrdCl/XrdClURL.hh"
 
+#include <memory>
 #include <unordered_map>
 
+// Entries per response of a DirListFlags::Chunked listing
+#define HTTP_PLUG_IN_LIST_BATCH_ENV "XRDCLHTTP_LIST_BATCH"
+
 namespace XrdCl {
 class Log;
+struct HttpSession;
 
 class HttpFileSystemPlugIn : public FileSystemPlugIn {
  public:
@@ -48,10 +53,13 @@ class HttpFileSystemPlugIn : public FileSystemPlugIn {
                            std::string &value) const override;
 
  private:
-  Davix::Context *ctx_;
-  Davix::DavPosix *davix_client_;
+  // Shared with every other plug-in on the same endpoint, see HttpSessionPool.
+  // Each task holds a reference of its own while it runs.
+  std::shared_ptr<HttpSession> session_;
 
   URL url_;
+  // "scheme://host:port", which Mv and Stat prepend to their paths
+  const std::string endpoint_;
 
   std::unordered_map<std::string, std::string> properties_;
 
@@ -0,0 +1,236 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#include "HttpHedge.hh"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+
+#include "HttpExecutor.hh"
+#include "HttpPlugInUtil.hh"
+
+namespace {
+
+const uint64_t kDefaultQuantile = 95;
+const uint64_t kDefaultMinDelayMs = 20;
+
+// First byte latencies kept per host, the threshold being their quantile,
+// recomputed every kRecompute of them once there are kMinSamples
+const size_t kSamples = 256;
+const size_t kMinSamples = 32;
+const size_t kRecompute = 16;
+
+// Hedges the budget may save up for a burst of slow answers
+const double kMaxBudget = 10;
+
+const std::atomic<bool> kNotCancelled(false);
+
+}  // namespace
+
+namespace XrdCl {
+
+struct HttpHedge::Race {
+  Race(const std::string& host, const Attempt& attempt)
+      : host(host), attempt(attempt) {
+    for (int i = 0; i < 2; ++i) cancelled[i].store(false);
+  }
+
+  // Sets targets[index] up to read into buffers[index] instead of the
+  // caller's buffers
+  void Prepare(int index, const ChunkList& chunks) {
+    uint64_t total = 0;
+    for (const auto& chunk : chunks) total += chunk.length;
+    buffers[index].resize(total);
+    uint64_t position = 0;
+    for (const auto& chunk : chunks) {
+      targets[index].emplace_back(chunk.offset, chunk.length,
+                                  buffers[index].data() + position);
+      position += chunk.length;
+    }
+  }
+
+  const std::string host;
+  const Attempt attempt;
+
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::vector<char> buffers[2];
+  ChunkList targets[2];
+  Clock::time_point started_at[2];
+  bool started[2] = {false, false};
+  bool answered[2] = {false, false};
+  bool done[2] = {false, false};
+  XRootDStatus status[2];
+  int winner = -1;
+  std::atomic<bool> cancelled[2];
+};
+
+HttpHedge& HttpHedge::Instance() {
+  static HttpHedge* hedge = new HttpHedge(
+      GetEnvUInt(HTTP_PLUG_IN_HEDGE_PERCENT_ENV, 0),
+      std::max<uint64_t>(
+          1, std::min<uint64_t>(99, GetEnvUInt(HTTP_PLUG_IN_HEDGE_QUANTILE_ENV,
+                                               kDefaultQuantile))),
+      std::chrono::milliseconds(
+          GetEnvUInt(HTTP_PLUG_IN_HEDGE_MIN_MS_ENV, kDefaultMinDelayMs)));
+  return *hedge;
+}
+
+HttpHedge::HttpHedge(unsigned percent, unsigned quantile,
+                     Clock::duration min_delay)
+    : percent_(percent),
+      quantile_(quantile),
+      min_delay_(min_delay),
+      budget_(0),
+      reads_(0),
+      fired_(0),
+      won_(0),
+      denied_(0) {}
+
+XRootDStatus HttpHedge::Read(const std::string& host, const ChunkList& targets,
+                             const Attempt& attempt) {
+  if (!Enabled()) return attempt(targets, nullptr, kNotCancelled);
+
+  reads_.fetch_add(1, std::memory_order_relaxed);
+  const auto threshold = Threshold(host);
+
+  // Too few answers from host yet to tell a slow one apart
+  if (threshold == Clock::duration::max()) {
+    const auto start = Clock::now();
+    return attempt(targets,
+                   [this, &host, start] {
+                     AddSample(host, Clock::now() - start);
+                   },
+                   kNotCancelled);
+  }
+
+  auto race = std::make_shared<Race>(host, attempt);
+  race->Prepare(0, targets);
+  HttpExecutor::Instance().Submit([race] { Run(race, 0); });
+
+  std::unique_lock<std::mutex> lock(race->mutex);
+  const bool answered = race->cond.wait_until(
+      lock, Clock::now() + threshold,
+      [&race] { return race->answered[0] || race->done[0]; });
+  bool hedged = false;
+  if (!race->started[0]) {
+    // All workers busy: a hedge would wait in the same queue
+    lock.unlock();
+    Run(race, 0);
+    lock.lock();
+  }
+  else if (!answered) {
+    if (Spend()) {
+      fired_.fetch_add(1, std::memory_order_relaxed);
+      race->Prepare(1, targets);
+      hedged = true;
+      lock.unlock();
+      HttpExecutor::Instance().Submit([race] { Run(race, 1); });
+      lock.lock();
+    }
+    else {
+      denied_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  race->cond.wait(lock, [&race, hedged] {
+    return race->winner >= 0 ||
+           (race->done[0] && (!hedged || race->done[1]));
+  });
+  if (race->winner < 0) return race->status[0];
+  const int winner = race->winner;
+  lock.unlock();
+
+  if (winner == 1) won_.fetch_add(1, std::memory_order_relaxed);
+  const char* data = race->buffers[winner].data();
+  for (const auto& chunk : targets) {
+    std::memcpy(chunk.buffer, data, chunk.length);
+    data += chunk.length;
+  }
+  return XRootDStatus();
+}
+
+void HttpHedge::Run(std::shared_ptr<Race> race, int index) {
+  {
+    std::lock_guard<std::mutex> lock(race->mutex);
+    // Run already, or the other attempt won before this one got a worker
+    if (race->started[index]) return;
+    race->started[index] = true;
+    if (race->winner >= 0) {
+      race->done[index] = true;
+      return;
+    }
+    race->started_at[index] = Clock::now();
+  }
+
+  auto answered = [&race, index] {
+    Instance().AddSample(race->host,
+                         Clock::now() - race->started_at[index]);
+    std::lock_guard<std::mutex> lock(race->mutex);
+    race->answered[index] = true;
+    race->cond.notify_all();
+  };
+  auto status =
+      race->attempt(race->targets[index], answered, race->cancelled[index]);
+
+  std::lock_guard<std::mutex> lock(race->mutex);
+  race->done[index] = true;
+  race->status[index] = status;
+  if (race->winner < 0 && status.IsOK()) {
+    race->winner = index;
+    race->cancelled[1 - index].store(true);
+  }
+  race->cond.notify_all();
+}
+
+HttpHedge::Clock::duration HttpHedge::Threshold(const std::string& host) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  budget_ = std::min(kMaxBudget, budget_ + percent_ / 100.0);
+  return hosts_[host].threshold;
+}
+
+void HttpHedge::AddSample(const std::string& host, Clock::duration latency) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& entry = hosts_[host];
+  if (entry.samples.size() < kSamples) {
+    entry.samples.push_back(latency);
+  }
+  else {
+    entry.samples[entry.next] = latency;
+  }
+  entry.next = (entry.next + 1) % kSamples;
+  ++entry.added;
+  if (entry.added < kMinSamples || entry.added % kRecompute != 0) return;
+
+  auto sorted = entry.samples;
+  auto nth = sorted.begin() + sorted.size() * quantile_ / 100;
+  std::nth_element(sorted.begin(), nth, sorted.end());
+  entry.threshold = std::max(*nth, min_delay_);
+}
+
+bool HttpHedge::Spend() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (budget_ < 1) return false;
+  budget_ -= 1;
+  return true;
+}
+
+HttpHedge::Counters HttpHedge::GetCounters() {
+  return Counters{reads_.load(), fired_.load(), won_.load(), denied_.load()};
+}
+
+std::string HttpHedge::GetStatistics() {
+  const auto counters = GetCounters();
+  char buffer[128];
+  snprintf(buffer, sizeof(buffer), "reads=%llu fired=%llu won=%llu denied=%llu",
+           (unsigned long long)counters.reads,
+           (unsigned long long)counters.fired,
+           (unsigned long long)counters.won,
+           (unsigned long long)counters.denied);
+  return buffer;
+}
+
+}  // namespace XrdCl
@@ -0,0 +1,122 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#ifndef __HTTP_HEDGE_
+#define __HTTP_HEDGE_
+
+#include "XrdCl/XrdClXRootDResponses.hh"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Extra range requests hedging may add, in percent of the range requests,
+// 0 (the default) disables hedging
+#define HTTP_PLUG_IN_HEDGE_PERCENT_ENV "XRDCLHTTP_HEDGE_PERCENT"
+// Quantile, in percent, of a host's first byte latencies past which a range
+// request is hedged
+#define HTTP_PLUG_IN_HEDGE_QUANTILE_ENV "XRDCLHTTP_HEDGE_QUANTILE"
+// Shortest wait in milliseconds before a range request is hedged
+#define HTTP_PLUG_IN_HEDGE_MIN_MS_ENV "XRDCLHTTP_HEDGE_MIN_MS"
+
+// GetProperty() name returning the hedging counters
+#define HTTP_PLUG_IN_HEDGE_STATS_PROPERTY "HttpHedgeStats"
+
+namespace XrdCl {
+
+//----------------------------------------------------------------------------
+//! Hedged range requests. A range request whose answer has not started
+//! arriving after the host's usual first byte latency (its p95 by default)
+//! is sent a second time, on another connection of the session, and the
+//! first of the two to complete is taken. The other one is cancelled: it
+//! stops as soon as its answer arrives, Davix offering no way to abort a
+//! request still waiting for it.
+//!
+//! Both attempts read into buffers of their own, the winner's being copied
+//! to the caller's, so that a loser still running never writes into memory
+//! handed back. Hedges are paid for out of a budget, a percentage of the
+//! range requests made, which caps the extra load put on the servers.
+//! Hedged requests run on the worker pool, outside the operation's trace.
+//----------------------------------------------------------------------------
+class HttpHedge {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  //--------------------------------------------------------------------------
+  //! One attempt at reading into targets. It calls answered once the answer
+  //! headers are in, and gives up when cancelled is set. It may outlive the
+  //! Read that started it, so it must own everything it uses.
+  //--------------------------------------------------------------------------
+  using Attempt = std::function<XRootDStatus(
+      const ChunkList& targets, const std::function<void()>& answered,
+      const std::atomic<bool>& cancelled)>;
+
+  static HttpHedge& Instance();
+
+  bool Enabled() const { return percent_ > 0; }
+
+  //--------------------------------------------------------------------------
+  //! Read into targets with attempt, hedging it when host is slow to answer.
+  //! Without hedging, attempt is simply run.
+  //--------------------------------------------------------------------------
+  XRootDStatus Read(const std::string& host, const ChunkList& targets,
+                    const Attempt& attempt);
+
+  struct Counters {
+    uint64_t reads;
+    uint64_t fired;
+    uint64_t won;
+    uint64_t denied;
+  };
+
+  Counters GetCounters();
+
+  //--------------------------------------------------------------------------
+  //! Counters as "reads=N fired=N won=N denied=N", denied counting the
+  //! hedges the budget refused
+  //--------------------------------------------------------------------------
+  std::string GetStatistics();
+
+ private:
+  struct Race;
+
+  // Recent first byte latencies of a host
+  struct Host {
+    std::vector<Clock::duration> samples;
+    size_t next = 0;
+    size_t added = 0;
+    Clock::duration threshold = Clock::duration::max();
+  };
+
+  HttpHedge(unsigned percent, unsigned quantile, Clock::duration min_delay);
+
+  Clock::duration Threshold(const std::string& host);
+  void AddSample(const std::string& host, Clock::duration latency);
+  bool Spend();
+
+  static void Run(std::shared_ptr<Race> race, int index);
+
+  const unsigned percent_;
+  const unsigned quantile_;
+  const Clock::duration min_delay_;
+
+  std::mutex mutex_;
+  std::map<std::string, Host> hosts_;
+  double budget_;
+
+  std::atomic<uint64_t> reads_;
+  std::atomic<uint64_t> fired_;
+  std::atomic<uint64_t> won_;
+  std::atomic<uint64_t> denied_;
+};
+
+}  // namespace XrdCl
+
+#endif  // __HTTP_HEDGE_
@@ -0,0 +1,245 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#include "HttpMetrics.hh"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+
+#include "XrdCl/XrdClDefaultEnv.hh"
+#include "XrdCl/XrdClLog.hh"
+
+#include "HttpHedge.hh"
+#include "HttpPlugInUtil.hh"
+#include "HttpSessionPool.hh"
+
+namespace {
+
+const uint64_t kDefaultInterval = 60;
+
+const char* const kOpNames[] = {"open",  "stat", "read", "vector_read",
+                                "write", "dirlist", "mkdir", "rm",
+                                "rmdir", "mv"};
+
+class TrackingHandler : public XrdCl::ResponseHandler {
+ public:
+  TrackingHandler(XrdCl::HttpMetrics::Op op, XrdCl::ResponseHandler* handler,
+                  uint64_t bytes)
+      : op_(op),
+        handler_(handler),
+        bytes_(bytes),
+        start_(XrdCl::HttpMetrics::Clock::now()) {}
+
+  void HandleResponse(XrdCl::XRootDStatus* status,
+                      XrdCl::AnyObject* response) override {
+    // Chunked listings answer several times, only the last one counts
+    if (status->IsOK() && status->code == XrdCl::suContinue) {
+      handler_->HandleResponse(status, response);
+      return;
+    }
+    XrdCl::HttpMetrics::Instance().Record(op_, start_, *status, bytes_);
+    handler_->HandleResponse(status, response);
+    delete this;
+  }
+
+ private:
+  const XrdCl::HttpMetrics::Op op_;
+  XrdCl::ResponseHandler* const handler_;
+  const uint64_t bytes_;
+  const XrdCl::HttpMetrics::Clock::time_point start_;
+};
+
+}  // namespace
+
+namespace XrdCl {
+
+HttpMetrics& HttpMetrics::Instance() {
+  static HttpMetrics* metrics = new HttpMetrics();
+  return *metrics;
+}
+
+HttpMetrics::HttpMetrics() : retries_(0) {
+  for (auto& op : ops_) {
+    for (auto& bucket : op.buckets) bucket.store(0);
+  }
+
+  const char* path = getenv(HTTP_PLUG_IN_METRICS_FILE_ENV);
+  if (path && *path) {
+    const unsigned interval = std::max<uint64_t>(
+        1, GetEnvUInt(HTTP_PLUG_IN_METRICS_INTERVAL_ENV, kDefaultInterval));
+    std::thread(&HttpMetrics::DumpPeriodically, this, std::string(path),
+                interval)
+        .detach();
+  }
+}
+
+ResponseHandler* HttpMetrics::Track(Op op, ResponseHandler* handler,
+                                    uint64_t bytes) {
+  return new TrackingHandler(op, handler, bytes);
+}
+
+void HttpMetrics::Record(Op op, Clock::time_point start,
+                         const XRootDStatus& status, uint64_t bytes) {
+  const uint64_t micros = std::chrono::duration_cast<std::chrono::microseconds>(
+                              Clock::now() - start)
+                              .count();
+  // Smallest bucket 2^i us holding the latency
+  int bucket = micros <= 1 ? 0 : 64 - __builtin_clzll(micros - 1);
+  if (bucket > kNumBuckets - 1) bucket = kNumBuckets - 1;
+
+  auto& metrics = ops_[op];
+  metrics.count.fetch_add(1, std::memory_order_relaxed);
+  metrics.micros.fetch_add(micros, std::memory_order_relaxed);
+  metrics.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+
+  if (status.IsOK()) {
+    metrics.bytes.fetch_add(bytes, std::memory_order_relaxed);
+    return;
+  }
+
+  metrics.errors.fetch_add(1, std::memory_order_relaxed);
+  std::lock_guard<std::mutex> lock(errors_mutex_);
+  ++errors_by_code_[std::make_pair(int(op), status.errNo)];
+}
+
+std::string HttpMetrics::GetStatistics() {
+  std::string text;
+  char line[256];
+  auto metric = [&text](const char* name, const char* type,
+                        const char* help) {
+    text += std::string("# HELP ") + name + " " + help + "\n# TYPE " + name +
+            " " + type + "\n";
+  };
+
+  metric("xrdclhttp_operations_total", "counter", "Operations completed");
+  for (int op = 0; op < kNumOps; ++op) {
+    snprintf(line, sizeof(line),
+             "xrdclhttp_operations_total{op=\"%s\"} %llu\n", kOpNames[op],
+             (unsigned long long)ops_[op].count.load());
+    text += line;
+  }
+
+  metric("xrdclhttp_errors_total", "counter", "Operations that failed");
+  for (int op = 0; op < kNumOps; ++op) {
+    snprintf(line, sizeof(line), "xrdclhttp_errors_total{op=\"%s\"} %llu\n",
+             kOpNames[op], (unsigned long long)ops_[op].errors.load());
+    text += line;
+  }
+
+  metric("xrdclhttp_errors_by_code_total", "counter",
+         "Failures by Davix status code or XRootD error number");
+  {
+    std::lock_guard<std::mutex> lock(errors_mutex_);
+    for (const auto& errors : errors_by_code_) {
+      snprintf(line, sizeof(line),
+               "xrdclhttp_errors_by_code_total{op=\"%s\",code=\"%u\"} %llu\n",
+               kOpNames[errors.first.first], errors.first.second,
+               (unsigned long long)errors.second);
+      text += line;
+    }
+  }
+
+  metric("xrdclhttp_bytes_total", "counter",
+         "Bytes transferred by successful operations");
+  for (int op = 0; op < kNumOps; ++op) {
+    snprintf(line, sizeof(line), "xrdclhttp_bytes_total{op=\"%s\"} %llu\n",
+             kOpNames[op], (unsigned long long)ops_[op].bytes.load());
+    text += line;
+  }
+
+  metric("xrdclhttp_latency_seconds", "histogram",
+         "Operation latency, from the call to the response");
+  for (int op = 0; op < kNumOps; ++op) {
+    uint64_t cumulative = 0;
+    for (int bucket = 0; bucket < kNumBuckets; ++bucket) {
+      cumulative += ops_[op].buckets[bucket].load();
+      if (bucket < kNumBuckets - 1) {
+        snprintf(line, sizeof(line),
+                 "xrdclhttp_latency_seconds_bucket{op=\"%s\",le=\"%g\"} "
+                 "%llu\n",
+                 kOpNames[op], double(1ULL << bucket) / 1e6,
+                 (unsigned long long)cumulative);
+      }
+      else {
+        snprintf(line, sizeof(line),
+                 "xrdclhttp_latency_seconds_bucket{op=\"%s\",le=\"+Inf\"} "
+                 "%llu\n",
+                 kOpNames[op], (unsigned long long)cumulative);
+      }
+      text += line;
+    }
+    snprintf(line, sizeof(line),
+             "xrdclhttp_latency_seconds_sum{op=\"%s\"} %.6f\n"
+             "xrdclhttp_latency_seconds_count{op=\"%s\"} %llu\n",
+             kOpNames[op], ops_[op].micros.load() / 1e6, kOpNames[op],
+             (unsigned long long)cumulative);
+    text += line;
+  }
+
+  metric("xrdclhttp_retries_total", "counter",
+         "Failed attempts that were made again");
+  snprintf(line, sizeof(line), "xrdclhttp_retries_total %llu\n",
+           (unsigned long long)retries_.load());
+  text += line;
+
+  const auto sessions = HttpSessionPool::Instance().GetCounters();
+  metric("xrdclhttp_sessions_acquired_total", "counter",
+         "Davix sessions handed to plug-in instances");
+  snprintf(line, sizeof(line), "xrdclhttp_sessions_acquired_total %llu\n",
+           (unsigned long long)sessions.acquired);
+  text += line;
+  metric("xrdclhttp_sessions_created_total", "counter",
+         "Davix sessions created, the others being reused with their "
+         "connections");
+  snprintf(line, sizeof(line), "xrdclhttp_sessions_created_total %llu\n",
+           (unsigned long long)sessions.created);
+  text += line;
+  metric("xrdclhttp_sessions_evicted_total", "counter",
+         "Idle Davix sessions dropped");
+  snprintf(line, sizeof(line), "xrdclhttp_sessions_evicted_total %llu\n",
+           (unsigned long long)sessions.evicted);
+  text += line;
+
+  const auto hedges = HttpHedge::Instance().GetCounters();
+  metric("xrdclhttp_hedges_fired_total", "counter",
+         "Range requests sent a second time for a slow answer");
+  snprintf(line, sizeof(line), "xrdclhttp_hedges_fired_total %llu\n",
+           (unsigned long long)hedges.fired);
+  text += line;
+  metric("xrdclhttp_hedges_won_total", "counter",
+         "Hedged range requests completed before the original one");
+  snprintf(line, sizeof(line), "xrdclhttp_hedges_won_total %llu\n",
+           (unsigned long long)hedges.won);
+  text += line;
+
+  return text;
+}
+
+void HttpMetrics::DumpPeriodically(const std::string& path,
+                                   unsigned interval) {
+  // Written aside and renamed, so that scrapers never see half a file
+  const std::string temporary = path + ".tmp";
+  while (true) {
+    std::this_thread::sleep_for(std::chrono::seconds(interval));
+
+    const auto text = GetStatistics();
+    bool written = false;
+    if (FILE* file = fopen(temporary.c_str(), "w")) {
+      written = fwrite(text.data(), 1, text.size(), file) == text.size();
+      written = fclose(file) == 0 && written;
+    }
+    if (!written || rename(temporary.c_str(), path.c_str())) {
+      DefaultEnv::GetLog()->Warning(kLogXrdClHttp,
+                                    "Could not write metrics to %s",
+                                    path.c_str());
+      unlink(temporary.c_str());
+    }
+  }
+}
+
+}  // namespace XrdCl
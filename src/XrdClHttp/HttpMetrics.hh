@@ -0,0 +1,101 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#ifndef __HTTP_METRICS_
+#define __HTTP_METRICS_
+
+#include "XrdCl/XrdClXRootDResponses.hh"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+// File the metrics are written to periodically, unset (the default) for none
+#define HTTP_PLUG_IN_METRICS_FILE_ENV "XRDCLHTTP_METRICS_FILE"
+// Seconds between two writes of the metrics file
+#define HTTP_PLUG_IN_METRICS_INTERVAL_ENV "XRDCLHTTP_METRICS_INTERVAL"
+
+// GetProperty() name returning the metrics in the Prometheus text format
+#define HTTP_PLUG_IN_METRICS_PROPERTY "HttpMetrics"
+
+namespace XrdCl {
+
+//----------------------------------------------------------------------------
+//! Process-wide counters and latency histograms of the operations of all
+//! plug-in instances, kept in relaxed atomics so that recording costs a few
+//! uncontended increments. Exposed in the Prometheus text format, through
+//! GetProperty() and optionally in a file rewritten periodically.
+//----------------------------------------------------------------------------
+class HttpMetrics {
+ public:
+  enum Op {
+    kOpen,
+    kStat,
+    kRead,
+    kVectorRead,
+    kWrite,
+    kDirList,
+    kMkDir,
+    kRm,
+    kRmDir,
+    kMv,
+    kNumOps
+  };
+
+  using Clock = std::chrono::steady_clock;
+
+  static HttpMetrics& Instance();
+
+  //--------------------------------------------------------------------------
+  //! A handler that records the operation, timed from now, when its final
+  //! response arrives and then passes it on to handler. bytes is what a
+  //! successful operation transferred.
+  //--------------------------------------------------------------------------
+  ResponseHandler* Track(Op op, ResponseHandler* handler, uint64_t bytes = 0);
+
+  void Record(Op op, Clock::time_point start, const XRootDStatus& status,
+              uint64_t bytes);
+
+  //--------------------------------------------------------------------------
+  //! An attempt that failed and is being made again
+  //--------------------------------------------------------------------------
+  void Retried() { retries_.fetch_add(1, std::memory_order_relaxed); }
+
+  //--------------------------------------------------------------------------
+  //! Every metric, session reuse included, in the Prometheus text format
+  //--------------------------------------------------------------------------
+  std::string GetStatistics();
+
+ private:
+  // Latency buckets of 1us, 2us, 4us... 2^(kNumBuckets - 2)us, then +Inf
+  static const int kNumBuckets = 28;
+
+  struct OpMetrics {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> errors{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> micros{0};
+    std::atomic<uint64_t> buckets[kNumBuckets];
+  };
+
+  HttpMetrics();
+
+  void DumpPeriodically(const std::string& path, unsigned interval);
+
+  OpMetrics ops_[kNumOps];
+  std::atomic<uint64_t> retries_;
+
+  // Failures by operation and error number: the Davix status code, or the
+  // XRootD error the answer was mapped to
+  std::mutex errors_mutex_;
+  std::map<std::pair<int, uint32_t>, uint64_t> errors_by_code_;
+};
+
+}  // namespace XrdCl
+
+#endif  // __HTTP_METRICS_
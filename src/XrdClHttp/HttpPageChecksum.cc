@@ -0,0 +1,79 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#include "HttpPageChecksum.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "XrdOuc/XrdOucCRC.hh"
+#include "XrdSys/XrdSysPageSize.hh"
+
+#include "HttpExecutor.hh"
+
+namespace {
+
+// Slices smaller than this aren't worth a hand-off to another thread
+const size_t kSliceSize = 256 * 1024;
+const size_t kMaxLanes = 8;
+
+}  // namespace
+
+namespace XrdCl {
+
+size_t PageCount(uint64_t offset, size_t length) {
+  if (length == 0) return 0;
+  return (offset + length - 1) / XrdSys::PageSize - offset / XrdSys::PageSize +
+         1;
+}
+
+void PageChecksums(uint64_t offset, const void* data, size_t length,
+                   uint32_t* cksums) {
+  const char* input = static_cast<const char*>(data);
+  const size_t misalignment = offset % XrdSys::PageSize;
+  if (misalignment && length) {
+    const size_t first =
+        std::min<size_t>(length, XrdSys::PageSize - misalignment);
+    *cksums++ = XrdOucCRC::Calc32C(input, first);
+    input += first;
+    length -= first;
+  }
+  if (length) XrdOucCRC::Calc32C(input, length, cksums);
+}
+
+void ParallelPageChecksums(uint64_t offset, const void* data, size_t length,
+                           uint32_t* cksums) {
+  if (length < 2 * kSliceSize) {
+    PageChecksums(offset, data, length, cksums);
+    return;
+  }
+
+  // Slice boundaries on file page boundaries, so that every slice but the
+  // first starts with a whole page
+  const size_t num_slices = (length + kSliceSize - 1) / kSliceSize;
+  std::vector<uint64_t> bounds;
+  for (size_t i = 0; i < num_slices; ++i) {
+    bounds.push_back(i == 0 ? offset
+                            : (offset + i * kSliceSize) / XrdSys::PageSize *
+                                  XrdSys::PageSize);
+  }
+  bounds.push_back(offset + length);
+
+  const char* input = static_cast<const char*>(data);
+  std::atomic<size_t> next(0);
+  std::vector<HttpExecutor::Task> lanes(
+      std::min(kMaxLanes, num_slices), [&] {
+        for (size_t i = next++; i < num_slices; i = next++) {
+          if (bounds[i + 1] <= bounds[i]) continue;
+          PageChecksums(bounds[i], input + (bounds[i] - offset),
+                        bounds[i + 1] - bounds[i],
+                        cksums + (bounds[i] / XrdSys::PageSize -
+                                  offset / XrdSys::PageSize));
+        }
+      });
+  HttpExecutor::Instance().RunAll(std::move(lanes));
+}
+
+}  // namespace XrdCl
@@ -0,0 +1,38 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#ifndef __HTTP_PAGE_CHECKSUM_
+#define __HTTP_PAGE_CHECKSUM_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace XrdCl {
+
+//----------------------------------------------------------------------------
+//! Number of pages, aligned on file offsets, that [offset, offset + length)
+//! touches, i.e. the number of checksums of a PgRead of it
+//----------------------------------------------------------------------------
+size_t PageCount(uint64_t offset, size_t length);
+
+//----------------------------------------------------------------------------
+//! CRC32C of every page of data, which holds [offset, offset + length) of
+//! the file: a partial first page up to the next page boundary, whole pages,
+//! then a partial last page. cksums needs room for PageCount() values.
+//! Goes through the page-vector XrdOucCRC::Calc32C, hardware assisted when
+//! the CPU has CRC32C instructions.
+//----------------------------------------------------------------------------
+void PageChecksums(uint64_t offset, const void* data, size_t length,
+                   uint32_t* cksums);
+
+//----------------------------------------------------------------------------
+//! PageChecksums() with large buffers split into page-aligned slices
+//! computed concurrently on the worker pool and the calling thread
+//----------------------------------------------------------------------------
+void ParallelPageChecksums(uint64_t offset, const void* data, size_t length,
+                           uint32_t* cksums);
+
+}  // namespace XrdCl
+
+#endif  // __HTTP_PAGE_CHECKSUM_
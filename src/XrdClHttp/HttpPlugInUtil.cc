@@ -4,6 +4,8 @@
 
 #include "HttpPlugInUtil.hh"
 
+#include <stdlib.h>
+
 #include <mutex>
 
 #include "XrdCl/XrdClLog.hh"
@@ -21,4 +23,14 @@ void SetUpLogging(Log* logger) {
     });
 }
 
+uint64_t GetEnvUInt(const char* name, uint64_t default_value) {
+  const char* value = getenv(name);
+  if (value == NULL || *value == '\0') return default_value;
+
+  char* end = nullptr;
+  unsigned long long parsed = strtoull(value, &end, 10);
+  if (*end != '\0') return default_value;
+  return parsed;
+}
+
 }
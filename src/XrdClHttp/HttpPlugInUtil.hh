@@ -17,6 +17,10 @@ static const uint64_t kLogXrdClHttp = std::numeric_limits<std::uint64_t>::max();
 
 void SetUpLogging(Log* logger);
 
+// Read an unsigned integer tunable from the Unix env, falling back to
+// default_value when the variable is unset or not a number
+uint64_t GetEnvUInt(const char* name, uint64_t default_value);
+
 }
 
-#endif // __HTTP_FILE_PLUG_IN_UTIL_
\ No newline at end of file
+#endif // __HTTP_FILE_PLUG_IN_UTIL_
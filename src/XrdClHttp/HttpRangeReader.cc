@@ -0,0 +1,177 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#include "HttpRangeReader.hh"
+
+#include <strings.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "XProtocol/XProtocol.hh"
+
+namespace {
+
+// Gap bytes are read this much at a time, and thrown away
+const uint64_t kSinkSize = 64 * 1024;
+
+// Longest line accepted in the headers of a multipart part
+const size_t kMaxLine = 4096;
+
+XrdCl::XRootDStatus Malformed(const char* message) {
+  return XrdCl::XRootDStatus(XrdCl::stError, XrdCl::errErrorResponse,
+                             kXR_ServerError, message);
+}
+
+}  // namespace
+
+namespace XrdCl {
+
+HttpRangeReader::HttpRangeReader(const ChunkList& chunks)
+    : copied_(0), discarded_(0) {
+  targets_.reserve(chunks.size());
+  for (const auto& chunk : chunks) {
+    targets_.push_back(Target{chunk.offset, chunk.length,
+                              static_cast<char*>(chunk.buffer), 0});
+  }
+  std::stable_sort(targets_.begin(), targets_.end(),
+                   [](const Target& a, const Target& b) {
+                     return a.offset < b.offset;
+                   });
+}
+
+XRootDStatus HttpRangeReader::ReadPart(uint64_t offset, uint64_t length,
+                                       const Source& source) {
+  const uint64_t end = offset + length;
+  uint64_t position = offset;
+  std::vector<Span> spans;
+
+  for (auto& target : targets_) {
+    if (target.offset >= end) break;
+    const uint64_t target_end = target.offset + target.length;
+    if (target_end <= offset) continue;
+
+    uint64_t from = std::max(target.offset, offset);
+    const uint64_t to = std::min(target_end, end);
+    char* output = target.buffer + (from - target.offset);
+
+    // Overlaps a chunk that already received these bytes
+    if (from < position) {
+      const uint64_t overlap = std::min(to, position) - from;
+      CopyReceived(spans, from, overlap, output);
+      target.received += overlap;
+      from += overlap;
+      output += overlap;
+      if (from == to) continue;
+    }
+
+    if (from > position) {
+      if (!Discard(from - position, source))
+        return Malformed("Truncated range response");
+      position = from;
+    }
+
+    if (!Fill(output, to - from, source))
+      return Malformed("Truncated range response");
+    spans.push_back(Span{from, to - from, output});
+    target.received += to - from;
+    position = to;
+  }
+
+  if (position < end && !Discard(end - position, source))
+    return Malformed("Truncated range response");
+  return XRootDStatus();
+}
+
+XRootDStatus HttpRangeReader::ReadMultipart(const std::string& boundary,
+                                            const Source& source) {
+  const std::string delimiter = "--" + boundary;
+  std::string line;
+  // The end of the body before the closing delimiter is left to Complete()
+  while (ReadLine(line, source)) {
+    if (line == delimiter + "--") break;
+    // Preamble, and the line break ending the previous part
+    if (line != delimiter) continue;
+
+    // "Content-Range: bytes 0-1023/4096"
+    bool ranged = false;
+    uint64_t first = 0, last = 0;
+    while (ReadLine(line, source) && !line.empty()) {
+      if (strncasecmp(line.c_str(), "Content-Range:", 14)) continue;
+      const auto pos = line.find("bytes");
+      if (pos == std::string::npos) continue;
+      char* next = nullptr;
+      first = strtoull(line.c_str() + pos + 5, &next, 10);
+      if (*next != '-') continue;
+      last = strtoull(next + 1, nullptr, 10);
+      ranged = last >= first;
+    }
+    if (!ranged) return Malformed("Part without a Content-Range");
+
+    auto status = ReadPart(first, last - first + 1, source);
+    if (status.IsError()) return status;
+  }
+  return XRootDStatus();
+}
+
+bool HttpRangeReader::Complete() const {
+  for (const auto& target : targets_) {
+    if (target.received < target.length) return false;
+  }
+  return true;
+}
+
+bool HttpRangeReader::Fill(char* buffer, uint64_t size, const Source& source) {
+  while (size > 0) {
+    const int64_t num_bytes_read = source(buffer, size);
+    if (num_bytes_read <= 0) return false;
+    buffer += num_bytes_read;
+    size -= num_bytes_read;
+  }
+  return true;
+}
+
+bool HttpRangeReader::Discard(uint64_t size, const Source& source) {
+  char sink[kSinkSize];
+  discarded_ += size;
+  while (size > 0) {
+    const uint64_t length = std::min(size, kSinkSize);
+    if (!Fill(sink, length, source)) return false;
+    size -= length;
+  }
+  return true;
+}
+
+bool HttpRangeReader::ReadLine(std::string& line, const Source& source) {
+  // One byte at a time, so that no byte of the part after the headers is
+  // read ahead into a buffer of ours
+  line.clear();
+  char c;
+  while (line.size() < kMaxLine) {
+    if (source(&c, 1) != 1) return false;
+    if (c == '\n') {
+      if (!line.empty() && line.back() == '\r') line.pop_back();
+      return true;
+    }
+    line.push_back(c);
+  }
+  return false;
+}
+
+void HttpRangeReader::CopyReceived(const std::vector<Span>& spans,
+                                   uint64_t offset, uint64_t length,
+                                   char* buffer) {
+  const uint64_t end = offset + length;
+  for (const auto& span : spans) {
+    const uint64_t from = std::max(offset, span.offset);
+    const uint64_t to = std::min(end, span.offset + span.length);
+    if (from >= to) continue;
+    std::memcpy(buffer + (from - offset), span.data + (from - span.offset),
+                to - from);
+    copied_ += to - from;
+  }
+}
+
+}  // namespace XrdCl
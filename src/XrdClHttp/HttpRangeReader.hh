@@ -0,0 +1,91 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#ifndef __HTTP_RANGE_READER_
+#define __HTTP_RANGE_READER_
+
+#include "XrdCl/XrdClXRootDResponses.hh"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace XrdCl {
+
+//----------------------------------------------------------------------------
+//! Routes the body of a ranged GET straight into the buffers of the chunks
+//! it was issued for. Bytes are read from the response into their final
+//! destination; gap bytes of merged ranges are read into a small sink and
+//! dropped. Only the overlap of overlapping chunks is copied, from the chunk
+//! that received it.
+//----------------------------------------------------------------------------
+class HttpRangeReader {
+ public:
+  //--------------------------------------------------------------------------
+  //! Reads up to size bytes of the response body, returning how many were
+  //! read, 0 at the end of the body and a negative value on error
+  //--------------------------------------------------------------------------
+  using Source = std::function<int64_t(char* buffer, uint64_t size)>;
+
+  //--------------------------------------------------------------------------
+  //! Every chunk needs a buffer
+  //--------------------------------------------------------------------------
+  explicit HttpRangeReader(const ChunkList& chunks);
+
+  //--------------------------------------------------------------------------
+  //! A single part: the body of a 206 with a Content-Range header, or the
+  //! body of a 200 with offset 0
+  //--------------------------------------------------------------------------
+  XRootDStatus ReadPart(uint64_t offset, uint64_t length,
+                        const Source& source);
+
+  //--------------------------------------------------------------------------
+  //! The body of a multipart/byteranges 206, parts in any order
+  //--------------------------------------------------------------------------
+  XRootDStatus ReadMultipart(const std::string& boundary,
+                             const Source& source);
+
+  //--------------------------------------------------------------------------
+  //! true once every byte of every chunk has been received
+  //--------------------------------------------------------------------------
+  bool Complete() const;
+
+  uint64_t BytesCopied() const { return copied_; }
+  uint64_t BytesDiscarded() const { return discarded_; }
+
+ private:
+  struct Target {
+    uint64_t offset;
+    uint64_t length;
+    char* buffer;
+    uint64_t received;
+  };
+
+  // Where a span of the current part was written
+  struct Span {
+    uint64_t offset;
+    uint64_t length;
+    const char* data;
+  };
+
+  bool Fill(char* buffer, uint64_t size, const Source& source);
+  bool Discard(uint64_t size, const Source& source);
+  bool ReadLine(std::string& line, const Source& source);
+
+  // Copy [offset, offset + length) of the current part, already received
+  // in other targets, into buffer
+  void CopyReceived(const std::vector<Span>& spans, uint64_t offset,
+                    uint64_t length, char* buffer);
+
+  // Sorted by offset
+  std::vector<Target> targets_;
+
+  uint64_t copied_;
+  uint64_t discarded_;
+};
+
+}  // namespace XrdCl
+
+#endif  // __HTTP_RANGE_READER_
@@ -0,0 +1,214 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#include "HttpReadAhead.hh"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "HttpExecutor.hh"
+#include "HttpPlugInUtil.hh"
+
+namespace {
+
+// Number of back-to-back sequential reads before prefetching starts
+const unsigned kSequentialThreshold = 2;
+
+const uint64_t kDefaultBlockSize = 1024 * 1024;
+const uint64_t kDefaultMaxWindow = 8 * 1024 * 1024;
+
+}  // namespace
+
+namespace XrdCl {
+
+HttpReadAhead::HttpReadAhead(Fetch fetch, uint64_t filesize)
+    : fetch_(std::move(fetch)),
+      filesize_(filesize),
+      block_size_(std::max<uint64_t>(
+          1, std::min<uint64_t>(GetEnvUInt(HTTP_PLUG_IN_READAHEAD_BLOCK_ENV,
+                                           kDefaultBlockSize),
+                                UINT32_MAX))),
+      max_window_(GetEnvUInt(HTTP_PLUG_IN_READAHEAD_MAX_ENV,
+                             kDefaultMaxWindow)),
+      prefetch_end_(0),
+      next_offset_(0),
+      sequential_(0),
+      window_(0),
+      running_(0),
+      shutdown_(false),
+      hits_(0),
+      misses_(0),
+      prefetched_bytes_(0),
+      wasted_bytes_(0) {}
+
+bool HttpReadAhead::Enabled() {
+  return GetEnvUInt(HTTP_PLUG_IN_READAHEAD_MAX_ENV, kDefaultMaxWindow) > 0;
+}
+
+bool HttpReadAhead::Read(uint64_t offset, uint32_t size, void* buffer,
+                         std::pair<int, XRootDStatus>& res) {
+  Lock lock(mutex_);
+  if (shutdown_ || offset >= filesize_) return false;
+
+  const uint64_t end = std::min<uint64_t>(offset + size, filesize_);
+
+  if (!blocks_.empty() && offset >= blocks_.front()->offset &&
+      end <= prefetch_end_) {
+    // Keep our own references: the deque may change while the lock is
+    // released to wait for a block
+    std::vector<std::shared_ptr<Block>> needed;
+    for (const auto& block : blocks_) {
+      if (block->offset < end && block->offset + block->size > offset)
+        needed.push_back(block);
+    }
+
+    bool complete = true;
+    for (const auto& block : needed) {
+      WaitFor(block, lock);
+      if (block->res.second.IsError() ||
+          block->res.first < static_cast<int>(block->size))
+        complete = false;
+    }
+
+    if (complete) {
+      char* output = static_cast<char*>(buffer);
+      for (const auto& block : needed) {
+        uint64_t from = std::max(offset, block->offset);
+        uint64_t to = std::min(end, block->offset + block->size);
+        std::memcpy(output + (from - offset),
+                    block->data.data() + (from - block->offset), to - from);
+        block->used += to - from;
+      }
+
+      ++hits_;
+      next_offset_ = end;
+      window_ = std::min(window_ * 2, max_window_);
+      Discard(offset);
+      TopUp(end);
+
+      res = std::make_pair(static_cast<int>(end - offset), XRootDStatus());
+      return true;
+    }
+
+    // A background read failed; let the caller retry on its own
+    Reset();
+  }
+
+  ++misses_;
+  if (offset == next_offset_) {
+    ++sequential_;
+  }
+  else {
+    sequential_ = 0;
+    window_ = 0;
+    Reset();
+  }
+  next_offset_ = end;
+
+  // Reads larger than the window would never be served from it
+  if (sequential_ >= kSequentialThreshold && size <= max_window_) {
+    window_ = std::min(std::max<uint64_t>(window_ * 2, size), max_window_);
+    window_ = std::max<uint64_t>(window_, std::min<uint64_t>(block_size_,
+                                                             max_window_));
+    Discard(end);
+    TopUp(end);
+  }
+
+  return false;
+}
+
+void HttpReadAhead::Shutdown() {
+  Lock lock(mutex_);
+  shutdown_ = true;
+  Reset();
+  cond_.wait(lock, [this] { return running_ == 0; });
+}
+
+std::string HttpReadAhead::GetStatistics() {
+  Lock lock(mutex_);
+  char buffer[192];
+  snprintf(buffer, sizeof(buffer),
+           "hits=%llu misses=%llu prefetched_bytes=%llu wasted_bytes=%llu "
+           "window=%llu",
+           (unsigned long long)hits_, (unsigned long long)misses_,
+           (unsigned long long)prefetched_bytes_,
+           (unsigned long long)wasted_bytes_, (unsigned long long)window_);
+  return buffer;
+}
+
+void HttpReadAhead::Run(const std::shared_ptr<Block>& block, Lock& lock) {
+  block->state = Block::kRunning;
+  ++running_;
+  lock.unlock();
+
+  block->data.resize(block->size);
+  auto res = fetch_(block->data.data(), block->size, block->offset);
+
+  lock.lock();
+  block->res = res;
+  block->state = Block::kDone;
+  --running_;
+  if (res.first > 0) prefetched_bytes_ += res.first;
+  cond_.notify_all();
+}
+
+void HttpReadAhead::WaitFor(const std::shared_ptr<Block>& block, Lock& lock) {
+  // Fetching a block that no worker has picked up yet ourselves keeps
+  // readers from starving the pool they wait on
+  if (block->state == Block::kQueued) {
+    Run(block, lock);
+    return;
+  }
+  cond_.wait(lock, [&block] { return block->state == Block::kDone; });
+}
+
+void HttpReadAhead::TopUp(uint64_t from) {
+  if (shutdown_ || window_ == 0) return;
+
+  if (blocks_.empty()) prefetch_end_ = from;
+
+  while (prefetch_end_ < from + window_ && prefetch_end_ < filesize_) {
+    auto block = std::make_shared<Block>();
+    block->offset = prefetch_end_;
+    block->size = std::min<uint64_t>(block_size_, filesize_ - prefetch_end_);
+    block->state = Block::kQueued;
+    block->used = 0;
+    blocks_.push_back(block);
+    prefetch_end_ += block->size;
+
+    auto self = shared_from_this();
+    HttpExecutor::Instance().Submit([self, block] {
+      Lock lock(self->mutex_);
+      if (block->state != Block::kQueued) return;
+      self->Run(block, lock);
+    });
+  }
+}
+
+void HttpReadAhead::Discard(uint64_t offset) {
+  while (!blocks_.empty() &&
+         blocks_.front()->offset + blocks_.front()->size <= offset) {
+    auto& block = blocks_.front();
+    if (block->state == Block::kDone && block->res.first > 0)
+      wasted_bytes_ += block->res.first - std::min<uint64_t>(
+          block->used, block->res.first);
+    else if (block->state == Block::kRunning)
+      wasted_bytes_ += block->size - std::min(block->used, block->size);
+    else if (block->state == Block::kQueued) {
+      // Skipped by the worker that eventually picks it up
+      block->state = Block::kDone;
+      block->res = std::make_pair(
+          -1, XRootDStatus(stError, errOperationInterrupted));
+    }
+    blocks_.pop_front();
+  }
+}
+
+void HttpReadAhead::Reset() {
+  Discard(UINT64_MAX);
+  prefetch_end_ = 0;
+}
+
+}  // namespace XrdCl
@@ -0,0 +1,122 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#ifndef __HTTP_READ_AHEAD_
+#define __HTTP_READ_AHEAD_
+
+#include "XrdCl/XrdClXRootDResponses.hh"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Upper bound of the read-ahead window in bytes, 0 disables read-ahead
+#define HTTP_PLUG_IN_READAHEAD_MAX_ENV "XRDCLHTTP_READAHEAD_MAX"
+// Size of each background ranged read in bytes
+#define HTTP_PLUG_IN_READAHEAD_BLOCK_ENV "XRDCLHTTP_READAHEAD_BLOCK"
+
+// GetProperty() name returning the read-ahead counters of a file
+#define HTTP_PLUG_IN_READAHEAD_STATS_PROPERTY "HttpReadAheadStats"
+
+namespace XrdCl {
+
+//----------------------------------------------------------------------------
+//! Per-file sequential read-ahead. Once a run of sequential reads is seen,
+//! ranged reads of the following bytes are issued in the background on the
+//! HttpExecutor, and the window of prefetched data doubles on every hit up
+//! to XRDCLHTTP_READAHEAD_MAX. A non-sequential read drops the window.
+//----------------------------------------------------------------------------
+class HttpReadAhead : public std::enable_shared_from_this<HttpReadAhead> {
+ public:
+  // Same contract as Posix::PRead
+  using Fetch = std::function<std::pair<int, XRootDStatus>(
+      void* buffer, uint32_t size, uint64_t offset)>;
+
+  HttpReadAhead(Fetch fetch, uint64_t filesize);
+
+  //--------------------------------------------------------------------------
+  //! true if read-ahead is enabled by the configuration
+  //--------------------------------------------------------------------------
+  static bool Enabled();
+
+  //--------------------------------------------------------------------------
+  //! Serve [offset, offset + size) from the prefetched blocks, waiting for
+  //! blocks that are still in flight. Returns false on a miss, in which case
+  //! the caller has to fetch the range itself.
+  //--------------------------------------------------------------------------
+  bool Read(uint64_t offset, uint32_t size, void* buffer,
+            std::pair<int, XRootDStatus>& res);
+
+  //--------------------------------------------------------------------------
+  //! Cancel queued reads and wait for the running ones. Fetch is never
+  //! called again afterwards, so the file may be closed.
+  //--------------------------------------------------------------------------
+  void Shutdown();
+
+  //--------------------------------------------------------------------------
+  //! Counters as "hits=N misses=N prefetched_bytes=N wasted_bytes=N window=N"
+  //--------------------------------------------------------------------------
+  std::string GetStatistics();
+
+ private:
+  struct Block {
+    enum State { kQueued, kRunning, kDone };
+
+    uint64_t offset;
+    uint32_t size;
+    State state;
+    std::vector<char> data;
+    std::pair<int, XRootDStatus> res;
+    uint32_t used;
+  };
+
+  using Lock = std::unique_lock<std::mutex>;
+
+  // Fetch the block, either from a worker or from a reader stealing a block
+  // that hasn't been picked up yet. Called and returns with the lock held.
+  void Run(const std::shared_ptr<Block>& block, Lock& lock);
+
+  // Wait until the block is fetched, fetching it here if still queued
+  void WaitFor(const std::shared_ptr<Block>& block, Lock& lock);
+
+  // Queue reads until the window ahead of from is covered
+  void TopUp(uint64_t from);
+
+  // Drop the blocks ending at or before offset, or all of them
+  void Discard(uint64_t offset);
+  void Reset();
+
+  const Fetch fetch_;
+  const uint64_t filesize_;
+  const uint32_t block_size_;
+  const uint64_t max_window_;
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+
+  // Contiguous prefetched blocks, ending at prefetch_end_
+  std::deque<std::shared_ptr<Block>> blocks_;
+  uint64_t prefetch_end_;
+
+  uint64_t next_offset_;
+  unsigned sequential_;
+  uint64_t window_;
+  unsigned running_;
+  bool shutdown_;
+
+  uint64_t hits_;
+  uint64_t misses_;
+  uint64_t prefetched_bytes_;
+  uint64_t wasted_bytes_;
+};
+
+}  // namespace XrdCl
+
+#endif  // __HTTP_READ_AHEAD_
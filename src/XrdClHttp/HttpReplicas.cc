@@ -0,0 +1,149 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#include "HttpReplicas.hh"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "HttpPlugInUtil.hh"
+
+namespace {
+
+const uint64_t kDefaultMinRate = 1024 * 1024;
+
+// Hosts are compared on a read of this size
+const double kReferenceRead = 1024 * 1024;
+// Smaller reads say too little about the rate of a host
+const uint64_t kMinRateSample = 256 * 1024;
+// Weight of the latest read in the moving averages
+const double kWeight = 0.2;
+// Rate samples needed before a host can fall below the floor
+const unsigned kMinRateSamples = 3;
+// How long a failed or slow host ranks last
+const std::chrono::seconds kPenalty(60);
+
+double ToSeconds(XrdCl::HttpReplicas::Clock::duration duration) {
+  return std::chrono::duration<double>(duration).count();
+}
+
+}  // namespace
+
+namespace XrdCl {
+
+HttpReplicas& HttpReplicas::Instance() {
+  static HttpReplicas* replicas = new HttpReplicas(
+      GetEnvUInt(HTTP_PLUG_IN_REPLICAS_ENV, 0) > 0,
+      GetEnvUInt(HTTP_PLUG_IN_REPLICA_MIN_RATE_ENV, kDefaultMinRate));
+  return *replicas;
+}
+
+HttpReplicas::HttpReplicas(bool enabled, uint64_t min_rate)
+    : enabled_(enabled),
+      min_rate_(min_rate),
+      files_(0),
+      replicas_(0),
+      failovers_(0),
+      demotions_(0) {}
+
+void HttpReplicas::Rank(std::vector<Replica>& replicas) {
+  std::vector<std::pair<double, Replica>> ranked;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto now = Clock::now();
+    double total = 0;
+    unsigned measured = 0;
+    for (const auto& replica : replicas) {
+      auto entry = hosts_.find(replica.host);
+      const double seconds =
+          entry == hosts_.end() ? -1 : Seconds(entry->second);
+      if (seconds >= 0) {
+        total += seconds;
+        ++measured;
+      }
+      ranked.emplace_back(seconds, replica);
+    }
+    const double mean = measured ? total / measured : 0;
+    for (auto& replica : ranked) {
+      if (replica.first < 0) replica.first = mean;
+      auto entry = hosts_.find(replica.second.host);
+      if (entry != hosts_.end() && entry->second.penalty_until > now) {
+        replica.first += 1e9;
+      }
+    }
+  }
+
+  std::stable_sort(ranked.begin(), ranked.end(),
+                   [](const std::pair<double, Replica>& a,
+                      const std::pair<double, Replica>& b) {
+                     return a.first < b.first;
+                   });
+  for (size_t i = 0; i < replicas.size(); ++i) {
+    replicas[i] = std::move(ranked[i].second);
+  }
+}
+
+void HttpReplicas::Record(const std::string& host, Clock::duration latency,
+                          uint64_t bytes, Clock::duration transfer) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& score = hosts_[host];
+  const double seconds = ToSeconds(latency);
+  score.latency = score.latency_samples++
+                      ? score.latency + kWeight * (seconds - score.latency)
+                      : seconds;
+  if (bytes < kMinRateSample || transfer <= Clock::duration::zero()) return;
+
+  const double rate = bytes / ToSeconds(transfer);
+  score.rate =
+      score.rate_samples++ ? score.rate + kWeight * (rate - score.rate) : rate;
+  if (min_rate_ > 0 && score.rate_samples >= kMinRateSamples &&
+      score.rate < min_rate_) {
+    score.penalty_until = Clock::now() + kPenalty;
+  }
+}
+
+void HttpReplicas::Failed(const std::string& host) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& score = hosts_[host];
+  ++score.failures;
+  score.penalty_until = Clock::now() + kPenalty;
+}
+
+bool HttpReplicas::Usable(const std::string& host) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto entry = hosts_.find(host);
+  return entry == hosts_.end() || entry->second.penalty_until <= Clock::now();
+}
+
+void HttpReplicas::Listed(size_t replicas) {
+  files_.fetch_add(1, std::memory_order_relaxed);
+  replicas_.fetch_add(replicas, std::memory_order_relaxed);
+}
+
+double HttpReplicas::Seconds(const Score& score) const {
+  if (!score.latency_samples) return -1;
+  return score.latency + (score.rate > 0 ? kReferenceRead / score.rate : 0);
+}
+
+std::string HttpReplicas::GetStatistics() {
+  char buffer[256];
+  snprintf(buffer, sizeof(buffer),
+           "files=%llu replicas=%llu failovers=%llu demotions=%llu",
+           (unsigned long long)files_, (unsigned long long)replicas_,
+           (unsigned long long)failovers_, (unsigned long long)demotions_);
+  std::string text = buffer;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& host : hosts_) {
+    snprintf(buffer, sizeof(buffer),
+             " host=%s latency_ms=%.3f mb_per_s=%.3f failures=%llu",
+             host.first.c_str(), host.second.latency * 1e3,
+             host.second.rate / 1e6,
+             (unsigned long long)host.second.failures);
+    text += buffer;
+  }
+  return text;
+}
+
+}  // namespace XrdCl
@@ -0,0 +1,114 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#ifndef __HTTP_REPLICAS_
+#define __HTTP_REPLICAS_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Look up the replicas of files opened for reading and read from the best
+// one, failing over to the others
+#define HTTP_PLUG_IN_REPLICAS_ENV "XRDCLHTTP_REPLICAS"
+// Transfer rate in bytes per second below which a replica is left for the
+// next one, 0 disables it
+#define HTTP_PLUG_IN_REPLICA_MIN_RATE_ENV "XRDCLHTTP_REPLICA_MIN_RATE"
+
+// GetProperty() name returning the replica counters and host scores
+#define HTTP_PLUG_IN_REPLICA_STATS_PROPERTY "HttpReplicaStats"
+
+namespace XrdCl {
+
+struct HttpSession;
+
+//----------------------------------------------------------------------------
+//! Process-wide performance scores of the hosts read from, used to rank the
+//! replicas of a file. A host is scored by the time it would take to serve
+//! a 1 MiB read: its latency to the first byte plus the transfer at its
+//! rate, both moving averages over the reads of every file. Hosts that
+//! failed a read, or fell below the rate floor, rank last for a while.
+//----------------------------------------------------------------------------
+class HttpReplicas {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Replica {
+    std::string url;
+    std::string host;
+    std::shared_ptr<HttpSession> session;
+  };
+
+  static HttpReplicas& Instance();
+
+  bool Enabled() const { return enabled_; }
+
+  //--------------------------------------------------------------------------
+  //! Order replicas best first. Hosts not measured yet are given the mean
+  //! score of the others, and ties keep the order of the list.
+  //--------------------------------------------------------------------------
+  void Rank(std::vector<Replica>& replicas);
+
+  //--------------------------------------------------------------------------
+  //! Account for a read of bytes from host: latency until its answer
+  //! started, then transfer to receive it
+  //--------------------------------------------------------------------------
+  void Record(const std::string& host, Clock::duration latency,
+              uint64_t bytes, Clock::duration transfer);
+
+  //--------------------------------------------------------------------------
+  //! A read from host failed
+  //--------------------------------------------------------------------------
+  void Failed(const std::string& host);
+
+  //--------------------------------------------------------------------------
+  //! Whether host has neither failed lately nor fallen below the rate floor
+  //--------------------------------------------------------------------------
+  bool Usable(const std::string& host);
+
+  void Listed(size_t replicas);
+  void FailedOver() { failovers_.fetch_add(1, std::memory_order_relaxed); }
+  void Demoted() { demotions_.fetch_add(1, std::memory_order_relaxed); }
+
+  //--------------------------------------------------------------------------
+  //! Counters as "files=N replicas=N failovers=N demotions=N", followed by
+  //! " host=H latency_ms=R mb_per_s=R failures=N" for every host
+  //--------------------------------------------------------------------------
+  std::string GetStatistics();
+
+ private:
+  struct Score {
+    double latency = 0;
+    double rate = 0;
+    unsigned latency_samples = 0;
+    unsigned rate_samples = 0;
+    uint64_t failures = 0;
+    Clock::time_point penalty_until;
+  };
+
+  HttpReplicas(bool enabled, uint64_t min_rate);
+
+  // Seconds to serve the reference read, negative when unmeasured
+  double Seconds(const Score& score) const;
+
+  const bool enabled_;
+  const double min_rate_;
+
+  std::mutex mutex_;
+  std::map<std::string, Score> hosts_;
+
+  std::atomic<uint64_t> files_;
+  std::atomic<uint64_t> replicas_;
+  std::atomic<uint64_t> failovers_;
+  std::atomic<uint64_t> demotions_;
+};
+
+}  // namespace XrdCl
+
+#endif  // __HTTP_REPLICAS_
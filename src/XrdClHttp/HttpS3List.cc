@@ -0,0 +1,243 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#include "HttpS3List.hh"
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <set>
+
+#include "XProtocol/XProtocol.hh"
+#include "XrdCl/XrdClURL.hh"
+
+#include "HttpCredentials.hh"
+#include "HttpPlugInUtil.hh"
+#include "Posix.hh"
+
+namespace {
+
+const uint64_t kDefaultPageSize = 1000;
+
+// As Posix::DirList reports directories
+const uint32_t kDirFlags =
+    XrdCl::StatInfo::IsDir | XrdCl::StatInfo::IsReadable |
+    XrdCl::StatInfo::IsWritable | XrdCl::StatInfo::XBitSet;
+
+// Content of the next <tag>...</tag> in xml[from, to), moving from past it
+bool NextElement(const std::string& xml, const std::string& tag, size_t& from,
+                 size_t to, std::string* content) {
+  const std::string open = "<" + tag + ">";
+  const std::string close = "</" + tag + ">";
+  const auto start = xml.find(open, from);
+  if (start == std::string::npos || start >= to) return false;
+  const auto end = xml.find(close, start + open.size());
+  if (end == std::string::npos || end > to) return false;
+  content->assign(xml, start + open.size(), end - start - open.size());
+  from = end + close.size();
+  return true;
+}
+
+// The XML character references keys may contain
+std::string Unescape(const std::string& text) {
+  static const std::pair<const char*, char> kEntities[] = {
+      {"&amp;", '&'}, {"&lt;", '<'}, {"&gt;", '>'},
+      {"&quot;", '"'}, {"&apos;", '\''}};
+
+  std::string result;
+  for (size_t i = 0; i < text.size(); ++i) {
+    if (text[i] != '&') {
+      result += text[i];
+      continue;
+    }
+    bool replaced = false;
+    for (const auto& entity : kEntities) {
+      const size_t length = strlen(entity.first);
+      if (text.compare(i, length, entity.first) == 0) {
+        result += entity.second;
+        i += length - 1;
+        replaced = true;
+        break;
+      }
+    }
+    const auto end = text.find(';', i);
+    if (!replaced && text.compare(i, 2, "&#") == 0 &&
+        end != std::string::npos) {
+      // Only ASCII control characters are escaped this way by S3
+      const bool hex = text[i + 2] == 'x';
+      result += char(strtoul(text.c_str() + i + (hex ? 3 : 2), nullptr,
+                             hex ? 16 : 10));
+      i = end;
+      replaced = true;
+    }
+    if (!replaced) result += '&';
+  }
+  return result;
+}
+
+// "2009-10-12T17:50:30.000Z"
+time_t ParseIsoDate(const std::string& value) {
+  struct tm tm = {};
+  if (!strptime(value.c_str(), "%Y-%m-%dT%H:%M:%S", &tm)) return 0;
+  return timegm(&tm);
+}
+
+}  // namespace
+
+namespace XrdCl {
+
+bool ParseS3ListPage(const std::string& xml, S3ListPage* page) {
+  const auto root = xml.find("<ListBucketResult");
+  if (root == std::string::npos) return false;
+
+  std::string block, value;
+  size_t pos = root;
+  while (NextElement(xml, "Contents", pos, xml.size(), &block)) {
+    S3ListPage::Object object{"", 0, 0};
+    size_t field = 0;
+    if (!NextElement(block, "Key", field, block.size(), &value)) continue;
+    object.key = Unescape(value);
+    field = 0;
+    if (NextElement(block, "Size", field, block.size(), &value))
+      object.size = strtoull(value.c_str(), nullptr, 10);
+    field = 0;
+    if (NextElement(block, "LastModified", field, block.size(), &value))
+      object.mtime = ParseIsoDate(value);
+    page->objects.push_back(std::move(object));
+  }
+
+  pos = root;
+  while (NextElement(xml, "CommonPrefixes", pos, xml.size(), &block)) {
+    size_t field = 0;
+    if (NextElement(block, "Prefix", field, block.size(), &value))
+      page->prefixes.push_back(Unescape(value));
+  }
+
+  pos = root;
+  page->truncated = NextElement(xml, "IsTruncated", pos, xml.size(), &value) &&
+                    value == "true";
+  pos = root;
+  if (NextElement(xml, "NextContinuationToken", pos, xml.size(), &value))
+    page->next_token = Unescape(value);
+  return true;
+}
+
+bool S3ListEnabled() {
+  return HttpCredentials::Instance().S3Enabled();
+}
+
+XRootDStatus S3DirList(Davix::Context& context, const std::string& url,
+                       bool details, bool recursive, uint16_t timeout,
+                       size_t batch_size, const Posix::DirListSink& sink) {
+  static const unsigned page_size = std::max<uint64_t>(
+      1, std::min<uint64_t>(
+             GetEnvUInt(HTTP_PLUG_IN_S3_LIST_PAGE_ENV, kDefaultPageSize),
+             kDefaultPageSize));
+
+  // Path style: /bucket/some/prefix
+  XrdCl::URL xurl(url);
+  std::string path = xurl.GetPath();
+  while (!path.empty() && path.front() == '/') path.erase(0, 1);
+  const auto slash = path.find('/');
+  const std::string bucket = path.substr(0, slash);
+  std::string prefix =
+      slash == std::string::npos ? std::string() : path.substr(slash + 1);
+  while (!prefix.empty() && prefix.back() == '/') prefix.pop_back();
+  if (!prefix.empty()) prefix += "/";
+  const std::string bucket_url = xurl.GetProtocol() + "://" +
+                                 xurl.GetHostName() + ":" +
+                                 std::to_string(xurl.GetPort()) + "/" + bucket;
+
+  std::unique_ptr<DirectoryList> batch(new DirectoryList());
+  bool stopped = false;
+  auto add = [&](const std::string& name, StatInfo* stat_info) {
+    if (stopped) {
+      delete stat_info;
+      return;
+    }
+    batch->Add(new DirectoryList::ListEntry(url, name, stat_info));
+    if (batch->GetSize() < batch_size) return;
+    stopped = !sink(batch.release());
+    batch.reset(new DirectoryList());
+  };
+
+  std::set<std::string> directories;
+  auto add_directory = [&](const std::string& name) {
+    if (name.empty() || !directories.insert(name).second) return;
+    add(name, details ? new StatInfo("0", 0, kDirFlags, 0) : nullptr);
+  };
+
+  bool found = false;
+  std::string token;
+  do {
+    auto res = Posix::ListObjects(context, bucket_url, prefix,
+                                  recursive ? "" : "/", token, page_size,
+                                  timeout);
+    if (res.second.IsError()) return res.second;
+
+    S3ListPage page;
+    if (!ParseS3ListPage(res.first, &page)) {
+      return XRootDStatus(stError, errErrorResponse, kXR_ServerError,
+                          "Malformed ListObjectsV2 answer");
+    }
+    found |= !page.objects.empty() || !page.prefixes.empty();
+
+    for (const auto& common : page.prefixes) {
+      std::string name = common.substr(prefix.size());
+      while (!name.empty() && name.back() == '/') name.pop_back();
+      add_directory(name);
+    }
+
+    for (const auto& object : page.objects) {
+      // Keys outside the prefix can't be, but better safe than sorry
+      if (object.key.compare(0, prefix.size(), prefix)) continue;
+      std::string name = object.key.substr(prefix.size());
+
+      // The parents of nested keys, in recursive listings
+      for (auto end = name.find('/'); end != std::string::npos;
+           end = name.find('/', end + 1)) {
+        add_directory(name.substr(0, end));
+      }
+      // Empty "directory marker" objects, the one of prefix itself included
+      if (name.empty() || name.back() == '/') continue;
+
+      add(name, details ? new StatInfo("0", object.size, StatInfo::IsReadable,
+                                       object.mtime)
+                        : nullptr);
+    }
+    if (stopped) return XRootDStatus();
+
+    token = page.truncated ? page.next_token : std::string();
+    if (page.truncated && token.empty()) {
+      return XRootDStatus(stError, errErrorResponse, kXR_ServerError,
+                          "Truncated listing without continuation");
+    }
+  } while (!token.empty());
+
+  // Nothing under a prefix: no such "directory"
+  if (!found && !prefix.empty()) {
+    return XRootDStatus(stError, errErrorResponse, kXR_NotFound,
+                        "No such prefix: " + prefix);
+  }
+  if (batch->GetSize()) sink(batch.release());
+  return XRootDStatus();
+}
+
+std::pair<DirectoryList*, XRootDStatus> S3DirList(Davix::Context& context,
+                                                  const std::string& url,
+                                                  bool details, bool recursive,
+                                                  uint16_t timeout) {
+  std::unique_ptr<DirectoryList> dir_list(new DirectoryList());
+  auto status = S3DirList(context, url, details, recursive, timeout, SIZE_MAX,
+                          [&dir_list](DirectoryList* batch) {
+                            dir_list.reset(batch);
+                            return true;
+                          });
+  if (status.IsError()) return std::make_pair(nullptr, status);
+  return std::make_pair(dir_list.release(), status);
+}
+
+}  // namespace XrdCl
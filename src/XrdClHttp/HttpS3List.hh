@@ -0,0 +1,75 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#ifndef __HTTP_S3_LIST_
+#define __HTTP_S3_LIST_
+
+#include <davix.hpp>
+
+#include "XrdCl/XrdClXRootDResponses.hh"
+
+#include "Posix.hh"
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Keys asked for per ListObjectsV2 request, S3 answers at most 1000
+#define HTTP_PLUG_IN_S3_LIST_PAGE_ENV "XRDCLHTTP_S3_LIST_PAGE"
+
+namespace XrdCl {
+
+//----------------------------------------------------------------------------
+//! One page of a ListObjectsV2 answer
+//----------------------------------------------------------------------------
+struct S3ListPage {
+  struct Object {
+    std::string key;
+    uint64_t size;
+    time_t mtime;
+  };
+
+  std::vector<Object> objects;
+  // "Subdirectories" rolled up by the delimiter, with their trailing '/'
+  std::vector<std::string> prefixes;
+  bool truncated = false;
+  std::string next_token;
+};
+
+//----------------------------------------------------------------------------
+//! Parse a ListBucketResult document. false if it isn't one.
+//----------------------------------------------------------------------------
+bool ParseS3ListPage(const std::string& xml, S3ListPage* page);
+
+//----------------------------------------------------------------------------
+//! true when requests are signed for S3, and listings should use
+//! S3DirList()
+//----------------------------------------------------------------------------
+bool S3ListEnabled();
+
+//----------------------------------------------------------------------------
+//! Listing of the "directory" at url, http(s)://host/bucket/some/prefix,
+//! through paginated ListObjectsV2 requests: with the '/' delimiter for a
+//! plain listing, and flat for a recursive one, subdirectories then being
+//! deduced from the keys. Sizes and modification times come from the
+//! listing itself, so details cost no request per object.
+//----------------------------------------------------------------------------
+std::pair<DirectoryList*, XRootDStatus> S3DirList(Davix::Context& context,
+                                                  const std::string& url,
+                                                  bool details, bool recursive,
+                                                  uint16_t timeout);
+
+//----------------------------------------------------------------------------
+//! S3DirList() handing the entries over to sink in batches of up to
+//! batch_size as the pages come in, as Posix::DirList() does
+//----------------------------------------------------------------------------
+XRootDStatus S3DirList(Davix::Context& context, const std::string& url,
+                       bool details, bool recursive, uint16_t timeout,
+                       size_t batch_size, const Posix::DirListSink& sink);
+
+}  // namespace XrdCl
+
+#endif  // __HTTP_S3_LIST_
@@ -0,0 +1,233 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#include "HttpS3Upload.hh"
+
+#include <algorithm>
+
+#include "XrdCl/XrdClDefaultEnv.hh"
+#include "XrdCl/XrdClLog.hh"
+
+#include "HttpCredentials.hh"
+#include "HttpExecutor.hh"
+#include "HttpMetrics.hh"
+#include "HttpPlugInUtil.hh"
+#include "HttpSessionPool.hh"
+#include "Posix.hh"
+
+namespace {
+
+const uint64_t kDefaultPartSize = 16 * 1024 * 1024;
+const uint64_t kDefaultUploads = 4;
+
+// S3 limits
+const uint64_t kMinPartSize = 5 * 1024 * 1024;
+const uint64_t kMaxParts = 10000;
+
+// Attempts per part
+const int kPartAttempts = 3;
+
+}  // namespace
+
+namespace XrdCl {
+
+bool HttpS3Upload::Enabled() {
+  return HttpCredentials::Instance().S3Enabled() &&
+         GetEnvUInt(HTTP_PLUG_IN_S3_PART_SIZE_ENV, kDefaultPartSize) > 0;
+}
+
+HttpS3Upload::HttpS3Upload(std::shared_ptr<HttpSession> session,
+                           const std::string& url, uint64_t expected_size,
+                           uint16_t timeout)
+    : session_(std::move(session)),
+      url_(url),
+      timeout_(timeout),
+      next_offset_(0),
+      allocated_(0),
+      running_(0),
+      finished_(false) {
+  part_size_ = std::max(
+      kMinPartSize, GetEnvUInt(HTTP_PLUG_IN_S3_PART_SIZE_ENV, kDefaultPartSize));
+  parallelism_ = std::max<uint64_t>(
+      1, GetEnvUInt(HTTP_PLUG_IN_S3_UPLOADS_ENV, kDefaultUploads));
+
+  if (expected_size > 0) {
+    // Round up to whole MiB, as large objects may need bigger parts
+    const uint64_t mib = 1024 * 1024;
+    const uint64_t needed = (expected_size + kMaxParts - 1) / kMaxParts;
+    part_size_ = std::max(part_size_, (needed + mib - 1) / mib * mib);
+    parallelism_ = std::min<uint64_t>(
+        parallelism_, (expected_size + part_size_ - 1) / part_size_);
+  }
+}
+
+HttpS3Upload::~HttpS3Upload() {
+  Lock lock(mutex_);
+  if (!finished_) Abort(lock);
+}
+
+XRootDStatus HttpS3Upload::Write(uint64_t offset, const void* buffer,
+                                 uint32_t size) {
+  Lock lock(mutex_);
+  if (error_.IsError()) return error_;
+  if (finished_) return XRootDStatus(stError, errInvalidOp);
+  if (offset != next_offset_) {
+    return XRootDStatus(stError, errNotSupported, 0,
+                        "S3 uploads must be written sequentially");
+  }
+
+  const char* input = static_cast<const char*>(buffer);
+  while (size > 0) {
+    if (!current_) {
+      current_ = TakeBuffer(lock);
+      if (error_.IsError()) return error_;
+    }
+    const uint32_t length =
+        std::min<uint64_t>(size, part_size_ - current_->size());
+    current_->insert(current_->end(), input, input + length);
+    input += length;
+    size -= length;
+    next_offset_ += length;
+
+    if (current_->size() == part_size_) {
+      auto status = Dispatch(lock);
+      if (status.IsError()) return status;
+    }
+  }
+  return XRootDStatus();
+}
+
+XRootDStatus HttpS3Upload::Close() {
+  Lock lock(mutex_);
+  if (finished_) return error_.IsError() ? error_ : XRootDStatus();
+
+  if (error_.IsOK() && upload_id_.empty()) {
+    // Everything fits in one part: a plain PUT does it in one request
+    finished_ = true;
+    return Posix::Put(session_->context, url_,
+                      current_ ? current_->data() : nullptr,
+                      current_ ? current_->size() : 0, timeout_);
+  }
+
+  if (error_.IsOK() && current_ && !current_->empty()) Dispatch(lock);
+
+  while (!pending_.empty() || running_ > 0) {
+    if (!RunPending(lock)) cond_.wait(lock);
+  }
+
+  if (error_.IsOK()) {
+    auto status = Posix::CompleteUpload(session_->context, url_, upload_id_,
+                                        etags_, timeout_);
+    if (status.IsOK()) {
+      finished_ = true;
+      return status;
+    }
+    error_ = status;
+  }
+
+  DefaultEnv::GetLog()->Error(kLogXrdClHttp,
+                              "Multipart upload of %s failed: %s",
+                              url_.c_str(), error_.ToStr().c_str());
+  Abort(lock);
+  return error_;
+}
+
+XRootDStatus HttpS3Upload::Dispatch(Lock& lock) {
+  if (upload_id_.empty()) {
+    auto res = Posix::InitiateUpload(session_->context, url_, timeout_);
+    if (res.second.IsError()) {
+      error_ = res.second;
+      return error_;
+    }
+    upload_id_ = res.first;
+  }
+
+  etags_.emplace_back();
+  pending_.push_back(Part{static_cast<int>(etags_.size()), std::move(current_)});
+
+  auto self = shared_from_this();
+  HttpExecutor::Instance().Submit([self] {
+    Lock lock(self->mutex_);
+    self->RunPending(lock);
+  });
+  return XRootDStatus();
+}
+
+bool HttpS3Upload::RunPending(Lock& lock) {
+  if (pending_.empty()) return false;
+
+  Part part = std::move(pending_.front());
+  pending_.pop_front();
+  ++running_;
+  // No point in sending more parts of an upload that will be aborted
+  const bool failed = error_.IsError();
+  lock.unlock();
+
+  std::pair<std::string, XRootDStatus> res;
+  for (int attempt = 1; !failed && attempt <= kPartAttempts; ++attempt) {
+    if (attempt > 1) HttpMetrics::Instance().Retried();
+    res = Posix::UploadPart(session_->context, url_, upload_id_, part.number,
+                            part.buffer->data(), part.buffer->size(),
+                            timeout_);
+    if (res.second.IsOK()) break;
+    DefaultEnv::GetLog()->Warning(
+        kLogXrdClHttp, "Part %d of %s failed (attempt %d): %s", part.number,
+        url_.c_str(), attempt, res.second.ToStr().c_str());
+  }
+
+  lock.lock();
+  if (!failed) {
+    if (res.second.IsOK())
+      etags_[part.number - 1] = res.first;
+    else if (error_.IsOK())
+      error_ = res.second;
+  }
+  part.buffer->clear();
+  free_.push_back(std::move(part.buffer));
+  --running_;
+  cond_.notify_all();
+  return true;
+}
+
+std::unique_ptr<HttpS3Upload::Buffer> HttpS3Upload::TakeBuffer(Lock& lock) {
+  while (true) {
+    if (!free_.empty()) {
+      auto buffer = std::move(free_.back());
+      free_.pop_back();
+      return buffer;
+    }
+    // One buffer filling while parallelism_ others are uploaded
+    if (allocated_ < parallelism_ + 1) {
+      ++allocated_;
+      std::unique_ptr<Buffer> buffer(new Buffer());
+      buffer->reserve(part_size_);
+      return buffer;
+    }
+    if (!RunPending(lock)) cond_.wait(lock);
+  }
+}
+
+void HttpS3Upload::Abort(Lock& lock) {
+  // Parts not started yet are dropped, running ones finish first
+  while (!pending_.empty()) {
+    free_.push_back(std::move(pending_.front().buffer));
+    pending_.pop_front();
+  }
+  cond_.wait(lock, [this] { return running_ == 0; });
+
+  finished_ = true;
+  if (upload_id_.empty()) return;
+
+  auto status =
+      Posix::AbortUpload(session_->context, url_, upload_id_, timeout_);
+  if (status.IsError()) {
+    DefaultEnv::GetLog()->Warning(kLogXrdClHttp,
+                                  "Could not abort upload %s of %s: %s",
+                                  upload_id_.c_str(), url_.c_str(),
+                                  status.ToStr().c_str());
+  }
+  upload_id_.clear();
+}
+
+}  // namespace XrdCl
@@ -0,0 +1,110 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#ifndef __HTTP_S3_UPLOAD_
+#define __HTTP_S3_UPLOAD_
+
+#include "XrdCl/XrdClXRootDResponses.hh"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Part size in bytes of S3 multipart uploads, 0 disables them
+#define HTTP_PLUG_IN_S3_PART_SIZE_ENV "XRDCLHTTP_S3_PART_SIZE"
+// Number of parts of one upload in flight at the same time
+#define HTTP_PLUG_IN_S3_UPLOADS_ENV "XRDCLHTTP_S3_UPLOADS"
+
+namespace XrdCl {
+
+struct HttpSession;
+
+//----------------------------------------------------------------------------
+//! Upload of one object to S3 as a multipart upload. Sequential writes fill
+//! part buffers taken from a small pool; each full part is uploaded on the
+//! worker pool while the next one fills, and Close() commits the upload.
+//! Objects smaller than one part are sent with a single PUT instead. On any
+//! failure, or if the upload is dropped before Close(), the parts are
+//! aborted on the server.
+//----------------------------------------------------------------------------
+class HttpS3Upload : public std::enable_shared_from_this<HttpS3Upload> {
+ public:
+  //--------------------------------------------------------------------------
+  //! true when uploads go to S3 (AWS keys set) and multipart is not disabled
+  //--------------------------------------------------------------------------
+  static bool Enabled();
+
+  //--------------------------------------------------------------------------
+  //! expected_size, 0 if unknown, scales the part size up so the object
+  //! fits in the S3 part count limit, and bounds the parallelism
+  //--------------------------------------------------------------------------
+  HttpS3Upload(std::shared_ptr<HttpSession> session, const std::string& url,
+               uint64_t expected_size, uint16_t timeout);
+
+  ~HttpS3Upload();
+
+  //--------------------------------------------------------------------------
+  //! Append data at offset, which must be where the previous write ended.
+  //! Blocks while every part buffer is in flight.
+  //--------------------------------------------------------------------------
+  XRootDStatus Write(uint64_t offset, const void* buffer, uint32_t size);
+
+  //--------------------------------------------------------------------------
+  //! Upload the last part, wait for all of them and commit the upload
+  //--------------------------------------------------------------------------
+  XRootDStatus Close();
+
+ private:
+  using Buffer = std::vector<char>;
+  using Lock = std::unique_lock<std::mutex>;
+
+  struct Part {
+    int number;
+    std::unique_ptr<Buffer> buffer;
+  };
+
+  // Queue current_ for upload, starting the multipart upload if needed
+  XRootDStatus Dispatch(Lock& lock);
+
+  // Upload one pending part, if any, on the calling thread. Called both by
+  // the workers and by a writer waiting for a buffer, so that writers never
+  // wait on a pool they starve.
+  bool RunPending(Lock& lock);
+
+  std::unique_ptr<Buffer> TakeBuffer(Lock& lock);
+
+  void Abort(Lock& lock);
+
+  // Keeps the Davix context alive for as long as parts may be in flight
+  const std::shared_ptr<HttpSession> session_;
+  const std::string url_;
+  const uint16_t timeout_;
+  uint64_t part_size_;
+  unsigned parallelism_;
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+
+  // Empty until the first full part
+  std::string upload_id_;
+  uint64_t next_offset_;
+  std::unique_ptr<Buffer> current_;
+  std::vector<std::unique_ptr<Buffer>> free_;
+  unsigned allocated_;
+  std::deque<Part> pending_;
+  unsigned running_;
+  // ETag of every part, by part number - 1
+  std::vector<std::string> etags_;
+  // First failure; every later operation fails with it
+  XRootDStatus error_;
+  bool finished_;
+};
+
+}  // namespace XrdCl
+
+#endif  // __HTTP_S3_UPLOAD_
@@ -0,0 +1,119 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#include "HttpSessionPool.hh"
+
+#include <cerrno>
+#include <cstdio>
+
+#include "XrdCl/XrdClDefaultEnv.hh"
+#include "XrdCl/XrdClLog.hh"
+#include "XrdCl/XrdClURL.hh"
+
+#include "HttpCredentials.hh"
+#include "HttpPlugInUtil.hh"
+
+namespace XrdCl {
+
+HttpSessionPool& HttpSessionPool::Instance() {
+  // Never destroyed: tearing down Davix contexts during static destruction
+  // races with the TLS library's own cleanup
+  static HttpSessionPool* pool =
+      new HttpSessionPool(GetEnvUInt(HTTP_PLUG_IN_IDLE_TIMEOUT_ENV, 300));
+  return *pool;
+}
+
+HttpSessionPool::HttpSessionPool(time_t idle_timeout)
+    : idle_timeout_(idle_timeout),
+      acquired_(0),
+      created_(0),
+      evicted_(0) {}
+
+std::shared_ptr<HttpSession> HttpSessionPool::Acquire(const URL& url) {
+  const std::string host =
+      url.GetProtocol() + "://" + url.GetHostName() + ":" +
+      std::to_string(url.GetPort());
+  const std::string key = host + " " + HttpCredentials::Instance().Identity();
+
+  std::list<std::unique_ptr<HttpSession>> doomed;
+  HttpSession* session = nullptr;
+  bool reused = true;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& entry = entries_[key];
+    if (!entry.session) {
+      entry.session.reset(new HttpSession());
+      ++created_;
+      reused = false;
+    }
+    ++entry.refs;
+    ++acquired_;
+    session = entry.session.get();
+
+    Evict(doomed);
+  }
+
+  auto logger = DefaultEnv::GetLog();
+  logger->Debug(kLogXrdClHttp, "%s Davix session for %s, %s",
+                reused ? "Reusing" : "Created", host.c_str(),
+                GetStatistics().c_str());
+
+  // The session itself is owned by the pool; the returned pointer only
+  // accounts for the reference
+  return std::shared_ptr<HttpSession>(
+      session, [this, key](HttpSession*) { Release(key); });
+}
+
+void HttpSessionPool::Release(const std::string& key) {
+  // destructor of a Davix context calls into the ssl library, which resets
+  // errno. Callers (e.g. XrdPssSys::Stat) still need to see it.
+  int rc = errno;
+
+  std::list<std::unique_ptr<HttpSession>> doomed;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(key);
+    if (it != entries_.end() && --it->second.refs == 0) {
+      it->second.idle_since = time(NULL);
+    }
+    Evict(doomed);
+  }
+  doomed.clear();
+
+  errno = rc;
+}
+
+void HttpSessionPool::Evict(
+    std::list<std::unique_ptr<HttpSession>>& doomed) {
+  const time_t now = time(NULL);
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    if (it->second.refs != 0 || now - it->second.idle_since < idle_timeout_) {
+      ++it;
+      continue;
+    }
+    doomed.push_back(std::move(it->second.session));
+    it = entries_.erase(it);
+    ++evicted_;
+  }
+}
+
+HttpSessionPool::Counters HttpSessionPool::GetCounters() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return Counters{acquired_, created_, evicted_};
+}
+
+std::string HttpSessionPool::GetStatistics() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  char buffer[160];
+  snprintf(buffer, sizeof(buffer),
+           "acquired=%llu created=%llu reused=%llu evicted=%llu "
+           "reuse_rate=%.3f",
+           (unsigned long long)acquired_, (unsigned long long)created_,
+           (unsigned long long)(acquired_ - created_),
+           (unsigned long long)evicted_,
+           acquired_ ? double(acquired_ - created_) / acquired_ : 0.0);
+  return buffer;
+}
+
+}  // namespace XrdCl
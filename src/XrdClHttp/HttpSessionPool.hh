@@ -0,0 +1,95 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#ifndef __HTTP_SESSION_POOL_
+#define __HTTP_SESSION_POOL_
+
+#include "davix.hpp"
+
+#include <cstdint>
+#include <ctime>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// Seconds after which an unused Davix context is dropped
+#define HTTP_PLUG_IN_IDLE_TIMEOUT_ENV "XRDCLHTTP_IDLE_TIMEOUT"
+
+// GetProperty() name returning the session reuse counters
+#define HTTP_PLUG_IN_SESSION_STATS_PROPERTY "HttpSessionStats"
+
+namespace XrdCl {
+
+class URL;
+
+//----------------------------------------------------------------------------
+//! A Davix context and its posix client. Davix keeps a cache of established
+//! HTTP sessions (TCP + TLS) per context, so sharing one context between
+//! all files on the same endpoint avoids a handshake per open.
+//----------------------------------------------------------------------------
+struct HttpSession {
+  HttpSession() : posix(&context) {}
+
+  Davix::Context context;
+  Davix::DavPosix posix;
+};
+
+//----------------------------------------------------------------------------
+//! Process-wide registry of HttpSession objects, keyed by scheme, host, port
+//! and credential identity, and shared by all plug-in instances
+//----------------------------------------------------------------------------
+class HttpSessionPool {
+ public:
+  static HttpSessionPool& Instance();
+
+  //--------------------------------------------------------------------------
+  //! Get the session for the endpoint of url, creating it if needed. The
+  //! session stays registered while any returned pointer is alive, and is
+  //! kept idle for a while afterwards.
+  //--------------------------------------------------------------------------
+  std::shared_ptr<HttpSession> Acquire(const URL& url);
+
+  struct Counters {
+    uint64_t acquired;
+    uint64_t created;
+    uint64_t evicted;
+  };
+
+  Counters GetCounters();
+
+  //--------------------------------------------------------------------------
+  //! Counters as "acquired=N created=N reused=N evicted=N reuse_rate=R"
+  //--------------------------------------------------------------------------
+  std::string GetStatistics();
+
+ private:
+  struct Entry {
+    std::unique_ptr<HttpSession> session;
+    unsigned refs;
+    time_t idle_since;
+  };
+
+  explicit HttpSessionPool(time_t idle_timeout);
+
+  void Release(const std::string& key);
+
+  // Unregister idle entries past the idle timeout. The sessions are moved to doomed so they are destroyed without the lock
+  // held.
+  void Evict(std::list<std::unique_ptr<HttpSession>>& doomed);
+
+  const time_t idle_timeout_;
+
+  std::mutex mutex_;
+  std::map<std::string, Entry> entries_;
+
+  uint64_t acquired_;
+  uint64_t created_;
+  uint64_t evicted_;
+};
+
+}  // namespace XrdCl
+
+#endif  // __HTTP_SESSION_POOL_
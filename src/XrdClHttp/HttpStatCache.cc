@@ -0,0 +1,155 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#include "HttpStatCache.hh"
+
+#include <cstdio>
+
+#include "XProtocol/XProtocol.hh"
+
+#include "HttpPlugInUtil.hh"
+#include "Posix.hh"
+
+namespace {
+
+const uint64_t kDefaultTTL = 10;
+const uint64_t kDefaultNegativeTTL = 5;
+const uint64_t kDefaultMaxEntries = 100000;
+
+}  // namespace
+
+namespace XrdCl {
+
+HttpStatCache& HttpStatCache::Instance() {
+  static HttpStatCache* cache = new HttpStatCache(
+      GetEnvUInt(HTTP_PLUG_IN_STATCACHE_TTL_ENV, kDefaultTTL),
+      GetEnvUInt(HTTP_PLUG_IN_STATCACHE_NEGATIVE_TTL_ENV, kDefaultNegativeTTL),
+      GetEnvUInt(HTTP_PLUG_IN_STATCACHE_ENTRIES_ENV, kDefaultMaxEntries));
+  return *cache;
+}
+
+HttpStatCache::HttpStatCache(time_t ttl, time_t negative_ttl,
+                             size_t max_entries)
+    : ttl_(ttl),
+      negative_ttl_(negative_ttl),
+      max_entries_(max_entries),
+      hits_(0),
+      negative_hits_(0),
+      misses_(0),
+      invalidations_(0) {}
+
+XRootDStatus HttpStatCache::Stat(Davix::DavPosix& davix_client,
+                                 const std::string& url, uint16_t timeout,
+                                 bool force, StatInfo** stat_info) {
+  const bool enabled = ttl_ > 0 || negative_ttl_ > 0;
+  const auto key = enabled ? Posix::SanitizedURL(url) : "";
+
+  if (enabled && !force) {
+    XRootDStatus status;
+    if (Lookup(url, stat_info, &status)) return status;
+  }
+
+  StatInfo* info = nullptr;
+  auto status = Posix::Stat(davix_client, url, timeout, &info);
+
+  if (status.IsOK()) {
+    if (ttl_ > 0) {
+      Entry entry;
+      entry.expires = time(NULL) + ttl_;
+      entry.found = true;
+      entry.id = info->GetId();
+      entry.size = info->GetSize();
+      entry.flags = info->GetFlags();
+      entry.mod_time = info->GetModTime();
+      Insert(key, entry);
+    }
+    *stat_info = info;
+    return status;
+  }
+
+  // Only a definite "not found" is worth remembering, not transient errors
+  if (negative_ttl_ > 0 && status.errNo == kXR_NotFound) {
+    Entry entry;
+    entry.expires = time(NULL) + negative_ttl_;
+    entry.found = false;
+    entry.size = 0;
+    entry.flags = 0;
+    entry.mod_time = 0;
+    entry.status = status;
+    Insert(key, entry);
+  }
+  else if (enabled) {
+    Invalidate(url);
+  }
+  return status;
+}
+
+bool HttpStatCache::Lookup(const std::string& url, StatInfo** stat_info,
+                           XRootDStatus* status) {
+  if (ttl_ == 0 && negative_ttl_ == 0) return false;
+
+  const auto key = Posix::SanitizedURL(url);
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(key);
+  if (it == entries_.end() || it->second.expires <= time(NULL)) {
+    ++misses_;
+    return false;
+  }
+
+  const auto& entry = it->second;
+  if (!entry.found) {
+    ++negative_hits_;
+    *status = entry.status;
+    return true;
+  }
+  ++hits_;
+  *stat_info = new StatInfo(entry.id, entry.size, entry.flags, entry.mod_time);
+  *status = XRootDStatus();
+  return true;
+}
+
+void HttpStatCache::Insert(const std::string& key, const Entry& entry) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (entries_.find(key) == entries_.end()) order_.push_back(key);
+  entries_[key] = entry;
+
+  while (entries_.size() > max_entries_ && !order_.empty()) {
+    entries_.erase(order_.front());
+    order_.pop_front();
+  }
+  // Keys of invalidated entries linger in order_, bound them too
+  if (order_.size() > 2 * max_entries_ + 1) {
+    std::deque<std::string> live;
+    for (const auto& k : order_) {
+      if (entries_.count(k)) live.push_back(k);
+    }
+    order_.swap(live);
+  }
+}
+
+void HttpStatCache::Invalidate(const std::string& url) {
+  if (ttl_ == 0 && negative_ttl_ == 0) return;
+
+  const auto key = Posix::SanitizedURL(url);
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (entries_.erase(key)) ++invalidations_;
+}
+
+std::string HttpStatCache::GetStatistics() {
+  size_t entries;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries = entries_.size();
+  }
+  char buffer[192];
+  snprintf(buffer, sizeof(buffer),
+           "hits=%llu negative_hits=%llu misses=%llu invalidations=%llu "
+           "entries=%llu",
+           (unsigned long long)hits_, (unsigned long long)negative_hits_,
+           (unsigned long long)misses_, (unsigned long long)invalidations_,
+           (unsigned long long)entries);
+  return buffer;
+}
+
+}  // namespace XrdCl
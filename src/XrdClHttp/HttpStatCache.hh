@@ -0,0 +1,100 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#ifndef __HTTP_STAT_CACHE_
+#define __HTTP_STAT_CACHE_
+
+#include <davix.hpp>
+
+#include "XrdCl/XrdClXRootDResponses.hh"
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Seconds a successful stat is cached, 0 disables the cache
+#define HTTP_PLUG_IN_STATCACHE_TTL_ENV "XRDCLHTTP_STATCACHE_TTL"
+// Seconds a "not found" answer is cached, 0 disables negative entries
+#define HTTP_PLUG_IN_STATCACHE_NEGATIVE_TTL_ENV "XRDCLHTTP_STATCACHE_NEGATIVE_TTL"
+// Maximum number of cached entries
+#define HTTP_PLUG_IN_STATCACHE_ENTRIES_ENV "XRDCLHTTP_STATCACHE_ENTRIES"
+
+// GetProperty() name returning the metadata cache counters
+#define HTTP_PLUG_IN_STATCACHE_STATS_PROPERTY "HttpStatCacheStats"
+
+namespace XrdCl {
+
+//----------------------------------------------------------------------------
+//! Process-wide cache of stat results, keyed by sanitized URL. Holds both
+//! positive entries and "not found" answers, with separate TTLs, so that
+//! stat storms and existence probes don't all reach the server.
+//----------------------------------------------------------------------------
+class HttpStatCache {
+ public:
+  static HttpStatCache& Instance();
+
+  //--------------------------------------------------------------------------
+  //! Posix::Stat through the cache. On success stat_info is set to a new
+  //! StatInfo owned by the caller. force skips the lookup but still
+  //! refreshes the entry.
+  //--------------------------------------------------------------------------
+  XRootDStatus Stat(Davix::DavPosix& davix_client, const std::string& url,
+                    uint16_t timeout, bool force, StatInfo** stat_info);
+
+  //--------------------------------------------------------------------------
+  //! Cached answer for url, without asking the server: true on a hit, with
+  //! either stat_info set to a new StatInfo or status to the cached error
+  //--------------------------------------------------------------------------
+  bool Lookup(const std::string& url, StatInfo** stat_info,
+              XRootDStatus* status);
+
+  //--------------------------------------------------------------------------
+  //! Drop the entry of url, after we modified or removed it
+  //--------------------------------------------------------------------------
+  void Invalidate(const std::string& url);
+
+  //--------------------------------------------------------------------------
+  //! Counters as "hits=N negative_hits=N misses=N invalidations=N entries=N"
+  //--------------------------------------------------------------------------
+  std::string GetStatistics();
+
+ private:
+  struct Entry {
+    time_t expires;
+    // Positive entry
+    bool found;
+    std::string id;
+    uint64_t size;
+    uint32_t flags;
+    uint64_t mod_time;
+    // Negative entry
+    XRootDStatus status;
+  };
+
+  HttpStatCache(time_t ttl, time_t negative_ttl, size_t max_entries);
+
+  void Insert(const std::string& key, const Entry& entry);
+
+  const time_t ttl_;
+  const time_t negative_ttl_;
+  const size_t max_entries_;
+
+  std::mutex mutex_;
+  std::unordered_map<std::string, Entry> entries_;
+  // Insertion order, for evicting the oldest entries over max_entries_
+  std::deque<std::string> order_;
+
+  std::atomic<uint64_t> hits_;
+  std::atomic<uint64_t> negative_hits_;
+  std::atomic<uint64_t> misses_;
+  std::atomic<uint64_t> invalidations_;
+};
+
+}  // namespace XrdCl
+
+#endif  // __HTTP_STAT_CACHE_
@@ -0,0 +1,254 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#include "HttpStreamRead.hh"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include "XrdCl/XrdClDefaultEnv.hh"
+#include "XrdCl/XrdClLog.hh"
+
+#include "HttpPlugInUtil.hh"
+#include "HttpSessionPool.hh"
+#include "Posix.hh"
+
+namespace {
+
+const uint64_t kDefaultWindow = 64 * 1024 * 1024;
+
+// Unit in which the window is received, slid and spooled
+const uint64_t kBlockSize = 1024 * 1024;
+
+}  // namespace
+
+namespace XrdCl {
+
+HttpStreamRead::HttpStreamRead(std::shared_ptr<HttpSession> session,
+                               const std::string& url)
+    : session_(std::move(session)),
+      url_(url),
+      window_(std::max<uint64_t>(
+          2 * kBlockSize,
+          GetEnvUInt(HTTP_PLUG_IN_STREAM_WINDOW_ENV, kDefaultWindow))),
+      spool_fd_(-1),
+      window_start_(0),
+      received_(0),
+      spooled_(0),
+      wanted_(0),
+      started_(false),
+      stopping_(false),
+      finished_(false),
+      streams_(0),
+      restarts_(0),
+      received_bytes_(0),
+      spooled_bytes_(0),
+      window_reads_(0),
+      spool_reads_(0) {
+  const char* directory = getenv(HTTP_PLUG_IN_STREAM_SPOOL_ENV);
+  if (!directory) return;
+
+  std::string path = std::string(directory) + "/xrdclhttp-XXXXXX";
+  spool_fd_ = mkstemp(&path[0]);
+  if (spool_fd_ < 0) {
+    DefaultEnv::GetLog()->Error(kLogXrdClHttp,
+                                "Could not create a spool file in %s: %s",
+                                directory, strerror(errno));
+    return;
+  }
+  // Goes away with the descriptor, even if we crash
+  unlink(path.c_str());
+}
+
+HttpStreamRead::~HttpStreamRead() {
+  Lock lock(mutex_);
+  Stop(lock);
+  if (spool_fd_ >= 0) close(spool_fd_);
+}
+
+std::pair<int, XRootDStatus> HttpStreamRead::Read(uint64_t offset,
+                                                  uint32_t size,
+                                                  void* buffer) {
+  if (size == 0) return std::make_pair(0, XRootDStatus());
+
+  const uint64_t end = offset + size;
+  Lock lock(mutex_);
+  while (true) {
+    if (stopping_) {
+      cond_.wait(lock);
+      continue;
+    }
+    if (end <= spooled_) break;
+
+    // Part of the range left the window without being spooled
+    if (offset < window_start_ && spooled_ < window_start_ &&
+        std::max(offset, spooled_) < std::min(end, window_start_)) {
+      ++restarts_;
+      Stop(lock);
+      continue;
+    }
+
+    if (!started_) Start();
+    if (end > wanted_) {
+      wanted_ = end;
+      cond_.notify_all();
+    }
+    if (received_ >= end) break;
+
+    if (finished_) {
+      if (status_.IsOK()) break;
+      // Failed streams start over at the next read
+      auto status = status_;
+      Stop(lock);
+      return std::make_pair(-1, status);
+    }
+    cond_.wait(lock);
+  }
+
+  // Short at the end of the object
+  const uint64_t last = std::min(end, std::max(received_, spooled_));
+  if (last <= offset) return std::make_pair(0, XRootDStatus());
+
+  // What isn't spooled is in the window
+  char* output = static_cast<char*>(buffer);
+  for (uint64_t position = std::max(offset, spooled_); position < last;) {
+    const uint64_t index = (position - window_start_) / kBlockSize;
+    const uint64_t from = (position - window_start_) % kBlockSize;
+    const uint64_t length = std::min(kBlockSize - from, last - position);
+    std::memcpy(output + (position - offset), blocks_[index].data() + from,
+                length);
+    position += length;
+  }
+  if (std::max(offset, spooled_) < last) ++window_reads_;
+
+  // The spooled part of the object never changes
+  const uint64_t spool_end = std::min(last, spooled_);
+  lock.unlock();
+  for (uint64_t position = offset; position < spool_end;) {
+    const ssize_t num_bytes_read =
+        pread(spool_fd_, output + (position - offset), spool_end - position,
+              position);
+    if (num_bytes_read <= 0) {
+      return std::make_pair(
+          -1, XRootDStatus(stError, errOSError, errno,
+                           "Could not read the spool file"));
+    }
+    position += num_bytes_read;
+  }
+  if (offset < spool_end) ++spool_reads_;
+
+  return std::make_pair(static_cast<int>(last - offset), XRootDStatus());
+}
+
+std::string HttpStreamRead::GetStatistics() {
+  char buffer[192];
+  snprintf(buffer, sizeof(buffer),
+           "streams=%llu restarts=%llu received_bytes=%llu "
+           "spooled_bytes=%llu window_reads=%llu spool_reads=%llu",
+           (unsigned long long)streams_, (unsigned long long)restarts_,
+           (unsigned long long)received_bytes_,
+           (unsigned long long)spooled_bytes_,
+           (unsigned long long)window_reads_,
+           (unsigned long long)spool_reads_);
+  return buffer;
+}
+
+void HttpStreamRead::Start() {
+  started_ = true;
+  finished_ = false;
+  status_ = XRootDStatus();
+  ++streams_;
+  thread_ = std::thread(&HttpStreamRead::Run, this);
+}
+
+void HttpStreamRead::Stop(Lock& lock) {
+  if (stopping_) {
+    cond_.wait(lock, [this] { return !stopping_; });
+    return;
+  }
+
+  stopping_ = true;
+  cond_.notify_all();
+  std::thread thread = std::move(thread_);
+  lock.unlock();
+  if (thread.joinable()) thread.join();
+  lock.lock();
+
+  // The spool stays good: it's the same object whichever request sent it
+  blocks_.clear();
+  window_start_ = 0;
+  received_ = 0;
+  wanted_ = 0;
+  started_ = false;
+  finished_ = false;
+  status_ = XRootDStatus();
+  stopping_ = false;
+  cond_.notify_all();
+}
+
+void HttpStreamRead::Run() {
+  auto status = Posix::GetStream(
+      session_->context, url_, 0,
+      [this](uint64_t received, uint64_t* capacity) {
+        return Receive(received, capacity);
+      });
+  Lock lock(mutex_);
+  status_ = status;
+  finished_ = true;
+  cond_.notify_all();
+}
+
+char* HttpStreamRead::Receive(uint64_t received, uint64_t* capacity) {
+  Lock lock(mutex_);
+  if (received) {
+    received_ += received;
+    received_bytes_ += received;
+    cond_.notify_all();
+  }
+
+  // Slide the window over whole blocks; only this thread ever removes them
+  while (received_ - window_start_ > window_ && blocks_.size() > 1) {
+    if (spool_fd_ >= 0 && spooled_ == window_start_) {
+      const char* data = blocks_.front().data();
+      const uint64_t offset = window_start_;
+      lock.unlock();
+      const bool written =
+          pwrite(spool_fd_, data, kBlockSize, offset) == ssize_t(kBlockSize);
+      lock.lock();
+      if (written) {
+        spooled_ += kBlockSize;
+        spooled_bytes_ += kBlockSize;
+      }
+      else {
+        DefaultEnv::GetLog()->Error(kLogXrdClHttp,
+                                    "Could not spool %s: %s", url_.c_str(),
+                                    strerror(errno));
+      }
+    }
+    window_start_ += kBlockSize;
+    blocks_.pop_front();
+  }
+
+  // Half the window ahead of the furthest read, half kept behind it
+  cond_.wait(lock, [this] {
+    return stopping_ || received_ < wanted_ + window_ / 2;
+  });
+  if (stopping_) return nullptr;
+
+  uint64_t filled = received_ - window_start_;
+  if (!blocks_.empty()) filled -= (blocks_.size() - 1) * kBlockSize;
+  if (blocks_.empty() || filled == kBlockSize) {
+    blocks_.emplace_back(kBlockSize);
+    filled = 0;
+  }
+  *capacity = kBlockSize - filled;
+  return blocks_.back().data() + filled;
+}
+
+}  // namespace XrdCl
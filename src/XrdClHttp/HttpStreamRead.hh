@@ -0,0 +1,114 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#ifndef __HTTP_STREAM_READ_
+#define __HTTP_STREAM_READ_
+
+#include "XrdCl/XrdClXRootDResponses.hh"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Bytes of a streamed object kept in memory for out-of-order reads
+#define HTTP_PLUG_IN_STREAM_WINDOW_ENV "XRDCLHTTP_STREAM_WINDOW"
+// Directory where data leaving the window is spooled, unset disables it
+#define HTTP_PLUG_IN_STREAM_SPOOL_ENV "XRDCLHTTP_STREAM_SPOOL_DIR"
+
+// GetProperty() name returning the counters of the streaming reader
+#define HTTP_PLUG_IN_STREAM_STATS_PROPERTY "HttpStreamReadStats"
+
+namespace XrdCl {
+
+struct HttpSession;
+
+//----------------------------------------------------------------------------
+//! Reads of an object from a server that doesn't support Range, through a
+//! single GET of the whole object kept open for the life of the file.
+//!
+//! The body is received into a sliding window of the latest bytes, half of
+//! it read ahead of the furthest read and half kept behind it, so reads
+//! arriving out of order or concurrently are served from memory. Bytes
+//! leaving the window go to an unlinked spool file, when configured, so
+//! that seeking back never costs network traffic. Without one, a read
+//! behind the window restarts the GET from the beginning of the object.
+//!
+//! The request runs on its own thread rather than on the worker pool: it
+//! waits for reads that themselves need a worker.
+//----------------------------------------------------------------------------
+class HttpStreamRead {
+ public:
+  HttpStreamRead(std::shared_ptr<HttpSession> session, const std::string& url);
+
+  ~HttpStreamRead();
+
+  //--------------------------------------------------------------------------
+  //! Blocks until [offset, offset + size) has been received, or the object
+  //! ended before, and copies it to buffer
+  //--------------------------------------------------------------------------
+  std::pair<int, XRootDStatus> Read(uint64_t offset, uint32_t size,
+                                    void* buffer);
+
+  //--------------------------------------------------------------------------
+  //! Counters as "streams=N restarts=N received_bytes=N spooled_bytes=N
+  //! window_reads=N spool_reads=N"
+  //--------------------------------------------------------------------------
+  std::string GetStatistics();
+
+ private:
+  using Lock = std::unique_lock<std::mutex>;
+
+  void Start();
+
+  // Stop the request, wait for it and forget what it received
+  void Stop(Lock& lock);
+
+  void Run();
+
+  // Posix::StreamSink of the request
+  char* Receive(uint64_t received, uint64_t* capacity);
+
+  const std::shared_ptr<HttpSession> session_;
+  const std::string url_;
+  const uint64_t window_;
+  int spool_fd_;
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+
+  // Whole blocks but the last one, which the request is filling
+  std::deque<std::vector<char>> blocks_;
+  // Offset of the first byte of blocks_
+  uint64_t window_start_;
+  uint64_t received_;
+  // [0, spooled_) of the object is in the spool file
+  uint64_t spooled_;
+  // End of the furthest read so far
+  uint64_t wanted_;
+
+  bool started_;
+  bool stopping_;
+  bool finished_;
+  XRootDStatus status_;
+
+  std::thread thread_;
+
+  std::atomic<uint64_t> streams_;
+  std::atomic<uint64_t> restarts_;
+  std::atomic<uint64_t> received_bytes_;
+  std::atomic<uint64_t> spooled_bytes_;
+  std::atomic<uint64_t> window_reads_;
+  std::atomic<uint64_t> spool_reads_;
+};
+
+}  // namespace XrdCl
+
+#endif  // __HTTP_STREAM_READ_
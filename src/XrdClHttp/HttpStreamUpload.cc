@@ -0,0 +1,162 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#include "HttpStreamUpload.hh"
+
+#include <algorithm>
+#include <cstring>
+
+#include "XrdCl/XrdClDefaultEnv.hh"
+#include "XrdCl/XrdClLog.hh"
+
+#include "HttpPlugInUtil.hh"
+#include "HttpSessionPool.hh"
+#include "Posix.hh"
+
+namespace {
+
+const uint64_t kDefaultBufferSize = 8 * 1024 * 1024;
+
+}  // namespace
+
+namespace XrdCl {
+
+bool HttpStreamUpload::Enabled() {
+  return GetEnvUInt(HTTP_PLUG_IN_STREAM_UPLOAD_ENV, 0) > 0 &&
+         GetEnvUInt(HTTP_PLUG_IN_UPLOAD_BUFFER_ENV, kDefaultBufferSize) > 0;
+}
+
+HttpStreamUpload::HttpStreamUpload(std::shared_ptr<HttpSession> session,
+                                   const std::string& url, uint64_t size,
+                                   uint16_t timeout)
+    : session_(std::move(session)),
+      url_(url),
+      size_(size),
+      ring_(std::max<uint64_t>(
+          4096, std::min<uint64_t>(
+                    GetEnvUInt(HTTP_PLUG_IN_UPLOAD_BUFFER_ENV,
+                               kDefaultBufferSize),
+                    size))),
+      head_(0),
+      stored_(0),
+      written_(0),
+      sent_(0),
+      cancelled_(false),
+      finished_(false) {
+  thread_ = std::thread(&HttpStreamUpload::Run, this, timeout);
+}
+
+HttpStreamUpload::~HttpStreamUpload() {
+  Lock lock(mutex_);
+  Cancel(lock);
+}
+
+XRootDStatus HttpStreamUpload::Write(uint64_t offset, const void* buffer,
+                                     uint32_t size) {
+  Lock lock(mutex_);
+  if (finished_) {
+    return status_.IsError() ? status_ : XRootDStatus(stError, errInvalidOp);
+  }
+  if (offset != written_) {
+    return XRootDStatus(stError, errNotSupported, 0,
+                        "Streaming uploads must be written sequentially");
+  }
+  if (written_ + size > size_) {
+    return XRootDStatus(stError, errInvalidArgs, 0,
+                        "Write beyond the announced file size");
+  }
+
+  const char* input = static_cast<const char*>(buffer);
+  while (size > 0) {
+    cond_.wait(lock, [this] { return stored_ < ring_.size() || finished_; });
+    if (finished_) {
+      return status_.IsError() ? status_ : XRootDStatus(stError, errInvalidOp);
+    }
+
+    const size_t tail = (head_ + stored_) % ring_.size();
+    const size_t length = std::min<size_t>(
+        size, std::min(ring_.size() - stored_, ring_.size() - tail));
+    std::memcpy(ring_.data() + tail, input, length);
+    input += length;
+    size -= length;
+    stored_ += length;
+    written_ += length;
+    cond_.notify_all();
+  }
+  return XRootDStatus();
+}
+
+XRootDStatus HttpStreamUpload::Close() {
+  Lock lock(mutex_);
+  if (written_ != size_ && !finished_) {
+    DefaultEnv::GetLog()->Error(
+        kLogXrdClHttp,
+        "Upload of %s closed after %llu of the %llu bytes announced",
+        url_.c_str(), (unsigned long long)written_,
+        (unsigned long long)size_);
+    Cancel(lock);
+    return XRootDStatus(stError, errDataError, 0,
+                        "File shorter than its announced size");
+  }
+  cond_.wait(lock, [this] { return finished_; });
+  lock.unlock();
+  if (thread_.joinable()) thread_.join();
+  return status_;
+}
+
+dav_ssize_t HttpStreamUpload::Provide(void* userdata, char* buffer,
+                                      dav_size_t length) {
+  auto self = static_cast<HttpStreamUpload*>(userdata);
+  Lock lock(self->mutex_);
+
+  // A zero length asks to rewind, for a redirect or a retry, which only
+  // works before we sent anything
+  if (length == 0) {
+    if (self->sent_ == 0) return 0;
+    DefaultEnv::GetLog()->Error(
+        kLogXrdClHttp,
+        "Upload of %s can't be resent after %llu bytes went out, unset "
+        HTTP_PLUG_IN_STREAM_UPLOAD_ENV " for servers that redirect uploads",
+        self->url_.c_str(), (unsigned long long)self->sent_);
+    return -1;
+  }
+
+  self->cond_.wait(lock, [self] {
+    return self->stored_ > 0 || self->cancelled_ ||
+           self->sent_ == self->size_;
+  });
+  if (self->cancelled_) return -1;
+  if (self->sent_ == self->size_) return 0;
+
+  const size_t count = std::min<size_t>(
+      length, std::min(self->stored_, self->ring_.size() - self->head_));
+  std::memcpy(buffer, self->ring_.data() + self->head_, count);
+  self->head_ = (self->head_ + count) % self->ring_.size();
+  self->stored_ -= count;
+  self->sent_ += count;
+  self->cond_.notify_all();
+  return count;
+}
+
+void HttpStreamUpload::Run(uint16_t timeout) {
+  auto status = Posix::PutStream(session_->context, url_, size_, &Provide,
+                                 this, timeout);
+  Lock lock(mutex_);
+  if (status.IsOK() && cancelled_) {
+    status = XRootDStatus(stError, errOperationInterrupted);
+  }
+  status_ = status;
+  finished_ = true;
+  cond_.notify_all();
+}
+
+void HttpStreamUpload::Cancel(Lock& lock) {
+  cancelled_ = true;
+  cond_.notify_all();
+  lock.unlock();
+  if (thread_.joinable()) thread_.join();
+  lock.lock();
+}
+
+}  // namespace XrdCl
@@ -0,0 +1,102 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#ifndef __HTTP_STREAM_UPLOAD_
+#define __HTTP_STREAM_UPLOAD_
+
+#include <davix.hpp>
+
+#include "XrdCl/XrdClXRootDResponses.hh"
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Set to 1 to stream uploads of known size instead of sending them on close
+#define HTTP_PLUG_IN_STREAM_UPLOAD_ENV "XRDCLHTTP_STREAM_UPLOAD"
+// Size in bytes of the ring buffer of streaming uploads, 0 disables them
+#define HTTP_PLUG_IN_UPLOAD_BUFFER_ENV "XRDCLHTTP_UPLOAD_BUFFER"
+
+namespace XrdCl {
+
+struct HttpSession;
+
+//----------------------------------------------------------------------------
+//! Upload of one file as a single PUT started at open time. Sequential
+//! writes go into a fixed-size ring buffer which the request drains onto
+//! the socket as it goes, so memory use doesn't depend on the file size and
+//! data flows while the file is being written.
+//!
+//! The request runs on its own thread rather than on the worker pool: it
+//! waits for writes that themselves need a worker.
+//!
+//! Bytes sent are gone from the ring buffer, so the body can't be rewound:
+//! a redirect or a retry after the first bytes went out fails the upload.
+//! Hence streaming is opt-in, for servers known to take the PUT directly.
+//----------------------------------------------------------------------------
+class HttpStreamUpload {
+ public:
+  static bool Enabled();
+
+  //--------------------------------------------------------------------------
+  //! Starts the PUT of exactly size bytes
+  //--------------------------------------------------------------------------
+  HttpStreamUpload(std::shared_ptr<HttpSession> session,
+                   const std::string& url, uint64_t size, uint16_t timeout);
+
+  //--------------------------------------------------------------------------
+  //! Fails the request if Close() didn't complete it
+  //--------------------------------------------------------------------------
+  ~HttpStreamUpload();
+
+  //--------------------------------------------------------------------------
+  //! Append data at offset, which must be where the previous write ended.
+  //! Blocks while the ring buffer is full.
+  //--------------------------------------------------------------------------
+  XRootDStatus Write(uint64_t offset, const void* buffer, uint32_t size);
+
+  //--------------------------------------------------------------------------
+  //! Wait for the request to finish and return its outcome
+  //--------------------------------------------------------------------------
+  XRootDStatus Close();
+
+ private:
+  using Lock = std::unique_lock<std::mutex>;
+
+  // Davix::HttpBodyProvider, called by the request for more of the body
+  static dav_ssize_t Provide(void* userdata, char* buffer, dav_size_t length);
+
+  void Run(uint16_t timeout);
+
+  // Stop feeding the request, which then fails, and wait for it
+  void Cancel(Lock& lock);
+
+  const std::shared_ptr<HttpSession> session_;
+  const std::string url_;
+  const uint64_t size_;
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+
+  std::vector<char> ring_;
+  // Position of the oldest unsent byte and number of bytes stored
+  size_t head_;
+  size_t stored_;
+
+  uint64_t written_;
+  uint64_t sent_;
+  bool cancelled_;
+  bool finished_;
+  XRootDStatus status_;
+
+  std::thread thread_;
+};
+
+}  // namespace XrdCl
+
+#endif  // __HTTP_STREAM_UPLOAD_
@@ -0,0 +1,117 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#include "HttpTrace.hh"
+
+#include <cstdio>
+
+#include "XrdCl/XrdClDefaultEnv.hh"
+#include "XrdCl/XrdClLog.hh"
+
+#include "HttpPlugInUtil.hh"
+
+namespace {
+
+thread_local XrdCl::HttpTrace* current = nullptr;
+
+uint64_t SlowThreshold() {
+  static const uint64_t threshold =
+      XrdCl::GetEnvUInt(HTTP_PLUG_IN_SLOW_MS_ENV, 0);
+  return threshold;
+}
+
+bool Tracing() {
+  return SlowThreshold() > 0 ||
+         XrdCl::DefaultEnv::GetLog()->GetLevel() >= XrdCl::Log::DebugMsg;
+}
+
+double Millis(int64_t nanos) { return nanos / 1e6; }
+
+}  // namespace
+
+namespace XrdCl {
+
+HttpTrace::HttpTrace(const char* operation, const std::string& url,
+                     Clock::time_point queued)
+    : active_(Tracing()),
+      operation_(operation),
+      queued_(queued),
+      previous_(current),
+      requests_(0),
+      bytes_(0) {
+  if (!active_) return;
+
+  url_ = url;
+  for (auto& nanos : nanos_) nanos.store(0);
+  Add(kQueue, Clock::now() - queued_);
+  current = this;
+}
+
+HttpTrace::~HttpTrace() {
+  if (!active_) return;
+  current = previous_;
+
+  const int64_t total = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            Clock::now() - queued_)
+                            .count();
+  const uint64_t threshold = SlowThreshold();
+  const bool slow = threshold > 0 && total >= int64_t(threshold) * 1000000;
+
+  auto logger = DefaultEnv::GetLog();
+  if (!slow && logger->GetLevel() < Log::DebugMsg) return;
+
+  char breakdown[256];
+  snprintf(breakdown, sizeof(breakdown),
+           "total=%.3fms queue=%.3fms request=%.3fms transfer=%.3fms "
+           "requests=%llu bytes=%llu",
+           Millis(total), Millis(nanos_[kQueue]), Millis(nanos_[kRequest]),
+           Millis(nanos_[kTransfer]), (unsigned long long)requests_.load(),
+           (unsigned long long)bytes_.load());
+  if (slow) {
+    logger->Warning(kLogXrdClHttp, "Slow %s of %s: %s", operation_,
+                    url_.c_str(), breakdown);
+  }
+  else {
+    logger->Debug(kLogXrdClHttp, "%s of %s: %s", operation_, url_.c_str(),
+                  breakdown);
+  }
+}
+
+HttpTrace* HttpTrace::Current() { return current; }
+
+void HttpTrace::Add(Phase phase, Clock::duration elapsed) {
+  nanos_[phase].fetch_add(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+      std::memory_order_relaxed);
+}
+
+HttpTrace::Adopt::Adopt(HttpTrace* trace) : previous_(current) {
+  current = trace;
+}
+
+HttpTrace::Adopt::~Adopt() { current = previous_; }
+
+HttpTrace::Timer::Timer(Phase phase) : trace_(current), phase_(phase) {
+  if (!trace_) return;
+  trace_->requests_.fetch_add(1, std::memory_order_relaxed);
+  since_ = Clock::now();
+}
+
+HttpTrace::Timer::~Timer() {
+  if (trace_) trace_->Add(phase_, Clock::now() - since_);
+}
+
+void HttpTrace::Timer::Switch(Phase phase) {
+  if (!trace_) return;
+  const auto now = Clock::now();
+  trace_->Add(phase_, now - since_);
+  phase_ = phase;
+  since_ = now;
+}
+
+void HttpTrace::Timer::AddBytes(uint64_t bytes) {
+  if (trace_) trace_->bytes_.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+}  // namespace XrdCl
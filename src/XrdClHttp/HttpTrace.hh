@@ -0,0 +1,100 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#ifndef __HTTP_TRACE_
+#define __HTTP_TRACE_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Operations slower than this many milliseconds are logged as warnings with
+// their phase breakdown, 0 (the default) disables it
+#define HTTP_PLUG_IN_SLOW_MS_ENV "XRDCLHTTP_SLOW_MS"
+
+namespace XrdCl {
+
+//----------------------------------------------------------------------------
+//! Where the time of one operation went: waiting for a worker, waiting for
+//! the answers of its HTTP requests (connection setup, name resolution and
+//! TLS handshake included, which Davix doesn't report apart), and receiving
+//! them. Operations are traced when the log level is Debug, each one
+//! logged, or when XRDCLHTTP_SLOW_MS is set, the slower ones logged as
+//! warnings; otherwise tracing costs a thread-local read per request.
+//!
+//! The trace is attached to the thread running the operation; the requests
+//! made under it, in Posix, time themselves with a Timer. Work spread over
+//! several threads carries the trace along with Adopt, and its request
+//! times are then summed.
+//----------------------------------------------------------------------------
+class HttpTrace {
+ public:
+  enum Phase { kQueue, kRequest, kTransfer, kNumPhases };
+
+  using Clock = std::chrono::steady_clock;
+
+  //--------------------------------------------------------------------------
+  //! Trace operation on url, submitted at queued, until destruction
+  //--------------------------------------------------------------------------
+  HttpTrace(const char* operation, const std::string& url,
+            Clock::time_point queued);
+  ~HttpTrace();
+
+  //--------------------------------------------------------------------------
+  //! The operation the calling thread is working for, nullptr if untraced
+  //--------------------------------------------------------------------------
+  static HttpTrace* Current();
+
+  //--------------------------------------------------------------------------
+  //! Makes trace the current one of the calling thread while in scope
+  //--------------------------------------------------------------------------
+  class Adopt {
+   public:
+    explicit Adopt(HttpTrace* trace);
+    ~Adopt();
+
+   private:
+    HttpTrace* previous_;
+  };
+
+  //--------------------------------------------------------------------------
+  //! Times one request of the current operation, phase by phase, from
+  //! construction to destruction
+  //--------------------------------------------------------------------------
+  class Timer {
+   public:
+    explicit Timer(Phase phase);
+    ~Timer();
+
+    //------------------------------------------------------------------------
+    //! The answer arrived, e.g. kRequest to kTransfer
+    //------------------------------------------------------------------------
+    void Switch(Phase phase);
+
+    void AddBytes(uint64_t bytes);
+
+   private:
+    HttpTrace* const trace_;
+    Phase phase_;
+    Clock::time_point since_;
+  };
+
+ private:
+  void Add(Phase phase, Clock::duration elapsed);
+
+  const bool active_;
+  const char* const operation_;
+  std::string url_;
+  const Clock::time_point queued_;
+  HttpTrace* const previous_;
+
+  std::atomic<int64_t> nanos_[kNumPhases];
+  std::atomic<uint64_t> requests_;
+  std::atomic<uint64_t> bytes_;
+};
+
+}  // namespace XrdCl
+
+#endif  // __HTTP_TRACE_
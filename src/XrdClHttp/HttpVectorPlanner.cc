@@ -0,0 +1,121 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#include "HttpVectorPlanner.hh"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "HttpPlugInUtil.hh"
+
+namespace {
+
+const uint64_t kDefaultGap = 64 * 1024;
+const uint64_t kDefaultFanOut = 4;
+
+// Budget for the Range header of one request: servers commonly refuse
+// request headers past 8 KiB in total
+const size_t kMaxRangeHeader = 4000;
+
+}  // namespace
+
+namespace XrdCl {
+
+HttpVectorPlanner& HttpVectorPlanner::Instance() {
+  static HttpVectorPlanner* planner = new HttpVectorPlanner(
+      GetEnvUInt(HTTP_PLUG_IN_VECTOR_GAP_ENV, kDefaultGap),
+      std::max<uint64_t>(
+          1, GetEnvUInt(HTTP_PLUG_IN_VECTOR_FANOUT_ENV, kDefaultFanOut)));
+  return *planner;
+}
+
+HttpVectorPlanner::HttpVectorPlanner(uint64_t gap, unsigned fan_out)
+    : gap_(gap),
+      fan_out_(fan_out),
+      vector_reads_(0),
+      chunks_(0),
+      requests_(0),
+      ranges_(0),
+      overread_bytes_(0),
+      copied_bytes_(0),
+      discarded_bytes_(0) {}
+
+std::vector<HttpVectorPlanner::Batch> HttpVectorPlanner::Plan(
+    const ChunkList& chunks) {
+  std::vector<size_t> order(chunks.size());
+  for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+  std::sort(order.begin(), order.end(), [&chunks](size_t a, size_t b) {
+    return chunks[a].offset < chunks[b].offset;
+  });
+
+  std::vector<Range> ranges;
+  uint64_t requested = 0;
+  for (auto i : order) {
+    const auto& chunk = chunks[i];
+    requested += chunk.length;
+    if (!ranges.empty()) {
+      auto& last = ranges.back();
+      const uint64_t end = last.offset + last.length;
+      // Overlapping chunks merge whatever the gap threshold
+      if (chunk.offset <= end + gap_) {
+        last.length = std::max(end, chunk.offset + chunk.length) - last.offset;
+        last.chunks.push_back(i);
+        continue;
+      }
+    }
+    ranges.push_back(Range{chunk.offset, chunk.length, {i}});
+  }
+
+  uint64_t total = 0;
+  for (const auto& range : ranges) total += range.length;
+
+  // Split evenly enough for the fan-out, and within the header budget
+  const uint64_t target = (total + fan_out_ - 1) / fan_out_;
+  std::vector<Batch> batches;
+  size_t header = 0;
+  uint64_t bytes = 0;
+  for (auto& range : ranges) {
+    // "first-last," in decimal
+    const size_t length = std::to_string(range.offset).size() +
+                          std::to_string(range.offset + range.length - 1)
+                              .size() + 2;
+    if (batches.empty() || header + length > kMaxRangeHeader ||
+        bytes >= target) {
+      batches.emplace_back();
+      header = 0;
+      bytes = 0;
+    }
+    header += length;
+    bytes += range.length;
+    batches.back().push_back(std::move(range));
+  }
+
+  ++vector_reads_;
+  chunks_ += chunks.size();
+  requests_ += batches.size();
+  ranges_ += ranges.size();
+  // Gaps read in merged ranges, net of overlapping chunks
+  if (total > requested) overread_bytes_ += total - requested;
+  return batches;
+}
+
+void HttpVectorPlanner::Delivered(uint64_t copied, uint64_t discarded) {
+  copied_bytes_ += copied;
+  discarded_bytes_ += discarded;
+}
+
+std::string HttpVectorPlanner::GetStatistics() {
+  char buffer[256];
+  snprintf(buffer, sizeof(buffer),
+           "vector_reads=%llu chunks=%llu requests=%llu ranges=%llu "
+           "overread_bytes=%llu copied_bytes=%llu discarded_bytes=%llu",
+           (unsigned long long)vector_reads_, (unsigned long long)chunks_,
+           (unsigned long long)requests_, (unsigned long long)ranges_,
+           (unsigned long long)overread_bytes_,
+           (unsigned long long)copied_bytes_,
+           (unsigned long long)discarded_bytes_);
+  return buffer;
+}
+
+}  // namespace XrdCl
@@ -0,0 +1,80 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#ifndef __HTTP_VECTOR_PLANNER_
+#define __HTTP_VECTOR_PLANNER_
+
+#include "XrdCl/XrdClXRootDResponses.hh"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Largest gap in bytes between two chunks read as one range rather than two
+#define HTTP_PLUG_IN_VECTOR_GAP_ENV "XRDCLHTTP_VECTOR_GAP"
+// Number of requests of one VectorRead in flight at the same time
+#define HTTP_PLUG_IN_VECTOR_FANOUT_ENV "XRDCLHTTP_VECTOR_FANOUT"
+
+// GetProperty() name returning the vector read planner counters
+#define HTTP_PLUG_IN_VECTOR_STATS_PROPERTY "HttpVectorReadStats"
+
+namespace XrdCl {
+
+//----------------------------------------------------------------------------
+//! Turns the chunk list of a VectorRead into multi-range requests: chunks
+//! are sorted, chunks closer than the gap threshold are merged into one
+//! range (reading the gap is cheaper than another range), and the ranges
+//! are split into batches small enough for a Range header and balanced so
+//! that the fan-out can run them concurrently.
+//----------------------------------------------------------------------------
+class HttpVectorPlanner {
+ public:
+  struct Range {
+    uint64_t offset;
+    uint64_t length;
+    // Indices, in the planned chunk list, of the chunks the range covers
+    std::vector<size_t> chunks;
+  };
+
+  // The ranges of one request
+  using Batch = std::vector<Range>;
+
+  static HttpVectorPlanner& Instance();
+
+  std::vector<Batch> Plan(const ChunkList& chunks);
+
+  unsigned GetFanOut() const { return fan_out_; }
+
+  //--------------------------------------------------------------------------
+  //! Account for a request's answer: bytes copied between chunk buffers
+  //! (overlapping chunks) and bytes read but thrown away (gaps, or whole
+  //! objects from servers ignoring Range)
+  //--------------------------------------------------------------------------
+  void Delivered(uint64_t copied, uint64_t discarded);
+
+  //--------------------------------------------------------------------------
+  //! Counters as "vector_reads=N chunks=N requests=N ranges=N
+  //! overread_bytes=N copied_bytes=N discarded_bytes=N"
+  //--------------------------------------------------------------------------
+  std::string GetStatistics();
+
+ private:
+  HttpVectorPlanner(uint64_t gap, unsigned fan_out);
+
+  const uint64_t gap_;
+  const unsigned fan_out_;
+
+  std::atomic<uint64_t> vector_reads_;
+  std::atomic<uint64_t> chunks_;
+  std::atomic<uint64_t> requests_;
+  std::atomic<uint64_t> ranges_;
+  std::atomic<uint64_t> overread_bytes_;
+  std::atomic<uint64_t> copied_bytes_;
+  std::atomic<uint64_t> discarded_bytes_;
+};
+
+}  // namespace XrdCl
+
+#endif  // __HTTP_VECTOR_PLANNER_
@@ -8,6 +8,9 @@
 
 #include "Posix.hh"
 
+#include "HttpCredentials.hh"
+#include "HttpTrace.hh"
+
 #include "XProtocol/XProtocol.hh"
 #include "XrdCl/XrdClStatus.hh"
 #include "XrdCl/XrdClXRootDResponses.hh"
@@ -16,7 +19,14 @@
 #include "davix/auth/davixx509cred.hpp"
 #include "davix/auth/davixauth.hpp"
 
+#include <algorithm>
+#include <cctype>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 
 namespace {
 
@@ -62,122 +72,56 @@ void SetTimeout(Davix::RequestParams& params, uint16_t timeout) {
   params.setOperationRetryDelay(2);
 }
 
-XrdCl::XRootDStatus FillStatInfo(const struct stat& stats, XrdCl::StatInfo* stat_info) {
-  std::ostringstream data;
+// Straight from the stat, where a formatted "id size flags mtime" string
+// would have to be parsed back
+XrdCl::StatInfo* NewStatInfo(const struct stat& stats) {
+  uint32_t flags;
   if (S_ISDIR(stats.st_mode)) {
-    data << stats.st_dev << " " << stats.st_size << " " 
-         << (XrdCl::StatInfo::Flags::IsDir | XrdCl::StatInfo::Flags::IsReadable | 
-             XrdCl::StatInfo::Flags::IsWritable | XrdCl::StatInfo::Flags::XBitSet)
-         << " " << stats.st_mtime;
+    flags = XrdCl::StatInfo::Flags::IsDir | XrdCl::StatInfo::Flags::IsReadable |
+            XrdCl::StatInfo::Flags::IsWritable | XrdCl::StatInfo::Flags::XBitSet;
   }
-  else {
-    if (getenv("AWS_ACCESS_KEY_ID")) {
-        data << stats.st_dev << " " << stats.st_size << " " 
-             << XrdCl::StatInfo::Flags::IsReadable << " " << stats.st_mtime;
-    }
-    else {
-        data << stats.st_dev << " " << stats.st_size << " " 
-             << stats.st_mode << " " << stats.st_mtime;
-    }
-
+  else if (XrdCl::HttpCredentials::Instance().S3AccessKeySet()) {
+    flags = XrdCl::StatInfo::Flags::IsReadable;
   }
-
-  if (!stat_info->ParseServerResponse(data.str().c_str())) {
-    return XrdCl::XRootDStatus(XrdCl::stError, XrdCl::errDataError);
+  else {
+    flags = stats.st_mode;
   }
-
-  return XrdCl::XRootDStatus();
+  return new XrdCl::StatInfo(std::to_string(stats.st_dev), stats.st_size,
+                             flags, stats.st_mtime);
 }
 
-// return NULL if no X509 proxy is found 
-//Davix::X509Credential* LoadX509UserCredential() {
-//  std::string myX509proxyFile;
-//  if (getenv("X509_USER_PROXY") != NULL)
-//    myX509proxyFile = getenv("X509_USER_PROXY");
-//  else
-//    myX509proxyFile = "/tmp/x509up_u" + std::to_string(geteuid());
-//  
-//  struct stat myX509proxyStat;
-//  Davix::X509Credential* myX509proxy = NULL;
-//  if (stat(myX509proxyFile.c_str(), &myX509proxyStat) == 0) {
-//    myX509proxy = new Davix::X509Credential();
-//    myX509proxy->loadFromFilePEM(myX509proxyFile.c_str(), myX509proxyFile.c_str(), "", NULL);
-//  }
-//  return myX509proxy;
-//}
-
 // see auth/davixauth.hpp
 int LoadX509UserCredentialCallBack(void *userdata, 
                                    const Davix::SessionInfo &info,
                                    Davix::X509Credential *cert,
                                    Davix::DavixError **err) {
-  std::string myX509proxyFile;
-  if (getenv("X509_USER_PROXY") != NULL)
-    myX509proxyFile = getenv("X509_USER_PROXY");
-  else
-    myX509proxyFile = "/tmp/x509up_u" + std::to_string(geteuid());
-  
-  struct stat myX509proxyStat;
-  if (stat(myX509proxyFile.c_str(), &myX509proxyStat) == 0)
-    return cert->loadFromFilePEM(myX509proxyFile.c_str(), myX509proxyFile.c_str(), "", err);
-  else
-    return 1;
+  return XrdCl::HttpCredentials::Instance().LoadX509(cert, err);
 }
 
 void SetX509(Davix::RequestParams& params) {
   params.setClientCertCallbackX509(&LoadX509UserCredentialCallBack, NULL);
-
-  //Davix::X509Credential* myX509proxy = LoadX509UserCredential();
-  //if (myX509proxy != NULL) {
-  //  params.setClientCertX509(*myX509proxy);
-  //  delete myX509proxy;
-  //}
-
-  if (getenv("X509_CERT_DIR") != NULL)
-    params.addCertificateAuthorityPath(getenv("X509_CERT_DIR"));
-  else
-    params.addCertificateAuthorityPath("/etc/grid-security/certificates");      
+  params.addCertificateAuthorityPath(
+      XrdCl::HttpCredentials::Instance().GetCaPath());
 }
 
 void SetAuthS3(Davix::RequestParams& params) {
   //Davix::setLogScope(DAVIX_LOG_SCOPE_ALL);
   //Davix::setLogScope(DAVIX_LOG_HEADER | DAVIX_LOG_S3);
   //Davix::setLogLevel(DAVIX_LOG_TRACE);
+  const auto& keys = XrdCl::HttpCredentials::Instance().GetS3Keys();
   params.setProtocol(Davix::RequestProtocol::AwsS3);
-  params.setAwsAuthorizationKeys(getenv("AWS_SECRET_ACCESS_KEY"),
-                                 getenv("AWS_ACCESS_KEY_ID"));
+  params.setAwsAuthorizationKeys(keys.secret_key, keys.access_key);
   params.setAwsAlternate(true);
-  // if AWS region is not set, Davix will use the old AWS signature v2
-  if (getenv("AWS_REGION")) 
-     params.setAwsRegion(getenv("AWS_REGION"));
-  else if (! getenv("AWS_SIGNATURE_V2"))
-     params.setAwsRegion("mars");
+  if (!keys.region.empty()) params.setAwsRegion(keys.region);
 }
 
 void SetAuthz(Davix::RequestParams& params) {
-  if (getenv("AWS_ACCESS_KEY_ID") && getenv("AWS_SECRET_ACCESS_KEY"))
+  if (XrdCl::HttpCredentials::Instance().S3Enabled())
     SetAuthS3(params);
   else
     SetX509(params);
 }
 
-std::string SanitizedURL(const std::string& url) {
-  XrdCl::URL xurl(url);
-  std::string path = xurl.GetPath();
-  if (path.find("/") != 0) path = "/" + path;
-  std::string returl = xurl.GetProtocol() + "://" 
-                     + xurl.GetHostName() + ":"
-                     + std::to_string(xurl.GetPort())
-                     + path;
-  // for s3 storage using AWS_ACCESS_KEY_ID, filter out all CGIs
-  // Known issues:
-  // Google cloud storage does not like ?xrd.gsiusrpxy=/tmp/..., Will fail Stat()
-  if (! getenv("AWS_ACCESS_KEY_ID") && ! xurl.GetParamsAsString().empty()) {
-    returl = returl + xurl.GetParamsAsString();
-  }
-  return returl;
-}
-
 // check davix/include/davix/status/davixstatusrequest.hpp and
 // XProtocol/XProtocol.hh (XErrorCode) for corresponding error codes.
 std::pair<uint16_t, XErrorCode> ErrCodeConvert(Davix::StatusCode::Code code) {
@@ -191,19 +135,141 @@ std::pair<uint16_t, XErrorCode> ErrCodeConvert(Davix::StatusCode::Code code) {
     return std::make_pair(XrdCl::errErrorResponse, kXR_InvalidRequest);  
 }
 
+// Same as ErrCodeConvert, for requests issued through Davix::HttpRequest
+XrdCl::XRootDStatus HttpCodeConvert(int code) {
+  XErrorCode errNo = kXR_InvalidRequest;
+  if (code == 404)
+    errNo = kXR_NotFound;
+  else if (code == 401 || code == 403)
+    errNo = kXR_NotAuthorized;
+  else if (code >= 500)
+    errNo = kXR_ServerError;
+  return XrdCl::XRootDStatus(XrdCl::stError, XrdCl::errErrorResponse, errNo,
+                             "HTTP status " + std::to_string(code));
+}
+
+std::string HttpDate(time_t when) {
+  struct tm tm;
+  gmtime_r(&when, &tm);
+  char date[64];
+  strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+  return date;
+}
+
+// Percent-encoding of a query parameter value, as S3 signs it
+std::string QueryEscape(const std::string& value) {
+  static const char kHex[] = "0123456789ABCDEF";
+  std::string escaped;
+  for (unsigned char c : value) {
+    if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+      escaped += c;
+    }
+    else {
+      escaped += '%';
+      escaped += kHex[c >> 4];
+      escaped += kHex[c & 15];
+    }
+  }
+  return escaped;
+}
+
+bool ParseHttpDate(const std::string& value, time_t* when) {
+  struct tm tm = {};
+  if (!strptime(value.c_str(), "%a, %d %b %Y %H:%M:%S", &tm)) return false;
+  *when = timegm(&tm);
+  return true;
+}
+
+// Posix::CanonicalURL() of the URLs seen lately. Nothing in the result
+// changes during the life of the process, so entries never go stale; a
+// full shard is simply emptied.
+class URLCache {
+ public:
+  bool Get(const std::string& url, std::string* sanitized) {
+    auto& shard = ShardFor(url);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.urls.find(url);
+    if (it == shard.urls.end()) return false;
+    *sanitized = it->second;
+    return true;
+  }
+
+  void Put(const std::string& url, const std::string& sanitized) {
+    auto& shard = ShardFor(url);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (shard.urls.size() >= kMaxURLsPerShard) shard.urls.clear();
+    shard.urls[url] = sanitized;
+  }
+
+ private:
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<std::string, std::string> urls;
+  };
+
+  static const size_t kNumShards = 16;
+  static const size_t kMaxURLsPerShard = 512;
+
+  Shard& ShardFor(const std::string& url) {
+    return shards_[std::hash<std::string>()(url) % kNumShards];
+  }
+
+  Shard shards_[kNumShards];
+};
+
 }  // namespace
 
 namespace Posix {
 
 using namespace XrdCl;
 
+Davix::RequestParams NewRequestParams() {
+  Davix::RequestParams params;
+  SetTimeout(params, 0);
+  SetAuthz(params);
+  return params;
+}
+
+const Davix::RequestParams& RequestTemplate() {
+  static const Davix::RequestParams* params =
+      new Davix::RequestParams(NewRequestParams());
+  return *params;
+}
+
+std::string SanitizedURL(const std::string& url) {
+  static URLCache* cache = new URLCache();
+  std::string sanitized;
+  if (cache->Get(url, &sanitized)) return sanitized;
+  sanitized = CanonicalURL(url);
+  cache->Put(url, sanitized);
+  return sanitized;
+}
+
+std::string CanonicalURL(const std::string& url) {
+  XrdCl::URL xurl(url);
+  std::string path = xurl.GetPath();
+  if (path.find("/") != 0) path = "/" + path;
+  std::string returl = xurl.GetProtocol() + "://" 
+                     + xurl.GetHostName() + ":"
+                     + std::to_string(xurl.GetPort())
+                     + path;
+  // for s3 storage using AWS_ACCESS_KEY_ID, filter out all CGIs
+  // Known issues:
+  // Google cloud storage does not like ?xrd.gsiusrpxy=/tmp/..., Will fail Stat()
+  if (!HttpCredentials::Instance().S3AccessKeySet() &&
+      !xurl.GetParamsAsString().empty()) {
+    returl = returl + xurl.GetParamsAsString();
+  }
+  return returl;
+}
+
+
 std::pair<DAVIX_FD*, XRootDStatus> Open(Davix::DavPosix& davix_client,
                                         const std::string& url, int flags,
                                         uint16_t timeout) {
-  Davix::RequestParams params;
-  SetTimeout(params, timeout);
-  SetAuthz(params);
+  const auto& params = RequestTemplate();
   Davix::DavixError* err = nullptr;
+  HttpTrace::Timer timer(HttpTrace::kRequest);
   DAVIX_FD* fd = davix_client.open(&params, SanitizedURL(url), flags, &err);
   XRootDStatus status;
   if (!fd) {
@@ -219,6 +285,7 @@ std::pair<DAVIX_FD*, XRootDStatus> Open(Davix::DavPosix& davix_client,
 
 XRootDStatus Close(Davix::DavPosix& davix_client, DAVIX_FD* fd) {
   Davix::DavixError* err = nullptr;
+  HttpTrace::Timer timer(HttpTrace::kRequest);
   if (davix_client.close(fd, &err)) {
     auto errStatus =
         XRootDStatus(stError, errInternal, err->getStatus(), err->getErrMsg());
@@ -235,12 +302,11 @@ XRootDStatus MkDir(Davix::DavPosix& davix_client, const std::string& path,
 
   return XRootDStatus();
 
-  Davix::RequestParams params;
-  SetTimeout(params, timeout);
-  SetAuthz(params);
+  const auto& params = RequestTemplate();
 
   auto DoMkDir = [&davix_client, &params](const std::string& path) {
     Davix::DavixError* err = nullptr;
+    HttpTrace::Timer timer(HttpTrace::kRequest);
     if (davix_client.mkdir(&params, SanitizedURL(path), S_IRWXU, &err) &&
         (err->getStatus() != Davix::StatusCode::FileExist)) {
       auto errStatus = XRootDStatus(stError, errInternal, err->getStatus(),
@@ -281,11 +347,10 @@ XRootDStatus MkDir(Davix::DavPosix& davix_client, const std::string& path,
 
 XRootDStatus RmDir(Davix::DavPosix& davix_client, const std::string& path,
                    uint16_t timeout) {
-  Davix::RequestParams params;
-  SetTimeout(params, timeout);
-  SetAuthz(params);
+  const auto& params = RequestTemplate();
 
   Davix::DavixError* err = nullptr;
+  HttpTrace::Timer timer(HttpTrace::kRequest);
   if (davix_client.rmdir(&params, path, &err)) {
     auto errStatus =
         XRootDStatus(stError, errInternal, err->getStatus(), err->getErrMsg());
@@ -296,61 +361,77 @@ XRootDStatus RmDir(Davix::DavPosix& davix_client, const std::string& path,
   return XRootDStatus();
 }
 
-std::pair<XrdCl::DirectoryList*, XrdCl::XRootDStatus> DirList(
-    Davix::DavPosix& davix_client, const std::string& path, bool details,
-    bool /*recursive*/, uint16_t timeout) {
-  Davix::RequestParams params;
-  SetTimeout(params, timeout);
-  SetAuthz(params);
-
-  auto dir_list = new DirectoryList();
+XRootDStatus DirList(Davix::DavPosix& davix_client, const std::string& path,
+                     bool details, uint16_t timeout, size_t batch_size,
+                     const DirListSink& sink) {
+  const auto& params = RequestTemplate();
 
   Davix::DavixError* err = nullptr;
 
+  HttpTrace::Timer timer(HttpTrace::kRequest);
   auto dir_fd = davix_client.opendirpp(&params, SanitizedURL(path), &err);
   if (!dir_fd) {
     auto errStatus = XRootDStatus(stError, errInternal, err->getStatus(),
                                   err->getErrMsg());
     delete err;
-    return std::make_pair(nullptr, errStatus);
+    return errStatus;
   }
 
+  // Davix parses the PROPFIND answer as it arrives, so batches go out while
+  // the rest of the listing is still on the wire
+  timer.Switch(HttpTrace::kTransfer);
+  std::unique_ptr<DirectoryList> batch(new DirectoryList());
+  bool stopped = false;
   struct stat info;
   while (auto entry = davix_client.readdirpp(dir_fd, &info, &err)) {
-    if (err) {
-      auto errStatus = XRootDStatus(stError, errInternal, err->getStatus(),
-                                    err->getErrMsg());
-      delete err;
-      return std::make_pair(nullptr, errStatus);
-    }
+    if (err) break;
 
-    StatInfo* stat_info = nullptr;
-    if (details) {
-      stat_info = new StatInfo();
-      auto res = FillStatInfo(info, stat_info);
-      if (res.IsError()) {
-        delete entry;
-        delete stat_info;
-        return std::make_pair(nullptr, res);
-      }
-    }
-
-    auto list_entry = new DirectoryList::ListEntry(path, entry->d_name, stat_info);
-    dir_list->Add(list_entry);
+    batch->Add(new DirectoryList::ListEntry(
+        path, entry->d_name, details ? NewStatInfo(info) : nullptr));
 
     // do not delete "entry". davix_client.readdirpp() always return the same address
     // and will set it to NULL when there is no more directory entry to return 
     //delete entry;
+
+    if (batch->GetSize() >= batch_size) {
+      if (!sink(batch.release())) {
+        stopped = true;
+        break;
+      }
+      batch.reset(new DirectoryList());
+    }
+  }
+
+  if (err) {
+    auto errStatus = XRootDStatus(stError, errInternal, err->getStatus(),
+                                  err->getErrMsg());
+    delete err;
+    davix_client.closedirpp(dir_fd, nullptr);
+    return errStatus;
   }
 
   if (davix_client.closedirpp(dir_fd, &err)) {
     auto errStatus = XRootDStatus(stError, errInternal, err->getStatus(),
                                   err->getErrMsg());
     delete err;
-    return std::make_pair(nullptr, errStatus);
+    return errStatus;
   }
 
-  return std::make_pair(dir_list, XRootDStatus());
+  if (!stopped && batch->GetSize()) sink(batch.release());
+  return XRootDStatus();
+}
+
+std::pair<XrdCl::DirectoryList*, XrdCl::XRootDStatus> DirList(
+    Davix::DavPosix& davix_client, const std::string& path, bool details,
+    uint16_t timeout) {
+  std::unique_ptr<DirectoryList> dir_list(new DirectoryList());
+  auto status = DirList(davix_client, path, details, timeout, SIZE_MAX,
+                        [&dir_list](DirectoryList* batch) {
+                          dir_list.reset(batch);
+                          return true;
+                        });
+  if (status.IsError()) return std::make_pair(nullptr, status);
+  return std::make_pair(dir_list.release(), status);
 }
 
 XRootDStatus Rename(Davix::DavPosix& davix_client, const std::string& source,
@@ -360,14 +441,13 @@ XRootDStatus Rename(Davix::DavPosix& davix_client, const std::string& source,
   // 1. do not support rename, especially for files that were uploaded using multi-part
   // 2. support by copy-n-delete.
   // we could implement copy-n-delete if necessary
-  if (getenv("AWS_ACCESS_KEY_ID"))
+  if (HttpCredentials::Instance().S3AccessKeySet())
       return XRootDStatus(stError, errErrorResponse, kXR_Unsupported);
 
-  Davix::RequestParams params;
-  SetTimeout(params, timeout);
-  SetAuthz(params);
+  const auto& params = RequestTemplate();
 
   Davix::DavixError* err = nullptr;
+  HttpTrace::Timer timer(HttpTrace::kRequest);
   if (davix_client.rename(&params, SanitizedURL(source), SanitizedURL(dest), &err)) {
     auto errStatus =
         XRootDStatus(stError, errInternal, err->getStatus(), err->getErrMsg());
@@ -379,13 +459,12 @@ XRootDStatus Rename(Davix::DavPosix& davix_client, const std::string& source,
 }
 
 XRootDStatus Stat(Davix::DavPosix& davix_client, const std::string& url,
-                  uint16_t timeout, StatInfo* stat_info) {
-  Davix::RequestParams params;
-  SetTimeout(params, timeout);
-  SetAuthz(params);
+                  uint16_t timeout, StatInfo** stat_info) {
+  const auto& params = RequestTemplate();
 
   struct stat stats;
   Davix::DavixError* err = nullptr;
+  HttpTrace::Timer timer(HttpTrace::kRequest);
   if (davix_client.stat(&params, SanitizedURL(url), &stats, &err)) {
     auto res = ErrCodeConvert(err->getStatus());
     auto errStatus =
@@ -394,21 +473,16 @@ XRootDStatus Stat(Davix::DavPosix& davix_client, const std::string& url,
     return errStatus;
   }
 
-  auto res = FillStatInfo(stats, stat_info);
-  if (res.IsError()) {
-    return res;
-  }
-
+  *stat_info = NewStatInfo(stats);
   return XRootDStatus();
 }
 
 XRootDStatus Unlink(Davix::DavPosix& davix_client, const std::string& url,
                     uint16_t timeout) {
-  Davix::RequestParams params;
-  SetTimeout(params, timeout);
-  SetAuthz(params);
+  const auto& params = RequestTemplate();
 
   Davix::DavixError* err = nullptr;
+  HttpTrace::Timer timer(HttpTrace::kRequest);
   if (davix_client.unlink(&params, SanitizedURL(url), &err)) {
     auto errStatus =
         XRootDStatus(stError, errInternal, err->getStatus(), err->getErrMsg());
@@ -424,6 +498,8 @@ std::pair<int, XRootDStatus> _PRead(Davix::DavPosix& davix_client, DAVIX_FD* fd,
                                     uint64_t offset, bool no_pread = false) {
   Davix::DavixError* err = nullptr;
   int num_bytes_read;
+  // Davix answers with the data, the transfer can't be told apart
+  HttpTrace::Timer timer(HttpTrace::kRequest);
   if (no_pread) { // continue reading from the current offset position
     num_bytes_read = davix_client.read(fd, buffer, size, &err); 
   }
@@ -437,6 +513,7 @@ std::pair<int, XRootDStatus> _PRead(Davix::DavPosix& davix_client, DAVIX_FD* fd,
     return std::make_pair(num_bytes_read, errStatus);
   }
 
+  timer.AddBytes(num_bytes_read);
   return std::make_pair(num_bytes_read, XRootDStatus());
 }
 
@@ -450,30 +527,246 @@ std::pair<int, XRootDStatus> PRead(Davix::DavPosix& davix_client, DAVIX_FD* fd,
   return _PRead(davix_client, fd, buffer, size, offset, false);
 }
 
-std::pair<int, XrdCl::XRootDStatus> PReadVec(Davix::DavPosix& davix_client,
-                                             DAVIX_FD* fd,
-                                             const XrdCl::ChunkList& chunks,
-                                             void* buffer) {
-  const auto num_chunks = chunks.size();
-  std::vector<Davix::DavIOVecInput> input_vector(num_chunks);
-  std::vector<Davix::DavIOVecOuput> output_vector(num_chunks);
+XRootDStatus ReadRanges(Davix::Context& context, const std::string& url,
+                        uint16_t timeout,
+                        const std::vector<std::pair<uint64_t, uint64_t>>& ranges,
+                        XrdCl::HttpRangeReader& reader,
+                        const std::function<void()>& answered,
+                        const std::atomic<bool>* cancelled) {
+  const auto& params = RequestTemplate();
 
-  for (size_t i = 0; i < num_chunks; ++i) {
-    input_vector[i].diov_offset = chunks[i].offset;
-    input_vector[i].diov_size = chunks[i].length;
-    input_vector[i].diov_buffer = chunks[i].buffer;
+  Davix::DavixError* err = nullptr;
+  Davix::GetRequest request(context, Davix::Uri(SanitizedURL(url)), &err);
+  if (err) {
+    auto errStatus =
+        XRootDStatus(stError, errInternal, err->getStatus(), err->getErrMsg());
+    delete err;
+    return errStatus;
+  }
+  request.setParameters(params);
+
+  std::string header = "bytes=";
+  for (const auto& range : ranges) {
+    if (header.size() > 6) header += ",";
+    header += std::to_string(range.first) + "-" +
+              std::to_string(range.first + range.second - 1);
+  }
+  request.addHeaderField("Range", header);
+
+  HttpTrace::Timer timer(HttpTrace::kRequest);
+  if (request.beginRequest(&err)) {
+    auto res = ErrCodeConvert(err->getStatus());
+    auto errStatus =
+        XRootDStatus(stError, res.first, res.second, err->getErrMsg());
+    delete err;
+    return errStatus;
+  }
+
+  timer.Switch(HttpTrace::kTransfer);
+  if (answered) answered();
+  auto source = [&request, &err, &timer, cancelled](char* buffer,
+                                                    uint64_t size) -> int64_t {
+    if (cancelled && cancelled->load(std::memory_order_relaxed)) return -1;
+    const auto num_bytes_read = request.readSegment(buffer, size, &err);
+    if (num_bytes_read > 0) timer.AddBytes(num_bytes_read);
+    return num_bytes_read;
+  };
+
+  const int code = request.getRequestCode();
+  std::string value;
+  XRootDStatus status;
+  if (code == 206 && request.getAnswerHeader("Content-Type", value) &&
+      value.find("multipart/byteranges") != std::string::npos) {
+    // "multipart/byteranges; boundary=THIS_STRING_SEPARATES"
+    auto pos = value.find("boundary=");
+    std::string boundary;
+    if (pos != std::string::npos) {
+      boundary = value.substr(pos + 9, value.find(';', pos) - pos - 9);
+      if (boundary.size() > 1 && boundary.front() == '"')
+        boundary = boundary.substr(1, boundary.size() - 2);
+    }
+    status = boundary.empty()
+                 ? XRootDStatus(stError, errErrorResponse, kXR_ServerError,
+                                "Multipart response without a boundary")
+                 : reader.ReadMultipart(boundary, source);
+  }
+  else if (code == 206 && request.getAnswerHeader("Content-Range", value)) {
+    // "bytes 0-1023/4096": the server may have coalesced the ranges
+    const auto pos = value.find("bytes");
+    char* next = nullptr;
+    const uint64_t first =
+        pos == std::string::npos
+            ? 0 : strtoull(value.c_str() + pos + 5, &next, 10);
+    const uint64_t last =
+        next && *next == '-' ? strtoull(next + 1, nullptr, 10) : 0;
+    status = next && *next == '-' && last >= first
+                 ? reader.ReadPart(first, last - first + 1, source)
+                 : XRootDStatus(stError, errErrorResponse, kXR_ServerError,
+                                "Malformed Content-Range");
+  }
+  else if (code == 200 && request.getAnswerHeader("Content-Length", value)) {
+    status = reader.ReadPart(0, strtoull(value.c_str(), nullptr, 10), source);
+  }
+  else {
+    request.endRequest(&err);
+    delete err;
+    return code >= 300 ? HttpCodeConvert(code)
+                       : XRootDStatus(stError, errErrorResponse,
+                                      kXR_ServerError,
+                                      "Unexpected answer to a range request");
+  }
+
+  if (err) {
+    status =
+        XRootDStatus(stError, errInternal, err->getStatus(), err->getErrMsg());
+    delete err;
+    err = nullptr;
+  }
+  // Drops the connection if the answer was not read to its end
+  request.endRequest(&err);
+  delete err;
+
+  if (status.IsOK() && !reader.Complete()) {
+    status = XRootDStatus(stError, errErrorResponse, kXR_ServerError,
+                          "Range response misses requested bytes");
   }
+  return status;
+}
+
+XRootDStatus Revalidate(Davix::Context& context, const std::string& url,
+                        uint16_t timeout, time_t mtime, uint64_t size,
+                        bool* modified) {
+  const auto& params = RequestTemplate();
 
   Davix::DavixError* err = nullptr;
-  int num_bytes_read = davix_client.preadVec(
-      fd, input_vector.data(), output_vector.data(), num_chunks, &err);
-  if (num_bytes_read < 0) {
+  Davix::HeadRequest request(context, Davix::Uri(SanitizedURL(url)), &err);
+  if (err) {
     auto errStatus =
         XRootDStatus(stError, errInternal, err->getStatus(), err->getErrMsg());
     delete err;
-    return std::make_pair(num_bytes_read, XRootDStatus(stError, errUnknown));
+    return errStatus;
+  }
+  request.setParameters(params);
+  request.addHeaderField("If-Modified-Since", HttpDate(mtime));
+
+  HttpTrace::Timer timer(HttpTrace::kRequest);
+  if (request.executeRequest(&err)) {
+    auto res = ErrCodeConvert(err->getStatus());
+    auto errStatus =
+        XRootDStatus(stError, res.first, res.second, err->getErrMsg());
+    delete err;
+    return errStatus;
   }
 
+  const int code = request.getRequestCode();
+  *modified = false;
+  if (code == 304) {
+    return XRootDStatus();
+  }
+  if (code >= 400) {
+    return HttpCodeConvert(code);
+  }
+
+  // Servers ignoring If-Modified-Since answer with the full headers: compare
+  // the validators ourselves
+  std::string value;
+  if (request.getAnswerHeader("Content-Length", value) &&
+      strtoull(value.c_str(), nullptr, 10) != size) {
+    *modified = true;
+  }
+  time_t last_modified;
+  if (request.getAnswerHeader("Last-Modified", value) &&
+      ParseHttpDate(value, &last_modified) && last_modified != mtime) {
+    *modified = true;
+  }
+
+  return XRootDStatus();
+}
+
+std::pair<int, XrdCl::XRootDStatus> ReadHead(Davix::Context& context,
+                                             const std::string& url,
+                                             uint16_t timeout, void* buffer,
+                                             uint32_t size,
+                                             uint64_t* object_size,
+                                             time_t* mtime) {
+  const auto& params = RequestTemplate();
+
+  Davix::DavixError* err = nullptr;
+  Davix::GetRequest request(context, Davix::Uri(SanitizedURL(url)), &err);
+  if (err) {
+    auto errStatus =
+        XRootDStatus(stError, errInternal, err->getStatus(), err->getErrMsg());
+    delete err;
+    return std::make_pair(-1, errStatus);
+  }
+  request.setParameters(params);
+  request.addHeaderField("Range", "bytes=0-" + std::to_string(size - 1));
+
+  HttpTrace::Timer timer(HttpTrace::kRequest);
+  if (request.beginRequest(&err)) {
+    auto res = ErrCodeConvert(err->getStatus());
+    auto errStatus =
+        XRootDStatus(stError, res.first, res.second, err->getErrMsg());
+    delete err;
+    return std::make_pair(-1, errStatus);
+  }
+
+  const int code = request.getRequestCode();
+  std::string value;
+  bool sized = false;
+  if (code == 206 || code == 416) {
+    // "bytes 0-1023/4096", or "bytes */0" for an empty object
+    if (request.getAnswerHeader("Content-Range", value)) {
+      auto pos = value.find('/');
+      if (pos != std::string::npos && value[pos + 1] != '*') {
+        *object_size = strtoull(value.c_str() + pos + 1, nullptr, 10);
+        sized = true;
+      }
+    }
+  }
+  else if (code == 200) {
+    // Range ignored: the whole object follows, of which we keep the head
+    if (request.getAnswerHeader("Content-Length", value)) {
+      *object_size = strtoull(value.c_str(), nullptr, 10);
+      sized = true;
+    }
+  }
+  else {
+    request.endRequest(&err);
+    delete err;
+    return std::make_pair(-1, HttpCodeConvert(code));
+  }
+
+  if (!sized) {
+    request.endRequest(&err);
+    delete err;
+    return std::make_pair(
+        -1, XRootDStatus(stError, errErrorResponse, kXR_InvalidRequest,
+                         "No object size in the response"));
+  }
+
+  *mtime = 0;
+  if (request.getAnswerHeader("Last-Modified", value))
+    ParseHttpDate(value, mtime);
+
+  dav_ssize_t num_bytes_read = 0;
+  timer.Switch(HttpTrace::kTransfer);
+  if (code != 416) {
+    num_bytes_read = request.readSegment(
+        static_cast<char*>(buffer),
+        std::min<uint64_t>(size, *object_size), &err);
+    if (num_bytes_read < 0) {
+      auto errStatus = XRootDStatus(stError, errInternal, err->getStatus(),
+                                    err->getErrMsg());
+      delete err;
+      return std::make_pair(-1, errStatus);
+    }
+    timer.AddBytes(num_bytes_read);
+  }
+  // Drops the connection if the rest of a full answer is still pending
+  request.endRequest(&err);
+  delete err;
+
   return std::make_pair(num_bytes_read, XRootDStatus());
 }
 
@@ -482,6 +775,7 @@ std::pair<int, XrdCl::XRootDStatus> PWrite(Davix::DavPosix& davix_client,
                                            uint32_t size, const void* buffer,
                                            uint16_t timeout) {
   Davix::DavixError* err = nullptr;
+  HttpTrace::Timer timer(HttpTrace::kRequest);
   off_t new_offset = davix_client.lseek(fd, offset, SEEK_SET, &err);
   if (uint64_t(new_offset) != offset) {
     auto errStatus =
@@ -497,7 +791,280 @@ std::pair<int, XrdCl::XRootDStatus> PWrite(Davix::DavPosix& davix_client,
     return std::make_pair(num_bytes_written, errStatus);
   }
 
+  timer.AddBytes(num_bytes_written);
   return std::make_pair(num_bytes_written, XRootDStatus());
 }
 
+std::pair<std::vector<std::string>, XRootDStatus> Replicas(
+    Davix::Context& context, const std::string& url, uint16_t timeout) {
+  const auto& params = RequestTemplate();
+
+  HttpTrace::Timer timer(HttpTrace::kRequest);
+  Davix::DavixError* err = nullptr;
+  Davix::DavFile file(context, Davix::Uri(SanitizedURL(url)));
+  auto replicas = file.getReplicas(&params, &err);
+  if (err) {
+    auto res = ErrCodeConvert(err->getStatus());
+    auto errStatus =
+        XRootDStatus(stError, res.first, res.second, err->getErrMsg());
+    delete err;
+    return std::make_pair(std::vector<std::string>(), errStatus);
+  }
+
+  std::vector<std::string> urls;
+  for (const auto& replica : replicas) {
+    urls.push_back(replica.getUri().getString());
+  }
+  return std::make_pair(urls, XRootDStatus());
+}
+
+XRootDStatus Put(Davix::Context& context, const std::string& url,
+                 const void* buffer, uint64_t size, uint16_t timeout) {
+  const auto& params = RequestTemplate();
+
+  Davix::DavixError* err = nullptr;
+  Davix::PutRequest request(context, Davix::Uri(SanitizedURL(url)), &err);
+  if (err) {
+    auto errStatus =
+        XRootDStatus(stError, errInternal, err->getStatus(), err->getErrMsg());
+    delete err;
+    return errStatus;
+  }
+  request.setParameters(params);
+  request.setRequestBody(buffer, size);
+
+  HttpTrace::Timer timer(HttpTrace::kRequest);
+  timer.AddBytes(size);
+  if (request.executeRequest(&err)) {
+    auto res = ErrCodeConvert(err->getStatus());
+    auto errStatus =
+        XRootDStatus(stError, res.first, res.second, err->getErrMsg());
+    delete err;
+    return errStatus;
+  }
+
+  const int code = request.getRequestCode();
+  if (code < 200 || code >= 300) {
+    return HttpCodeConvert(code);
+  }
+  return XRootDStatus();
+}
+
+XRootDStatus PutStream(Davix::Context& context, const std::string& url,
+                       uint64_t size, Davix::HttpBodyProvider provider,
+                       void* userdata, uint16_t timeout) {
+  const auto& params = RequestTemplate();
+
+  Davix::DavixError* err = nullptr;
+  Davix::PutRequest request(context, Davix::Uri(SanitizedURL(url)), &err);
+  if (err) {
+    auto errStatus =
+        XRootDStatus(stError, errInternal, err->getStatus(), err->getErrMsg());
+    delete err;
+    return errStatus;
+  }
+  request.setParameters(params);
+  request.setRequestBody(provider, size, userdata);
+
+  HttpTrace::Timer timer(HttpTrace::kRequest);
+  timer.AddBytes(size);
+  if (request.executeRequest(&err)) {
+    auto res = ErrCodeConvert(err->getStatus());
+    auto errStatus =
+        XRootDStatus(stError, res.first, res.second, err->getErrMsg());
+    delete err;
+    return errStatus;
+  }
+
+  const int code = request.getRequestCode();
+  if (code < 200 || code >= 300) {
+    return HttpCodeConvert(code);
+  }
+  return XRootDStatus();
+}
+
+XRootDStatus GetStream(Davix::Context& context, const std::string& url,
+                       uint16_t timeout, const StreamSink& sink) {
+  const auto& params = RequestTemplate();
+
+  Davix::DavixError* err = nullptr;
+  Davix::GetRequest request(context, Davix::Uri(SanitizedURL(url)), &err);
+  if (err) {
+    auto errStatus =
+        XRootDStatus(stError, errInternal, err->getStatus(), err->getErrMsg());
+    delete err;
+    return errStatus;
+  }
+  request.setParameters(params);
+
+  HttpTrace::Timer timer(HttpTrace::kRequest);
+  if (request.beginRequest(&err)) {
+    auto res = ErrCodeConvert(err->getStatus());
+    auto errStatus =
+        XRootDStatus(stError, res.first, res.second, err->getErrMsg());
+    delete err;
+    return errStatus;
+  }
+
+  const int code = request.getRequestCode();
+  if (code != 200) {
+    request.endRequest(&err);
+    delete err;
+    return HttpCodeConvert(code);
+  }
+
+  timer.Switch(HttpTrace::kTransfer);
+  uint64_t capacity = 0;
+  for (char* buffer = sink(0, &capacity); buffer;) {
+    dav_ssize_t num_bytes_read = request.readBlock(buffer, capacity, &err);
+    if (num_bytes_read < 0) {
+      auto errStatus = XRootDStatus(stError, errInternal, err->getStatus(),
+                                    err->getErrMsg());
+      delete err;
+      return errStatus;
+    }
+    if (num_bytes_read == 0) break;
+    timer.AddBytes(num_bytes_read);
+    buffer = sink(num_bytes_read, &capacity);
+  }
+
+  // Drops the connection if the sink stopped before the end of the body
+  request.endRequest(&err);
+  delete err;
+  return XRootDStatus();
+}
+
+std::pair<std::string, XRootDStatus> ListObjects(
+    Davix::Context& context, const std::string& bucket_url,
+    const std::string& prefix, const std::string& delimiter,
+    const std::string& continuation_token, unsigned max_keys,
+    uint16_t timeout) {
+  const auto& params = RequestTemplate();
+
+  std::string query = "?list-type=2&max-keys=" + std::to_string(max_keys) +
+                      "&prefix=" + QueryEscape(prefix);
+  if (!delimiter.empty()) query += "&delimiter=" + QueryEscape(delimiter);
+  if (!continuation_token.empty())
+    query += "&continuation-token=" + QueryEscape(continuation_token);
+
+  Davix::DavixError* err = nullptr;
+  Davix::GetRequest request(
+      context, Davix::Uri(SanitizedURL(bucket_url) + query), &err);
+  if (err) {
+    auto errStatus =
+        XRootDStatus(stError, errInternal, err->getStatus(), err->getErrMsg());
+    delete err;
+    return std::make_pair(std::string(), errStatus);
+  }
+  request.setParameters(params);
+
+  HttpTrace::Timer timer(HttpTrace::kRequest);
+  if (request.executeRequest(&err)) {
+    auto res = ErrCodeConvert(err->getStatus());
+    auto errStatus =
+        XRootDStatus(stError, res.first, res.second, err->getErrMsg());
+    delete err;
+    return std::make_pair(std::string(), errStatus);
+  }
+
+  const int code = request.getRequestCode();
+  if (code != 200) {
+    return std::make_pair(std::string(), HttpCodeConvert(code));
+  }
+  const auto& body = request.getAnswerContentVec();
+  timer.AddBytes(body.size());
+  return std::make_pair(std::string(body.begin(), body.end()),
+                        XRootDStatus());
+}
+
+std::pair<std::string, XRootDStatus> InitiateUpload(Davix::Context& context,
+                                                     const std::string& url,
+                                                     uint16_t timeout) {
+  const auto& params = RequestTemplate();
+
+  HttpTrace::Timer timer(HttpTrace::kRequest);
+  try {
+    Davix::DavFile file(context, Davix::Uri(SanitizedURL(url)));
+    return std::make_pair(file.initiateMultipartUpload(&params),
+                          XRootDStatus());
+  } catch (const Davix::DavixException& e) {
+    auto res = ErrCodeConvert(e.code());
+    return std::make_pair(std::string(),
+                          XRootDStatus(stError, res.first, res.second, e.what()));
+  }
+}
+
+std::pair<std::string, XRootDStatus> UploadPart(
+    Davix::Context& context, const std::string& url,
+    const std::string& upload_id, int part_number, const void* buffer,
+    uint64_t size, uint16_t timeout) {
+  const auto& params = RequestTemplate();
+
+  HttpTrace::Timer timer(HttpTrace::kRequest);
+  timer.AddBytes(size);
+  try {
+    Davix::DavFile file(context, Davix::Uri(SanitizedURL(url)));
+    Davix::BufferContentProvider provider(static_cast<const char*>(buffer),
+                                          size);
+    return std::make_pair(
+        file.uploadPart(&params, upload_id, part_number, provider),
+        XRootDStatus());
+  } catch (const Davix::DavixException& e) {
+    auto res = ErrCodeConvert(e.code());
+    return std::make_pair(std::string(),
+                          XRootDStatus(stError, res.first, res.second, e.what()));
+  }
+}
+
+XRootDStatus CompleteUpload(Davix::Context& context, const std::string& url,
+                            const std::string& upload_id,
+                            const std::vector<std::string>& etags,
+                            uint16_t timeout) {
+  const auto& params = RequestTemplate();
+
+  HttpTrace::Timer timer(HttpTrace::kRequest);
+  try {
+    Davix::DavFile file(context, Davix::Uri(SanitizedURL(url)));
+    file.commitMultipartUpload(&params, upload_id, etags);
+  } catch (const Davix::DavixException& e) {
+    auto res = ErrCodeConvert(e.code());
+    return XRootDStatus(stError, res.first, res.second, e.what());
+  }
+  return XRootDStatus();
+}
+
+XRootDStatus AbortUpload(Davix::Context& context, const std::string& url,
+                         const std::string& upload_id, uint16_t timeout) {
+  const auto& params = RequestTemplate();
+
+  // Davix has no call for it: DELETE on the object with the upload id
+  Davix::DavixError* err = nullptr;
+  Davix::DeleteRequest request(
+      context,
+      Davix::Uri(SanitizedURL(url) + "?uploadId=" + QueryEscape(upload_id)),
+      &err);
+  if (err) {
+    auto errStatus =
+        XRootDStatus(stError, errInternal, err->getStatus(), err->getErrMsg());
+    delete err;
+    return errStatus;
+  }
+  request.setParameters(params);
+
+  HttpTrace::Timer timer(HttpTrace::kRequest);
+  if (request.executeRequest(&err)) {
+    auto res = ErrCodeConvert(err->getStatus());
+    auto errStatus =
+        XRootDStatus(stError, res.first, res.second, err->getErrMsg());
+    delete err;
+    return errStatus;
+  }
+
+  const int code = request.getRequestCode();
+  if (code < 200 || code >= 300) {
+    return HttpCodeConvert(code);
+  }
+  return XRootDStatus();
+}
+
 }  // namespace Posix
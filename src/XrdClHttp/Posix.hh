@@ -10,8 +10,14 @@
 #include "XrdCl/XrdClFileSystem.hh"
 #include "XrdCl/XrdClXRootDResponses.hh"
 
+#include "HttpRangeReader.hh"
+
+#include <atomic>
 #include <cstdint>
+#include <ctime>
+#include <functional>
 #include <string>
+#include <vector>
 
 namespace XrdCl {
 
@@ -20,6 +26,20 @@ class StatInfo;
 
 namespace Posix {
 
+// Canonical form of url as sent to Davix: explicit port, absolute path, and
+// no CGI when talking to S3. Remembered for the URLs seen lately.
+std::string SanitizedURL(const std::string& url);
+
+// What SanitizedURL() computes, parsing url every time
+std::string CanonicalURL(const std::string& url);
+
+// Parameters with the timeouts and credentials of every request, built from
+// scratch
+Davix::RequestParams NewRequestParams();
+
+// NewRequestParams() built once, and shared read-only by all requests
+const Davix::RequestParams& RequestTemplate();
+
 std::pair<DAVIX_FD*, XrdCl::XRootDStatus> Open(Davix::DavPosix& davix_client,
                                                const std::string& url,
                                                int flags, uint16_t timeout);
@@ -34,16 +54,30 @@ XrdCl::XRootDStatus MkDir(Davix::DavPosix& davix_client,
 XrdCl::XRootDStatus RmDir(Davix::DavPosix& davix_client,
                           const std::string& path, uint16_t timeout);
 
+// One level of a directory; recursive listings are built on top of it by
+// the HttpDirCrawler
 std::pair<XrdCl::DirectoryList*, XrdCl::XRootDStatus> DirList(
     Davix::DavPosix& davix_client, const std::string& path, bool details,
-    bool recursive, uint16_t timeout);
+    uint16_t timeout);
+
+// Takes over each batch of a streamed listing; false stops the listing
+using DirListSink = std::function<bool(XrdCl::DirectoryList* batch)>;
+
+// DirList() handing the entries over as they are parsed, in batches of up
+// to batch_size, instead of building the whole listing in memory. Nothing
+// is passed to sink for an empty directory.
+XrdCl::XRootDStatus DirList(Davix::DavPosix& davix_client,
+                            const std::string& path, bool details,
+                            uint16_t timeout, size_t batch_size,
+                            const DirListSink& sink);
 
 XrdCl::XRootDStatus Rename(Davix::DavPosix& davix_client,
                            const std::string& source, const std::string& dest,
                            uint16_t timeout);
 
+// On success, stat_info is set to a new StatInfo
 XrdCl::XRootDStatus Stat(Davix::DavPosix& davix_client, const std::string& url,
-                         uint16_t timeout, XrdCl::StatInfo* stat_info);
+                         uint16_t timeout, XrdCl::StatInfo** stat_info);
 
 XrdCl::XRootDStatus Unlink(Davix::DavPosix& davix_client,
                            const std::string& url, uint16_t timeout);
@@ -56,16 +90,93 @@ std::pair<int, XrdCl::XRootDStatus> PRead(Davix::DavPosix& davix_client,
                                           DAVIX_FD* fd, void* buffer,
                                           uint32_t size, uint64_t offset);
 
-std::pair<int, XrdCl::XRootDStatus> PReadVec(Davix::DavPosix& davix_client,
-                                             DAVIX_FD* fd,
-                                             const XrdCl::ChunkList& chunks,
-                                             void* buffer);
+// One GET for all the ranges, [offset, offset + length) each, the answer
+// being handed to reader whether it is multipart, a single part or, from
+// servers ignoring Range, the whole object. answered, if set, is called
+// once the answer headers are in; setting cancelled aborts the transfer.
+XrdCl::XRootDStatus ReadRanges(
+    Davix::Context& context, const std::string& url, uint16_t timeout,
+    const std::vector<std::pair<uint64_t, uint64_t>>& ranges,
+    XrdCl::HttpRangeReader& reader,
+    const std::function<void()>& answered = nullptr,
+    const std::atomic<bool>* cancelled = nullptr);
 
 std::pair<int, XrdCl::XRootDStatus> PWrite(Davix::DavPosix& davix_client,
                                            DAVIX_FD* fd, uint64_t offset,
                                            uint32_t size, const void* buffer,
                                            uint16_t timeout);
 
+// Conditional HEAD (If-Modified-Since): modified is set when the object no
+// longer matches mtime/size
+XrdCl::XRootDStatus Revalidate(Davix::Context& context, const std::string& url,
+                               uint16_t timeout, time_t mtime, uint64_t size,
+                               bool* modified);
+
+// Ranged GET of the first size bytes of url, which also tells the object's
+// size (Content-Range or Content-Length) and Last-Modified time, 0 when the
+// server doesn't send one. Returns the number of bytes read into buffer.
+std::pair<int, XrdCl::XRootDStatus> ReadHead(Davix::Context& context,
+                                             const std::string& url,
+                                             uint16_t timeout, void* buffer,
+                                             uint32_t size,
+                                             uint64_t* object_size,
+                                             time_t* mtime);
+
+// URLs of the replicas of url listed in its Metalink, which Davix looks
+// up from the server's answers. Fails when the server publishes none.
+std::pair<std::vector<std::string>, XrdCl::XRootDStatus> Replicas(
+    Davix::Context& context, const std::string& url, uint16_t timeout);
+
+// Single PUT of a whole object
+XrdCl::XRootDStatus Put(Davix::Context& context, const std::string& url,
+                        const void* buffer, uint64_t size, uint16_t timeout);
+
+// PUT of size bytes pulled from provider as the request goes, so that the
+// body never has to be held in memory at once
+XrdCl::XRootDStatus PutStream(Davix::Context& context, const std::string& url,
+                              uint64_t size, Davix::HttpBodyProvider provider,
+                              void* userdata, uint16_t timeout);
+
+// Where a streamed GET puts the next bytes of the body: called with the
+// number of bytes received into the previous buffer (0 the first time), it
+// returns the next buffer and its capacity, or nullptr to stop reading
+using StreamSink = std::function<char*(uint64_t received, uint64_t* capacity)>;
+
+// GET of the whole object, without Range, its body read straight into the
+// buffers sink hands out until the end of the object or until sink stops
+XrdCl::XRootDStatus GetStream(Davix::Context& context, const std::string& url,
+                              uint16_t timeout, const StreamSink& sink);
+
+// One page of the S3 ListObjectsV2 listing of bucket_url, the XML answer
+// returned as is. delimiter and continuation_token are left out when empty.
+std::pair<std::string, XrdCl::XRootDStatus> ListObjects(
+    Davix::Context& context, const std::string& bucket_url,
+    const std::string& prefix, const std::string& delimiter,
+    const std::string& continuation_token, unsigned max_keys,
+    uint16_t timeout);
+
+// S3 multipart upload lifecycle. InitiateUpload returns the upload id and
+// UploadPart the ETag of the part, both to be passed to CompleteUpload.
+std::pair<std::string, XrdCl::XRootDStatus> InitiateUpload(
+    Davix::Context& context, const std::string& url, uint16_t timeout);
+
+std::pair<std::string, XrdCl::XRootDStatus> UploadPart(
+    Davix::Context& context, const std::string& url,
+    const std::string& upload_id, int part_number, const void* buffer,
+    uint64_t size, uint16_t timeout);
+
+XrdCl::XRootDStatus CompleteUpload(Davix::Context& context,
+                                   const std::string& url,
+                                   const std::string& upload_id,
+                                   const std::vector<std::string>& etags,
+                                   uint16_t timeout);
+
+// Drops the parts uploaded so far
+XrdCl::XRootDStatus AbortUpload(Davix::Context& context,
+                                const std::string& url,
+                                const std::string& upload_id,
+                                uint16_t timeout);
+
 }  // namespace Posix
 
 #endif  // __HTTP_STAT_
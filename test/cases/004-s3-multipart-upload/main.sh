@@ -0,0 +1,54 @@
+TEST_CASE_NAME="Multipart upload to and listing of an S3 bucket"
+
+test_init() {
+    require_test_server
+
+    local num_files=3
+
+    mkdir -p $WORKSPACE/in
+    mkdir -p $WORKSPACE/out
+    mkdir -p $WORKSPACE/s3/bucket
+
+    # 12 MiB each, three parts of XRDCLHTTP_S3_PART_SIZE
+    for i in $(seq 1 $num_files); do
+        head -c 12582912 /dev/urandom > $WORKSPACE/in/file$i
+    done
+
+    start_test_server $WORKSPACE/s3 8080 --s3 testkey:testsecret
+}
+
+test_main() {
+    export AWS_ACCESS_KEY_ID=testkey
+    export AWS_SECRET_ACCESS_KEY=testsecret
+    export XRDCLHTTP_S3_PART_SIZE=5242880
+    local log=$WORKSPACE/server-8080.log
+
+    for f in $(ls $WORKSPACE/in/) ; do
+        echo "Uploading: $WORKSPACE/in/$f"
+        #XRD_LOGLEVEL=Debug \
+        xrdcp -f --silent $WORKSPACE/in/$f http://localhost:8080/bucket/dir/$f
+        xrdcp -f --silent http://localhost:8080/bucket/dir/$f $WORKSPACE/out/$f
+        compare_files $WORKSPACE/in/$f $WORKSPACE/out/$f
+
+        grep -q "^POST /bucket/dir/$f?uploads" $log ||
+            die "Error: no multipart upload of $f was initiated"
+        grep -q "^PUT /bucket/dir/$f?.*partNumber=3" $log ||
+            die "Error: $f was not uploaded in three parts"
+    done
+
+    echo "Listing: http://localhost:8080/bucket/dir"
+    local listed=$(xrdfs http://localhost:8080 ls /bucket/dir | xargs -n 1 basename | sort | tr '\n' ' ')
+    local expected=$(ls $WORKSPACE/in/ | sort | tr '\n' ' ')
+    if [ x"$listed" != x"$expected" ]; then
+        echo "Error: incorrect listing of http://localhost:8080/bucket/dir"
+        echo "  Expected: $expected"
+        echo "    Listed: $listed"
+        exit 1
+    fi
+    grep -q "^GET /bucket/*?list-type=2" $log ||
+        die "Error: the bucket was not listed with ListObjectsV2"
+}
+
+test_finalize() {
+    stop_test_servers
+}
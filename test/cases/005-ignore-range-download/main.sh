@@ -0,0 +1,41 @@
+TEST_CASE_NAME="Download files from a server ignoring Range"
+
+test_init() {
+    require_test_server
+
+    local num_files=3
+
+    mkdir -p $WORKSPACE/in
+    mkdir -p $WORKSPACE/out
+
+    # Several reads each, past the first block fetched at open
+    for i in $(seq 1 $num_files); do
+        head -c 3145728 /dev/urandom > $WORKSPACE/in/file$i
+    done
+
+    start_test_server $WORKSPACE/in 8080 --ignore-range
+}
+
+test_main() {
+    local log=$WORKSPACE/server-8080.log
+
+    for f in $(ls $WORKSPACE/in/) ; do
+        echo "Downloading: $WORKSPACE/in/$f"
+        #XRD_LOGLEVEL=Debug \
+        xrdcp -f --silent http://localhost:8080/$f $WORKSPACE/out/$f
+        compare_files $WORKSPACE/in/$f $WORKSPACE/out/$f
+
+        # Streamed through a single GET kept open for the whole file
+        echo "Streaming: $WORKSPACE/in/$f"
+        local before=$(grep -c "^GET /$f " $log)
+        XRDCLHTTP_AVOIDRANGE=1 \
+        xrdcp -f --silent http://localhost:8080/$f $WORKSPACE/out/$f.stream
+        compare_files $WORKSPACE/in/$f $WORKSPACE/out/$f.stream
+        local gets=$(( $(grep -c "^GET /$f " $log) - before ))
+        [ $gets -eq 1 ] || die "Error: $f was streamed with $gets GETs"
+    done
+}
+
+test_finalize() {
+    stop_test_servers
+}
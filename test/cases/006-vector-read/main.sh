@@ -0,0 +1,53 @@
+TEST_CASE_NAME="Vector read answered as multipart/byteranges"
+
+test_init() {
+    require_test_server
+
+    # The XRootD Python bindings issue the vector read
+    PYTHONPATH=$(ls -d $XROOTD_PREFIX/lib*/python3*/site-packages 2> /dev/null | tr '\n' ':')$PYTHONPATH
+    export PYTHONPATH
+    python3 -c "import XRootD.client" 2> /dev/null ||
+        skip_test "the XRootD Python bindings are not installed"
+
+    mkdir -p $WORKSPACE/in
+    head -c 4194304 /dev/urandom > $WORKSPACE/in/data
+
+    start_test_server $WORKSPACE/in 8080
+}
+
+test_main() {
+    # Chunks too far apart to be merged, all in one request
+    export XRDCLHTTP_VECTOR_FANOUT=1
+
+    echo "Vector reading: http://localhost:8080/data"
+    python3 - http://localhost:8080/data $WORKSPACE/in/data <<'EOF' || exit 1
+import sys
+from XRootD import client
+
+url, path = sys.argv[1:3]
+chunks = [(offset, 4096) for offset in range(1 << 20, 4 << 20, 512 << 10)]
+with open(path, "rb") as f:
+    data = f.read()
+
+f = client.File()
+status, _ = f.open(url)
+if not status.ok:
+    sys.exit("Error: could not open %s: %s" % (url, status.message))
+status, info = f.vector_read(chunks)
+if not status.ok:
+    sys.exit("Error: vector read of %s failed: %s" % (url, status.message))
+if len(info.chunks) != len(chunks):
+    sys.exit("Error: %d chunks read out of %d" % (len(info.chunks), len(chunks)))
+for chunk in info.chunks:
+    if chunk.buffer != data[chunk.offset:chunk.offset + chunk.length]:
+        sys.exit("Error: incorrect data at offset %d" % chunk.offset)
+f.close()
+EOF
+
+    grep -q "^GET /data 206 bytes=[0-9-]*," $WORKSPACE/server-8080.log ||
+        die "Error: the chunks were not read with a multi-range request"
+}
+
+test_finalize() {
+    stop_test_servers
+}
@@ -0,0 +1,42 @@
+TEST_CASE_NAME="Upload and download through connection resets and errors"
+
+test_init() {
+    require_test_server
+
+    local num_files=2
+
+    mkdir -p $WORKSPACE/in
+    mkdir -p $WORKSPACE/out
+    mkdir -p $WORKSPACE/s3/bucket
+
+    for i in $(seq 1 $num_files); do
+        head -c 20971520 /dev/urandom > $WORKSPACE/in/file$i
+    done
+
+    # Only the part uploads and ranged reads fail, the requests retried
+    start_test_server $WORKSPACE/s3 8080 --s3 testkey:testsecret \
+        --data-faults --reset 5 --error 5 --seed 1
+}
+
+test_main() {
+    export AWS_ACCESS_KEY_ID=testkey
+    export AWS_SECRET_ACCESS_KEY=testsecret
+    export XRDCLHTTP_S3_PART_SIZE=5242880
+    # Every read of xrdcp split into parts
+    export XRDCLHTTP_READ_SPLIT_MIN=1048576
+    local log=$WORKSPACE/server-8080.log
+
+    for f in $(ls $WORKSPACE/in/) ; do
+        echo "Uploading: $WORKSPACE/in/$f"
+        #XRD_LOGLEVEL=Debug \
+        xrdcp -f --silent $WORKSPACE/in/$f http://localhost:8080/bucket/$f
+        xrdcp -f --silent http://localhost:8080/bucket/$f $WORKSPACE/out/$f
+        compare_files $WORKSPACE/in/$f $WORKSPACE/out/$f
+    done
+
+    echo "Faults injected: $(grep -c -e ' 503 ' -e ' reset$' $log)"
+}
+
+test_finalize() {
+    stop_test_servers
+}
@@ -0,0 +1,39 @@
+TEST_CASE_NAME="Fail over between the replicas of files"
+
+test_init() {
+    require_test_server
+
+    local num_files=3
+
+    mkdir -p $WORKSPACE/primary
+    mkdir -p $WORKSPACE/replica
+    mkdir -p $WORKSPACE/out
+
+    for i in $(seq 1 $num_files); do
+        head -c 4194304 /dev/urandom > $WORKSPACE/primary/file$i
+    done
+    cp $WORKSPACE/primary/* $WORKSPACE/replica/
+
+    # The primary lists the replica in its Metalinks, then fails every read
+    start_test_server $WORKSPACE/primary 8080 \
+        --replica http://localhost:8081 --data-faults --error 100
+    start_test_server $WORKSPACE/replica 8081
+}
+
+test_main() {
+    export XRDCLHTTP_REPLICAS=1
+
+    for f in $(ls $WORKSPACE/primary/) ; do
+        echo "Downloading: http://localhost:8080/$f"
+        #XRD_LOGLEVEL=Debug \
+        xrdcp -f --silent http://localhost:8080/$f $WORKSPACE/out/$f
+        compare_files $WORKSPACE/primary/$f $WORKSPACE/out/$f
+
+        grep -q "^GET /$f 206 " $WORKSPACE/server-8081.log ||
+            die "Error: $f was not read from the replica"
+    done
+}
+
+test_finalize() {
+    stop_test_servers
+}
@@ -18,12 +18,58 @@ start_caddy() {
 
     ulimit -n 8192
 
+    # The in-tree test server, when given, stands in for Caddy
+    if [ x"$TEST_SERVER_EXEC" != x"" ]; then
+        echo -n "Starting the test server... "
+        $TEST_SERVER_EXEC --root $www_root --port 8080 --pidfile $WORKSPACE/caddy_pid $TEST_SERVER_OPTIONS > $WORKSPACE/caddy.log 2>&1 &
+        sleep 1
+        echo "done."
+        return
+    fi
+
     echo -n "Starting Caddy... "
     $CADDY_EXEC -root $www_root -conf $caddyfile -log $WORKSPACE/caddy.log -pidfile $WORKSPACE/caddy_pid &
     sleep 1
     echo "done."
 }
 
+# The in-tree test server on port, with its own options: one per port, with
+# its access log in $WORKSPACE/server-<port>.log
+start_test_server() {
+    local www_root=$1
+    local port=$2
+    shift 2
+
+    echo -n "Starting the test server on port $port... "
+    $TEST_SERVER_EXEC --root $www_root --port $port \
+        --pidfile $WORKSPACE/server-$port.pid \
+        --log $WORKSPACE/server-$port.log "$@" \
+        > $WORKSPACE/server-$port.out 2>&1 &
+    sleep 1
+    echo "done."
+}
+
+stop_test_servers() {
+    for pidfile in $WORKSPACE/server-*.pid; do
+        [ -f $pidfile ] || continue
+        echo -n "Stopping the test server... "
+        kill $(cat $pidfile)
+        rm -f $pidfile
+        echo "done."
+    done
+}
+
+# Ends a test case that cannot run here as a success
+skip_test() {
+    echo "\nSkipping test case: $1\n"
+    exit 0
+}
+
+# Cases relying on features only the in-tree test server has
+require_test_server() {
+    [ x"$TEST_SERVER_EXEC" != x"" ] || skip_test "TEST_SERVER_EXEC is not set"
+}
+
 stop_caddy() {
     if [ -f $WORKSPACE/caddy_pid ]; then
         echo -n "Stopping Caddy... "
@@ -46,6 +92,17 @@ str_sha1() {
     echo $(echo $1 | sha1sum | cut -d' ' -f1)
 }
 
+compare_files() {
+    local expected=$1
+    local actual=$2
+    if [ x"$(file_sha1 $expected)" != x"$(file_sha1 $actual)" ]; then
+        echo "Error: incorrect transfer of file: $expected"
+        echo "  SHA1  (in): $(file_sha1 $expected)"
+        echo "  SHA1 (out): $(file_sha1 $actual)"
+        exit 1
+    fi
+}
+
 die() {
     echo $1
     exit 1
@@ -79,6 +136,7 @@ check_prefix() {
 clean_up() {
     if [ x"$WORKSPACE" != x"" ] && [ -d $WORKSPACE ]; then
         stop_caddy
+        stop_test_servers
         echo "Cleaning up: $WORKSPACE"
         rm -r $WORKSPACE
     fi
@@ -17,16 +17,17 @@ if [ x"$1" != x"" ]; then
 fi
 
 # Additional commands
-check_executable wget
+[ x"$TEST_SERVER_EXEC" != x"" ] || check_executable wget
 
 # Preconditions (XRootD and XrdClHttp in $XROOTD_PREFIX)
 check_prefix $XROOTD_PREFIX
 PATH=$XROOTD_PREFIX/bin:$PATH
 LD_LIBRARY_PATH=$XROOTD_PREFIX/lib:$LD_LIBRARY_PATH
 
-# Download the caddy HTTP server, if needed
+# Download the caddy HTTP server, if needed and the in-tree test server
+# (TEST_SERVER_EXEC) is not used instead
 CADDY_EXEC=/tmp/caddy
-if [ ! -f $CADDY_EXEC ] || [ x"$(file_sha1 $CADDY_EXEC)" != x"$CADDY_SHA1" ]; then
+if [ x"$TEST_SERVER_EXEC" = x"" ] && { [ ! -f $CADDY_EXEC ] || [ x"$(file_sha1 $CADDY_EXEC)" != x"$CADDY_SHA1" ]; }; then
     echo "Downloading: $CADDY_URL"
     wget -q -O $CADDY_EXEC $CADDY_URL
     chmod +x $CADDY_EXEC
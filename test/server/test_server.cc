@@ -0,0 +1,1663 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+// A stand-in for the servers the plug-in talks to, so that the integration
+// tests and the benchmarks run on one machine without network access. It
+// serves a directory over HTTP/1.1 with keep-alive:
+//
+//   GET, with single and multiple ranges, HEAD, PUT, PROPFIND, MKCOL,
+//   DELETE and MOVE
+//
+// With --s3 it serves the top-level directories as path-style buckets
+// instead, as Davix addresses them: requests must be signed with SigV4, in
+// the Authorization header or the query string, and multipart uploads and
+// ListObjectsV2 are supported.
+//
+// Faults are drawn from a generator seeded with --seed, so that runs can be
+// repeated:
+//
+//   --latency MS            delay before each answer
+//   --tail MS:PERCENT       additional delay for that share of the answers
+//   --bandwidth BYTES       rate of each connection, in bytes per second
+//   --reset PERCENT         answers cut midway by a connection reset
+//   --error PERCENT[:CODE]  answers replaced by an error, 503 by default
+//   --ignore-range          whole files sent to range requests
+//   --data-faults           resets and errors only for ranged GETs and PUTs,
+//                           leaving the metadata requests alone
+//
+// With --replica URL, repeatable, files are also described by a Metalink
+// listing this server and URL, found through a Link header on HEAD and GET,
+// as Davix looks replicas up. --log FILE writes one line per answer: method,
+// target, status, Range header and "reset" for answers cut.
+//
+// Usage: xrdclhttp-test-server --root DIR [--port N] [--pidfile FILE]
+//                              [--s3 ACCESS_KEY:SECRET_KEY] [--log FILE]
+//                              [--replica URL...] [faults...]
+//
+// With --port 0 a free port is picked; the one listened on is printed.
+
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct Options {
+  std::string root;
+  int port = 8080;
+  std::string pidfile;
+  bool s3 = false;
+  std::string access_key;
+  std::string secret_key;
+  unsigned latency_ms = 0;
+  unsigned tail_ms = 0;
+  double tail_percent = 0;
+  uint64_t bandwidth = 0;
+  double reset_percent = 0;
+  double error_percent = 0;
+  int error_code = 503;
+  bool ignore_range = false;
+  bool data_faults = false;
+  uint64_t seed = 42;
+  std::vector<std::string> replicas;
+  std::string log;
+};
+
+Options options;
+
+std::mutex log_mutex;
+FILE* log_file = nullptr;
+
+const char kUploadsDir[] = "/.xrdclhttp-uploads";
+
+//------------------------------------------------------------------------------
+// Faults
+//------------------------------------------------------------------------------
+
+std::mutex random_mutex;
+std::mt19937_64 random_generator;
+
+// True for percent out of 100 draws
+bool Draw(double percent) {
+  if (percent <= 0) return false;
+  std::lock_guard<std::mutex> lock(random_mutex);
+  return std::uniform_real_distribution<double>(0, 100)(random_generator) <
+         percent;
+}
+
+//------------------------------------------------------------------------------
+// SHA-256 and HMAC, for SigV4
+//------------------------------------------------------------------------------
+
+class Sha256 {
+ public:
+  Sha256() {
+    static const uint32_t kInit[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372,
+                                      0xa54ff53a, 0x510e527f, 0x9b05688c,
+                                      0x1f83d9ab, 0x5be0cd19};
+    std::copy(kInit, kInit + 8, state_);
+  }
+
+  void Update(const void* data, size_t size) {
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    length_ += size;
+    while (size > 0) {
+      const size_t n = std::min(size, sizeof(block_) - used_);
+      memcpy(block_ + used_, bytes, n);
+      used_ += n;
+      bytes += n;
+      size -= n;
+      if (used_ == sizeof(block_)) {
+        Transform();
+        used_ = 0;
+      }
+    }
+  }
+
+  void Update(const std::string& data) { Update(data.data(), data.size()); }
+
+  std::string Digest() {
+    const uint64_t bits = length_ * 8;
+    const unsigned char pad = 0x80;
+    Update(&pad, 1);
+    const unsigned char zero = 0;
+    while (used_ != 56) Update(&zero, 1);
+    unsigned char size[8];
+    for (int i = 0; i < 8; ++i) size[i] = bits >> (56 - 8 * i);
+    Update(size, 8);
+
+    std::string digest(32, '\0');
+    for (int i = 0; i < 32; ++i)
+      digest[i] = state_[i / 4] >> (24 - 8 * (i % 4));
+    return digest;
+  }
+
+ private:
+  static uint32_t Rotate(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+  }
+
+  void Transform() {
+    static const uint32_t kRounds[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+        0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+        0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+        0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+        0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+        0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+        0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+        0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+        0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+    uint32_t w[64];
+    for (int i = 0; i < 16; ++i) {
+      w[i] = uint32_t(block_[4 * i]) << 24 |
+             uint32_t(block_[4 * i + 1]) << 16 |
+             uint32_t(block_[4 * i + 2]) << 8 | block_[4 * i + 3];
+    }
+    for (int i = 16; i < 64; ++i) {
+      const uint32_t s0 =
+          Rotate(w[i - 15], 7) ^ Rotate(w[i - 15], 18) ^ (w[i - 15] >> 3);
+      const uint32_t s1 =
+          Rotate(w[i - 2], 17) ^ Rotate(w[i - 2], 19) ^ (w[i - 2] >> 10);
+      w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state_[0], b = state_[1], c = state_[2], d = state_[3],
+             e = state_[4], f = state_[5], g = state_[6], h = state_[7];
+    for (int i = 0; i < 64; ++i) {
+      const uint32_t s1 = Rotate(e, 6) ^ Rotate(e, 11) ^ Rotate(e, 25);
+      const uint32_t t1 = h + s1 + ((e & f) ^ (~e & g)) + kRounds[i] + w[i];
+      const uint32_t s0 = Rotate(a, 2) ^ Rotate(a, 13) ^ Rotate(a, 22);
+      const uint32_t t2 = s0 + ((a & b) ^ (a & c) ^ (b & c));
+      h = g;
+      g = f;
+      f = e;
+      e = d + t1;
+      d = c;
+      c = b;
+      b = a;
+      a = t1 + t2;
+    }
+    state_[0] += a;
+    state_[1] += b;
+    state_[2] += c;
+    state_[3] += d;
+    state_[4] += e;
+    state_[5] += f;
+    state_[6] += g;
+    state_[7] += h;
+  }
+
+  uint32_t state_[8];
+  unsigned char block_[64];
+  size_t used_ = 0;
+  uint64_t length_ = 0;
+};
+
+std::string Hex(const std::string& bytes) {
+  static const char kDigits[] = "0123456789abcdef";
+  std::string hex;
+  for (unsigned char byte : bytes) {
+    hex += kDigits[byte >> 4];
+    hex += kDigits[byte & 15];
+  }
+  return hex;
+}
+
+std::string Unhex(const std::string& hex) {
+  std::string bytes;
+  for (size_t i = 0; i + 1 < hex.size(); i += 2)
+    bytes += char(strtol(hex.substr(i, 2).c_str(), nullptr, 16));
+  return bytes;
+}
+
+std::string HashHex(const std::string& data) {
+  Sha256 hash;
+  hash.Update(data);
+  return Hex(hash.Digest());
+}
+
+std::string Hmac(const std::string& key, const std::string& message) {
+  std::string block = key;
+  if (key.size() > 64) {
+    Sha256 hash;
+    hash.Update(key);
+    block = hash.Digest();
+  }
+  block.resize(64, '\0');
+
+  std::string inner_pad(64, '\0'), outer_pad(64, '\0');
+  for (int i = 0; i < 64; ++i) {
+    inner_pad[i] = block[i] ^ 0x36;
+    outer_pad[i] = block[i] ^ 0x5c;
+  }
+  Sha256 inner;
+  inner.Update(inner_pad);
+  inner.Update(message);
+  Sha256 outer;
+  outer.Update(outer_pad);
+  outer.Update(inner.Digest());
+  return outer.Digest();
+}
+
+//------------------------------------------------------------------------------
+// Text helpers
+//------------------------------------------------------------------------------
+
+std::string Lower(std::string text) {
+  for (auto& c : text) c = tolower(c);
+  return text;
+}
+
+std::string Trim(const std::string& text) {
+  const auto first = text.find_first_not_of(" \t");
+  if (first == std::string::npos) return "";
+  return text.substr(first, text.find_last_not_of(" \t") - first + 1);
+}
+
+std::string Decode(const std::string& text, bool plus_is_space) {
+  std::string decoded;
+  for (size_t i = 0; i < text.size(); ++i) {
+    if (text[i] == '%' && i + 2 < text.size() && isxdigit(text[i + 1]) &&
+        isxdigit(text[i + 2])) {
+      decoded += char(strtol(text.substr(i + 1, 2).c_str(), nullptr, 16));
+      i += 2;
+    }
+    else if (text[i] == '+' && plus_is_space) {
+      decoded += ' ';
+    }
+    else {
+      decoded += text[i];
+    }
+  }
+  return decoded;
+}
+
+// UriEncode of the SigV4 specification, also good for hrefs
+std::string Encode(const std::string& text, bool keep_slash) {
+  std::string encoded;
+  char escaped[4];
+  for (unsigned char c : text) {
+    if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~' ||
+        (c == '/' && keep_slash)) {
+      encoded += c;
+    }
+    else {
+      snprintf(escaped, sizeof(escaped), "%%%02X", c);
+      encoded += escaped;
+    }
+  }
+  return encoded;
+}
+
+std::string XmlEscape(const std::string& text) {
+  std::string escaped;
+  for (char c : text) {
+    switch (c) {
+      case '&': escaped += "&amp;"; break;
+      case '<': escaped += "&lt;"; break;
+      case '>': escaped += "&gt;"; break;
+      case '"': escaped += "&quot;"; break;
+      default: escaped += c;
+    }
+  }
+  return escaped;
+}
+
+std::string HttpDate(time_t when) {
+  char date[64];
+  struct tm tm;
+  strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT",
+           gmtime_r(&when, &tm));
+  return date;
+}
+
+std::string IsoDate(time_t when) {
+  char date[64];
+  struct tm tm;
+  strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S.000Z", gmtime_r(&when, &tm));
+  return date;
+}
+
+bool ParseHttpDate(const std::string& value, time_t* when) {
+  struct tm tm;
+  memset(&tm, 0, sizeof(tm));
+  const char* end = strptime(value.c_str(), "%a, %d %b %Y %H:%M:%S", &tm);
+  if (!end) return false;
+  *when = timegm(&tm);
+  return true;
+}
+
+// "20230101T120000Z"
+bool ParseAmzDate(const std::string& value, time_t* when) {
+  struct tm tm;
+  memset(&tm, 0, sizeof(tm));
+  const char* end = strptime(value.c_str(), "%Y%m%dT%H%M%SZ", &tm);
+  if (!end || *end) return false;
+  *when = timegm(&tm);
+  return true;
+}
+
+// The text between <tag> and </tag> from position on, advancing it
+bool NextElement(const std::string& xml, const std::string& tag,
+                 size_t* position, std::string* value) {
+  const auto start = xml.find("<" + tag + ">", *position);
+  if (start == std::string::npos) return false;
+  const auto first = start + tag.size() + 2;
+  const auto end = xml.find("</" + tag + ">", first);
+  if (end == std::string::npos) return false;
+  *value = xml.substr(first, end - first);
+  *position = end + tag.size() + 3;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Connections
+//------------------------------------------------------------------------------
+
+class Connection {
+ public:
+  explicit Connection(int fd) : fd_(fd) {}
+  ~Connection() { close(fd_); }
+
+  bool ReadLine(std::string* line) {
+    while (true) {
+      const auto end = buffer_.find("\r\n", position_);
+      if (end != std::string::npos) {
+        *line = buffer_.substr(position_, end - position_);
+        position_ = end + 2;
+        return true;
+      }
+      if (buffer_.size() - position_ > 64 * 1024 || !Fill()) return false;
+    }
+  }
+
+  int64_t Read(char* buffer, uint64_t size) {
+    if (position_ == buffer_.size() && !Fill()) return 0;
+    const size_t n = std::min<uint64_t>(size, buffer_.size() - position_);
+    memcpy(buffer, buffer_.data() + position_, n);
+    position_ += n;
+    return n;
+  }
+
+  // Paced to --bandwidth from the last StartAnswer()
+  bool Write(const char* data, size_t size) {
+    while (size > 0) {
+      const size_t block = options.bandwidth ? std::min<size_t>(size, 16384)
+                                             : size;
+      const ssize_t n = send(fd_, data, block, MSG_NOSIGNAL);
+      if (n <= 0) return false;
+      data += n;
+      size -= n;
+      sent_ += n;
+      if (options.bandwidth) {
+        std::this_thread::sleep_until(
+            answer_start_ + std::chrono::microseconds(sent_ * 1000000 /
+                                                      options.bandwidth));
+      }
+    }
+    return true;
+  }
+
+  bool Write(const std::string& data) {
+    return Write(data.data(), data.size());
+  }
+
+  void StartAnswer() {
+    answer_start_ = std::chrono::steady_clock::now();
+    sent_ = 0;
+  }
+
+  // Closing with a zero linger time sends a reset instead of a FIN
+  void Reset() {
+    struct linger linger = {1, 0};
+    setsockopt(fd_, SOL_SOCKET, SO_LINGER, &linger, sizeof(linger));
+  }
+
+ private:
+  bool Fill() {
+    buffer_.erase(0, position_);
+    position_ = 0;
+    char chunk[65536];
+    const ssize_t n = recv(fd_, chunk, sizeof(chunk), 0);
+    if (n <= 0) return false;
+    buffer_.append(chunk, n);
+    return true;
+  }
+
+  const int fd_;
+  std::string buffer_;
+  size_t position_ = 0;
+  std::chrono::steady_clock::time_point answer_start_;
+  uint64_t sent_ = 0;
+};
+
+// The request body, with Content-Length or chunked
+class Body {
+ public:
+  Body(Connection& connection, bool chunked, uint64_t length)
+      : connection_(connection), chunked_(chunked), left_(length) {}
+
+  int64_t Read(char* buffer, uint64_t size) {
+    if (chunked_ && left_ == 0 && !done_) {
+      if (started_) {
+        std::string crlf;
+        if (!connection_.ReadLine(&crlf)) return -1;
+      }
+      started_ = true;
+      std::string line;
+      if (!connection_.ReadLine(&line)) return -1;
+      left_ = strtoull(line.c_str(), nullptr, 16);
+      if (left_ == 0) {
+        // Trailers, up to the empty line
+        while (connection_.ReadLine(&line) && !line.empty()) {
+        }
+        done_ = true;
+      }
+    }
+    if (left_ == 0) return 0;
+    const int64_t n = connection_.Read(buffer, std::min(size, left_));
+    if (n <= 0) return -1;
+    left_ -= n;
+    return n;
+  }
+
+  bool ReadAll(std::string* data) {
+    char chunk[65536];
+    int64_t n;
+    while ((n = Read(chunk, sizeof(chunk))) > 0) data->append(chunk, n);
+    return n == 0;
+  }
+
+  bool Discard() {
+    char chunk[65536];
+    int64_t n;
+    while ((n = Read(chunk, sizeof(chunk))) > 0) {
+    }
+    return n == 0;
+  }
+
+ private:
+  Connection& connection_;
+  const bool chunked_;
+  uint64_t left_;
+  bool started_ = false;
+  bool done_ = false;
+};
+
+struct Request {
+  std::string method;
+  std::string raw_path;
+  std::string raw_query;
+  std::string path;
+  std::vector<std::pair<std::string, std::string>> query;
+  std::map<std::string, std::string> headers;
+  bool keep_alive = true;
+  Body* body = nullptr;
+
+  std::string Header(const std::string& name) const {
+    auto it = headers.find(name);
+    return it == headers.end() ? std::string() : it->second;
+  }
+
+  bool HasQuery(const std::string& name) const {
+    for (const auto& param : query)
+      if (param.first == name) return true;
+    return false;
+  }
+
+  std::string Query(const std::string& name) const {
+    for (const auto& param : query)
+      if (param.first == name) return param.second;
+    return "";
+  }
+};
+
+struct File {
+  explicit File(int fd) : fd(fd) {}
+  ~File() { close(fd); }
+  const int fd;
+};
+
+// A part of an answer body: text, or a range of a file
+struct Segment {
+  std::string text;
+  std::shared_ptr<File> file;
+  uint64_t offset = 0;
+  uint64_t length = 0;
+
+  uint64_t Size() const { return file ? length : text.size(); }
+};
+
+struct Response {
+  int status = 200;
+  std::vector<std::pair<std::string, std::string>> headers;
+  std::vector<Segment> body;
+
+  void Header(const std::string& name, const std::string& value) {
+    headers.emplace_back(name, value);
+  }
+
+  void Text(const std::string& type, const std::string& text) {
+    Header("Content-Type", type);
+    Segment segment;
+    segment.text = text;
+    body.push_back(segment);
+  }
+
+  void Range(const std::shared_ptr<File>& file, uint64_t offset,
+             uint64_t length) {
+    Segment segment;
+    segment.file = file;
+    segment.offset = offset;
+    segment.length = length;
+    body.push_back(segment);
+  }
+
+  uint64_t Size() const {
+    uint64_t size = 0;
+    for (const auto& segment : body) size += segment.Size();
+    return size;
+  }
+};
+
+const char* Reason(int status) {
+  switch (status) {
+    case 100: return "Continue";
+    case 200: return "OK";
+    case 201: return "Created";
+    case 204: return "No Content";
+    case 206: return "Partial Content";
+    case 207: return "Multi-Status";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 409: return "Conflict";
+    case 412: return "Precondition Failed";
+    case 416: return "Range Not Satisfiable";
+    case 500: return "Internal Server Error";
+    case 501: return "Not Implemented";
+    case 502: return "Bad Gateway";
+    case 503: return "Service Unavailable";
+    case 504: return "Gateway Timeout";
+    default: return "Unknown";
+  }
+}
+
+Response Status(int status) {
+  Response response;
+  response.status = status;
+  return response;
+}
+
+Response S3Error(int status, const std::string& code,
+                 const std::string& message) {
+  Response response = Status(status);
+  response.Text("application/xml",
+                "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<Error><Code>" +
+                    code + "</Code><Message>" + XmlEscape(message) +
+                    "</Message></Error>\n");
+  return response;
+}
+
+//------------------------------------------------------------------------------
+// Files
+//------------------------------------------------------------------------------
+
+std::string LocalPath(const std::string& path) { return options.root + path; }
+
+bool IsDir(const std::string& local) {
+  struct stat info;
+  return stat(local.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+std::string Parent(const std::string& path) {
+  auto slash = path.find_last_of('/', path.size() > 1 ? path.size() - 2 : 0);
+  return slash == std::string::npos || slash == 0 ? "/"
+                                                  : path.substr(0, slash);
+}
+
+bool MakeDirs(const std::string& local) {
+  for (size_t slash = options.root.size() + 1;
+       (slash = local.find('/', slash)) != std::string::npos; ++slash) {
+    mkdir(local.substr(0, slash).c_str(), 0755);
+  }
+  return mkdir(local.c_str(), 0755) == 0 || errno == EEXIST;
+}
+
+bool RemoveAll(const std::string& local) {
+  if (!IsDir(local)) return unlink(local.c_str()) == 0;
+  if (DIR* dir = opendir(local.c_str())) {
+    while (auto entry = readdir(dir)) {
+      const std::string name = entry->d_name;
+      if (name != "." && name != "..") RemoveAll(local + "/" + name);
+    }
+    closedir(dir);
+  }
+  return rmdir(local.c_str()) == 0;
+}
+
+// The body, streamed to a temporary file next to local and renamed over it
+bool Receive(Body& body, const std::string& local, std::string* digest) {
+  const std::string temporary = local + ".xrdclhttp-part";
+  const int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    body.Discard();
+    return false;
+  }
+  Sha256 hash;
+  char chunk[65536];
+  int64_t n;
+  bool written = true;
+  while ((n = body.Read(chunk, sizeof(chunk))) > 0) {
+    hash.Update(chunk, n);
+    written = written && write(fd, chunk, n) == n;
+  }
+  written = close(fd) == 0 && written && n == 0;
+  if (!written || rename(temporary.c_str(), local.c_str())) {
+    unlink(temporary.c_str());
+    return false;
+  }
+  if (digest) *digest = Hex(hash.Digest());
+  return true;
+}
+
+// "bytes=0-99,200-,-50" against size, false if malformed
+bool ParseRanges(const std::string& header, uint64_t size,
+                 std::vector<std::pair<uint64_t, uint64_t>>* ranges) {
+  if (header.compare(0, 6, "bytes=")) return false;
+  size_t position = 6;
+  while (position < header.size()) {
+    auto end = header.find(',', position);
+    if (end == std::string::npos) end = header.size();
+    const std::string spec = Trim(header.substr(position, end - position));
+    position = end + 1;
+
+    const auto dash = spec.find('-');
+    if (dash == std::string::npos) return false;
+    uint64_t first, last;
+    if (dash == 0) {
+      const uint64_t suffix = strtoull(spec.c_str() + 1, nullptr, 10);
+      if (suffix == 0) continue;
+      first = suffix >= size ? 0 : size - suffix;
+      last = size - 1;
+    }
+    else {
+      first = strtoull(spec.c_str(), nullptr, 10);
+      last = dash + 1 < spec.size()
+                 ? strtoull(spec.c_str() + dash + 1, nullptr, 10)
+                 : size - 1;
+      if (last < first) return false;
+      last = std::min(last, size - 1);
+    }
+    if (first < size) ranges->emplace_back(first, last - first + 1);
+  }
+  return true;
+}
+
+// Metalink 4 document of a file held by this server and the replicas
+Response Metalink(const Request& request, uint64_t size) {
+  const auto slash = request.path.rfind('/');
+  std::string text =
+      "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+      "<metalink xmlns=\"urn:ietf:params:xml:ns:metalink\">\n"
+      "<file name=\"" + XmlEscape(request.path.substr(slash + 1)) + "\">\n"
+      "<size>" + std::to_string(size) + "</size>\n"
+      "<url priority=\"1\">" +
+      XmlEscape("http://" + request.Header("host") + request.raw_path) +
+      "</url>\n";
+  for (size_t i = 0; i < options.replicas.size(); ++i) {
+    text += "<url priority=\"" + std::to_string(i + 2) + "\">" +
+            XmlEscape(options.replicas[i] + request.raw_path) + "</url>\n";
+  }
+  text += "</file>\n</metalink>\n";
+
+  Response response;
+  response.Text("application/metalink4+xml", text);
+  return response;
+}
+
+// Bodies are left out of the answers to HEAD when sending
+Response Get(const Request& request) {
+  const std::string local = LocalPath(request.path);
+  struct stat info;
+  if (stat(local.c_str(), &info)) {
+    return options.s3 ? S3Error(404, "NoSuchKey", "No such key")
+                       : Status(404);
+  }
+  if (S_ISDIR(info.st_mode)) return Status(405);
+  if (!options.replicas.empty() && request.HasQuery("metalink")) {
+    return Metalink(request, info.st_size);
+  }
+
+  time_t since;
+  if (ParseHttpDate(request.Header("if-modified-since"), &since) &&
+      info.st_mtime <= since) {
+    return Status(304);
+  }
+
+  const int fd = open(local.c_str(), O_RDONLY);
+  if (fd < 0) return Status(403);
+  auto file = std::make_shared<File>(fd);
+  const uint64_t size = info.st_size;
+
+  Response response;
+  response.Header("Last-Modified", HttpDate(info.st_mtime));
+  response.Header("ETag", "\"" + std::to_string(info.st_ino) + "-" +
+                              std::to_string(info.st_mtime) + "\"");
+  response.Header("Accept-Ranges", options.ignore_range ? "none" : "bytes");
+  if (!options.replicas.empty()) {
+    response.Header("Link", "<http://" + request.Header("host") +
+                                request.raw_path +
+                                "?metalink>; rel=describedby; "
+                                "type=\"application/metalink4+xml\"");
+  }
+
+  std::vector<std::pair<uint64_t, uint64_t>> ranges;
+  const std::string range = request.Header("range");
+  if (range.empty() || options.ignore_range ||
+      !ParseRanges(range, size, &ranges)) {
+    response.Header("Content-Type", "application/octet-stream");
+    response.Range(file, 0, size);
+    return response;
+  }
+
+  if (ranges.empty()) {
+    response.status = 416;
+    response.Header("Content-Range", "bytes */" + std::to_string(size));
+    return response;
+  }
+
+  response.status = 206;
+  if (ranges.size() == 1) {
+    response.Header("Content-Type", "application/octet-stream");
+    response.Header("Content-Range",
+                    "bytes " + std::to_string(ranges[0].first) + "-" +
+                        std::to_string(ranges[0].first + ranges[0].second - 1) +
+                        "/" + std::to_string(size));
+    response.Range(file, ranges[0].first, ranges[0].second);
+    return response;
+  }
+
+  const std::string boundary = "XRDCLHTTP_TEST_SERVER_BOUNDARY";
+  response.Header("Content-Type",
+                  "multipart/byteranges; boundary=" + boundary);
+  for (const auto& part : ranges) {
+    Segment header;
+    header.text = "\r\n--" + boundary +
+                  "\r\nContent-Type: application/octet-stream\r\n"
+                  "Content-Range: bytes " + std::to_string(part.first) + "-" +
+                  std::to_string(part.first + part.second - 1) + "/" +
+                  std::to_string(size) + "\r\n\r\n";
+    response.body.push_back(header);
+    response.Range(file, part.first, part.second);
+  }
+  Segment end;
+  end.text = "\r\n--" + boundary + "--\r\n";
+  response.body.push_back(end);
+  return response;
+}
+
+//------------------------------------------------------------------------------
+// WebDAV
+//------------------------------------------------------------------------------
+
+std::string PropfindEntry(const std::string& path, const struct stat& info) {
+  const bool dir = S_ISDIR(info.st_mode);
+  std::string href = Encode(path, true);
+  if (dir && href.back() != '/') href += '/';
+  const auto slash = path.find_last_of('/', path.size() - 2);
+  std::string name = path.substr(slash + 1);
+  if (!name.empty() && name.back() == '/') name.pop_back();
+
+  std::string entry = "<D:response><D:href>" + XmlEscape(href) +
+                      "</D:href><D:propstat><D:prop>"
+                      "<D:displayname>" + XmlEscape(name) +
+                      "</D:displayname><D:getlastmodified>" +
+                      HttpDate(info.st_mtime) +
+                      "</D:getlastmodified><D:creationdate>" +
+                      IsoDate(info.st_ctime) + "</D:creationdate>";
+  if (dir) {
+    entry += "<D:resourcetype><D:collection/></D:resourcetype>";
+  }
+  else {
+    entry += "<D:resourcetype/><D:getcontentlength>" +
+             std::to_string(info.st_size) + "</D:getcontentlength>";
+  }
+  return entry +
+         "</D:prop><D:status>HTTP/1.1 200 OK</D:status></D:propstat>"
+         "</D:response>\n";
+}
+
+Response Propfind(const Request& request) {
+  request.body->Discard();
+  const std::string local = LocalPath(request.path);
+  struct stat info;
+  if (stat(local.c_str(), &info)) return Status(404);
+
+  std::string xml =
+      "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+      "<D:multistatus xmlns:D=\"DAV:\">\n" +
+      PropfindEntry(request.path, info);
+  if (S_ISDIR(info.st_mode) && request.Header("depth") != "0") {
+    std::vector<std::string> names;
+    if (DIR* dir = opendir(local.c_str())) {
+      while (auto entry = readdir(dir)) {
+        const std::string name = entry->d_name;
+        if (name != "." && name != "..") names.push_back(name);
+      }
+      closedir(dir);
+    }
+    std::sort(names.begin(), names.end());
+    std::string base = request.path;
+    if (base.back() != '/') base += '/';
+    struct stat child;
+    for (const auto& name : names) {
+      if (stat((local + "/" + name).c_str(), &child) == 0)
+        xml += PropfindEntry(base + name, child);
+    }
+  }
+  xml += "</D:multistatus>\n";
+
+  Response response = Status(207);
+  response.Text("application/xml; charset=utf-8", xml);
+  return response;
+}
+
+Response Put(const Request& request) {
+  const std::string local = LocalPath(request.path);
+  if (!IsDir(LocalPath(Parent(request.path)))) {
+    request.body->Discard();
+    return Status(409);
+  }
+  if (IsDir(local)) {
+    request.body->Discard();
+    return Status(405);
+  }
+  const bool existed = access(local.c_str(), F_OK) == 0;
+  if (!Receive(*request.body, local, nullptr)) return Status(500);
+  return Status(existed ? 204 : 201);
+}
+
+Response MkCol(const Request& request) {
+  request.body->Discard();
+  const std::string local = LocalPath(request.path);
+  if (access(local.c_str(), F_OK) == 0) return Status(405);
+  if (!IsDir(LocalPath(Parent(request.path)))) return Status(409);
+  return Status(mkdir(local.c_str(), 0755) ? 500 : 201);
+}
+
+Response Delete(const Request& request) {
+  request.body->Discard();
+  const std::string local = LocalPath(request.path);
+  if (access(local.c_str(), F_OK)) return Status(404);
+  return Status(RemoveAll(local) ? 204 : 500);
+}
+
+Response Move(const Request& request) {
+  request.body->Discard();
+  // An absolute URL or a path
+  std::string destination = request.Header("destination");
+  const auto scheme = destination.find("://");
+  if (scheme != std::string::npos) {
+    const auto slash = destination.find('/', scheme + 3);
+    destination = slash == std::string::npos ? "/" : destination.substr(slash);
+  }
+  destination = Decode(destination.substr(0, destination.find('?')), false);
+  if (destination.empty() || destination[0] != '/' ||
+      destination.find("/../") != std::string::npos) {
+    return Status(400);
+  }
+
+  const std::string source = LocalPath(request.path);
+  const std::string target = LocalPath(destination);
+  if (access(source.c_str(), F_OK)) return Status(404);
+  if (!IsDir(LocalPath(Parent(destination)))) return Status(409);
+  const bool existed = access(target.c_str(), F_OK) == 0;
+  if (existed && request.Header("overwrite") == "F") return Status(412);
+  if (existed && IsDir(target)) RemoveAll(target);
+  return Status(rename(source.c_str(), target.c_str()) ? 500
+                                                      : existed ? 204 : 201);
+}
+
+//------------------------------------------------------------------------------
+// S3
+//------------------------------------------------------------------------------
+
+// Checks the SigV4 signature, in the Authorization header or in the query
+// string of a presigned URL. Fills payload_hash with the hash the client
+// announced, empty if the payload is unsigned.
+bool Authorized(const Request& request, Response* error,
+                std::string* payload_hash) {
+  std::string credential, signed_headers, signature, amz_date;
+  bool presigned = false;
+
+  const std::string authorization = request.Header("authorization");
+  if (authorization.compare(0, 17, "AWS4-HMAC-SHA256 ") == 0) {
+    for (size_t position = 17; position < authorization.size();) {
+      auto end = authorization.find(',', position);
+      if (end == std::string::npos) end = authorization.size();
+      const std::string field =
+          Trim(authorization.substr(position, end - position));
+      position = end + 1;
+      const auto equal = field.find('=');
+      if (equal == std::string::npos) continue;
+      const std::string name = field.substr(0, equal);
+      const std::string value = field.substr(equal + 1);
+      if (name == "Credential") credential = value;
+      else if (name == "SignedHeaders") signed_headers = value;
+      else if (name == "Signature") signature = value;
+    }
+    amz_date = request.Header("x-amz-date");
+    *payload_hash = request.Header("x-amz-content-sha256");
+    if (payload_hash->empty()) {
+      *error = S3Error(400, "InvalidRequest",
+                       "Missing x-amz-content-sha256");
+      return false;
+    }
+  }
+  else if (request.Query("X-Amz-Algorithm") == "AWS4-HMAC-SHA256") {
+    presigned = true;
+    credential = request.Query("X-Amz-Credential");
+    signed_headers = request.Query("X-Amz-SignedHeaders");
+    signature = request.Query("X-Amz-Signature");
+    amz_date = request.Query("X-Amz-Date");
+    *payload_hash = "UNSIGNED-PAYLOAD";
+  }
+  else {
+    *error = S3Error(403, "AccessDenied", "Requests must be signed with SigV4");
+    return false;
+  }
+
+  // AKID/20230101/region/s3/aws4_request
+  const auto slash = credential.find('/');
+  if (slash == std::string::npos ||
+      credential.substr(0, slash) != options.access_key) {
+    *error = S3Error(403, "InvalidAccessKeyId", "Unknown access key");
+    return false;
+  }
+  const std::string scope = credential.substr(slash + 1);
+  std::vector<std::string> parts;
+  for (size_t position = 0;;) {
+    const auto end = scope.find('/', position);
+    parts.push_back(scope.substr(position, end - position));
+    if (end == std::string::npos) break;
+    position = end + 1;
+  }
+  time_t when;
+  if (parts.size() != 4 || !ParseAmzDate(amz_date, &when)) {
+    *error = S3Error(400, "AuthorizationQueryParametersError",
+                     "Malformed credential scope or date");
+    return false;
+  }
+  if (presigned) {
+    const long expires = strtol(request.Query("X-Amz-Expires").c_str(),
+                                nullptr, 10);
+    if (time(nullptr) > when + expires + 900) {
+      *error = S3Error(403, "AccessDenied", "Request has expired");
+      return false;
+    }
+  }
+
+  std::vector<std::pair<std::string, std::string>> query;
+  for (const auto& param : request.query) {
+    if (presigned && param.first == "X-Amz-Signature") continue;
+    query.emplace_back(Encode(param.first, false), Encode(param.second, false));
+  }
+  std::sort(query.begin(), query.end());
+  std::string canonical_query;
+  for (const auto& param : query) {
+    if (!canonical_query.empty()) canonical_query += '&';
+    canonical_query += param.first + "=" + param.second;
+  }
+
+  std::string canonical_headers;
+  for (size_t position = 0; position <= signed_headers.size();) {
+    auto end = signed_headers.find(';', position);
+    if (end == std::string::npos) end = signed_headers.size();
+    const std::string name = signed_headers.substr(position, end - position);
+    canonical_headers += name + ":" + Trim(request.Header(name)) + "\n";
+    position = end + 1;
+  }
+
+  const std::string canonical_request =
+      request.method + "\n" + request.raw_path + "\n" + canonical_query +
+      "\n" + canonical_headers + "\n" + signed_headers + "\n" + *payload_hash;
+  const std::string string_to_sign = "AWS4-HMAC-SHA256\n" + amz_date + "\n" +
+                                     scope + "\n" +
+                                     HashHex(canonical_request);
+  std::string key = "AWS4" + options.secret_key;
+  for (size_t i = 0; i < 4; ++i) key = Hmac(key, parts[i]);
+  if (Hex(Hmac(key, string_to_sign)) != signature) {
+    *error = S3Error(403, "SignatureDoesNotMatch",
+                     "The request signature does not match");
+    return false;
+  }
+  if (*payload_hash == "UNSIGNED-PAYLOAD") payload_hash->clear();
+  return true;
+}
+
+// "/bucket/some/key" into "bucket" and "some/key"
+void SplitBucket(const std::string& path, std::string* bucket,
+                 std::string* key) {
+  const auto slash = path.find('/', 1);
+  *bucket = path.substr(1, slash == std::string::npos ? std::string::npos
+                                                      : slash - 1);
+  *key = slash == std::string::npos ? "" : path.substr(slash + 1);
+}
+
+void CollectKeys(const std::string& local, const std::string& prefix,
+                 std::vector<std::string>* keys) {
+  DIR* dir = opendir(local.c_str());
+  if (!dir) return;
+  while (auto entry = readdir(dir)) {
+    const std::string name = entry->d_name;
+    if (name == "." || name == "..") continue;
+    if (IsDir(local + "/" + name))
+      CollectKeys(local + "/" + name, prefix + name + "/", keys);
+    else
+      keys->push_back(prefix + name);
+  }
+  closedir(dir);
+}
+
+Response ListObjects(const Request& request, const std::string& bucket) {
+  const std::string local = LocalPath("/" + bucket);
+  if (!IsDir(local))
+    return S3Error(404, "NoSuchBucket", "No such bucket: " + bucket);
+
+  const std::string prefix = request.Query("prefix");
+  const std::string delimiter = request.Query("delimiter");
+  const std::string token = request.Query("continuation-token");
+  const std::string start_after =
+      token.empty() ? request.Query("start-after") : Unhex(token);
+  size_t max_keys = 1000;
+  if (request.HasQuery("max-keys"))
+    max_keys = strtoul(request.Query("max-keys").c_str(), nullptr, 10);
+
+  std::vector<std::string> keys;
+  CollectKeys(local, "", &keys);
+  std::sort(keys.begin(), keys.end());
+
+  std::string contents, prefixes, last;
+  size_t count = 0;
+  bool truncated = false;
+  for (const auto& key : keys) {
+    if (key.compare(0, prefix.size(), prefix) || key <= start_after) continue;
+
+    std::string common;
+    if (!delimiter.empty()) {
+      const auto end = key.find(delimiter, prefix.size());
+      if (end != std::string::npos)
+        common = key.substr(0, end + delimiter.size());
+    }
+    // Keys under a common prefix already returned are skipped
+    if (!common.empty() && common == last) continue;
+    if (count == max_keys) {
+      truncated = true;
+      break;
+    }
+    ++count;
+
+    if (!common.empty()) {
+      prefixes += "<CommonPrefixes><Prefix>" + XmlEscape(common) +
+                  "</Prefix></CommonPrefixes>";
+      last = common;
+      continue;
+    }
+    struct stat info;
+    stat((local + "/" + key).c_str(), &info);
+    contents += "<Contents><Key>" + XmlEscape(key) + "</Key><LastModified>" +
+                IsoDate(info.st_mtime) + "</LastModified><ETag>&quot;" +
+                std::to_string(info.st_ino) + "&quot;</ETag><Size>" +
+                std::to_string(info.st_size) +
+                "</Size><StorageClass>STANDARD</StorageClass></Contents>";
+    last = key;
+  }
+
+  // The token is the last key or prefix returned, in hex: listing resumes
+  // after it, past the keys of a common prefix too
+  std::string next;
+  if (truncated) {
+    next = last;
+    if (!delimiter.empty() && last.size() >= delimiter.size() &&
+        last.compare(last.size() - delimiter.size(), delimiter.size(),
+                     delimiter) == 0) {
+      next += "\xff";
+    }
+    next = Hex(next);
+  }
+
+  std::string xml =
+      "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+      "<ListBucketResult xmlns=\"http://s3.amazonaws.com/doc/2006-03-01/\">"
+      "<Name>" + XmlEscape(bucket) + "</Name><Prefix>" + XmlEscape(prefix) +
+      "</Prefix><KeyCount>" + std::to_string(count) + "</KeyCount><MaxKeys>" +
+      std::to_string(max_keys) + "</MaxKeys>";
+  if (!delimiter.empty())
+    xml += "<Delimiter>" + XmlEscape(delimiter) + "</Delimiter>";
+  xml += std::string("<IsTruncated>") + (truncated ? "true" : "false") +
+         "</IsTruncated>";
+  if (!token.empty())
+    xml += "<ContinuationToken>" + XmlEscape(token) + "</ContinuationToken>";
+  if (truncated)
+    xml += "<NextContinuationToken>" + XmlEscape(next) +
+           "</NextContinuationToken>";
+  xml += contents + prefixes + "</ListBucketResult>\n";
+
+  Response response;
+  response.Text("application/xml", xml);
+  return response;
+}
+
+std::string UploadDir(const std::string& upload_id) {
+  return options.root + kUploadsDir + "/" + upload_id;
+}
+
+bool ValidUploadId(const std::string& upload_id) {
+  return !upload_id.empty() &&
+         upload_id.find_first_not_of("0123456789abcdef") == std::string::npos &&
+         IsDir(UploadDir(upload_id));
+}
+
+Response InitiateUpload(const std::string& bucket, const std::string& key) {
+  static std::atomic<uint64_t> uploads(0);
+  char upload_id[40];
+  snprintf(upload_id, sizeof(upload_id), "%08x%016llx", unsigned(getpid()),
+           (unsigned long long)++uploads);
+  if (!MakeDirs(UploadDir(upload_id))) return Status(500);
+
+  Response response;
+  response.Text("application/xml",
+                "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                "<InitiateMultipartUploadResult><Bucket>" +
+                    XmlEscape(bucket) + "</Bucket><Key>" + XmlEscape(key) +
+                    "</Key><UploadId>" + upload_id +
+                    "</UploadId></InitiateMultipartUploadResult>\n");
+  return response;
+}
+
+Response UploadPart(const Request& request, std::string* digest) {
+  const std::string upload_id = request.Query("uploadId");
+  const long part = strtol(request.Query("partNumber").c_str(), nullptr, 10);
+  if (!ValidUploadId(upload_id)) {
+    request.body->Discard();
+    return S3Error(404, "NoSuchUpload", "No such upload");
+  }
+  if (part < 1 || part > 10000) {
+    request.body->Discard();
+    return S3Error(400, "InvalidArgument", "Part number out of range");
+  }
+  if (!Receive(*request.body,
+               UploadDir(upload_id) + "/" + std::to_string(part), digest)) {
+    return Status(500);
+  }
+  Response response;
+  response.Header("ETag", "\"" + digest->substr(0, 32) + "\"");
+  return response;
+}
+
+Response CompleteUpload(const Request& request, const std::string& bucket,
+                        const std::string& key) {
+  std::string xml;
+  if (!request.body->ReadAll(&xml)) return Status(400);
+  const std::string upload_id = request.Query("uploadId");
+  if (!ValidUploadId(upload_id))
+    return S3Error(404, "NoSuchUpload", "No such upload");
+
+  std::vector<std::string> parts;
+  std::string part;
+  for (size_t position = 0; NextElement(xml, "PartNumber", &position, &part);)
+    parts.push_back(UploadDir(upload_id) + "/" + Trim(part));
+  if (parts.empty())
+    return S3Error(400, "MalformedXML", "No parts to assemble");
+
+  const std::string local = LocalPath(request.path);
+  if (!MakeDirs(LocalPath(Parent(request.path)))) return Status(500);
+  const std::string temporary = local + ".xrdclhttp-part";
+  const int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) return Status(500);
+  bool written = true;
+  char chunk[65536];
+  for (const auto& path : parts) {
+    const int in = open(path.c_str(), O_RDONLY);
+    if (in < 0) {
+      close(fd);
+      unlink(temporary.c_str());
+      return S3Error(400, "InvalidPart", "Part not uploaded");
+    }
+    ssize_t n;
+    while ((n = read(in, chunk, sizeof(chunk))) > 0)
+      written = written && write(fd, chunk, n) == n;
+    close(in);
+  }
+  written = close(fd) == 0 && written;
+  if (!written || rename(temporary.c_str(), local.c_str())) {
+    unlink(temporary.c_str());
+    return Status(500);
+  }
+  RemoveAll(UploadDir(upload_id));
+
+  Response response;
+  response.Text("application/xml",
+                "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                "<CompleteMultipartUploadResult><Location>" +
+                    XmlEscape(request.path) + "</Location><Bucket>" +
+                    XmlEscape(bucket) + "</Bucket><Key>" + XmlEscape(key) +
+                    "</Key><ETag>&quot;" + upload_id + "-" +
+                    std::to_string(parts.size()) +
+                    "&quot;</ETag></CompleteMultipartUploadResult>\n");
+  return response;
+}
+
+Response HandleS3(const Request& request) {
+  Response error;
+  std::string payload_hash;
+  if (!Authorized(request, &error, &payload_hash)) {
+    request.body->Discard();
+    return error;
+  }
+
+  std::string bucket, key;
+  SplitBucket(request.path, &bucket, &key);
+  if (bucket.empty() || bucket[0] == '.') {
+    request.body->Discard();
+    return S3Error(400, "InvalidBucketName", "No bucket in the path");
+  }
+
+  std::string digest;
+  Response response;
+  if (key.empty()) {
+    request.body->Discard();
+    if (request.method == "GET") return ListObjects(request, bucket);
+    if (request.method == "HEAD")
+      return IsDir(LocalPath("/" + bucket)) ? Status(200) : Status(404);
+    return Status(405);
+  }
+  else if (request.method == "GET" || request.method == "HEAD") {
+    request.body->Discard();
+    return Get(request);
+  }
+  else if (request.method == "PUT" && request.HasQuery("uploadId")) {
+    response = UploadPart(request, &digest);
+  }
+  else if (request.method == "PUT") {
+    const std::string local = LocalPath(request.path);
+    if (!MakeDirs(LocalPath(Parent(request.path))) ||
+        !Receive(*request.body, local, &digest)) {
+      return Status(500);
+    }
+    response.Header("ETag", "\"" + digest.substr(0, 32) + "\"");
+  }
+  else if (request.method == "POST" && request.HasQuery("uploads")) {
+    request.body->Discard();
+    return InitiateUpload(bucket, key);
+  }
+  else if (request.method == "POST" && request.HasQuery("uploadId")) {
+    return CompleteUpload(request, bucket, key);
+  }
+  else if (request.method == "DELETE" && request.HasQuery("uploadId")) {
+    request.body->Discard();
+    const std::string upload_id = request.Query("uploadId");
+    if (!ValidUploadId(upload_id))
+      return S3Error(404, "NoSuchUpload", "No such upload");
+    RemoveAll(UploadDir(upload_id));
+    return Status(204);
+  }
+  else if (request.method == "DELETE") {
+    request.body->Discard();
+    unlink(LocalPath(request.path).c_str());
+    return Status(204);
+  }
+  else {
+    request.body->Discard();
+    return Status(405);
+  }
+
+  // The data is kept, as S3 would not, but the client learns it was damaged
+  if (response.status == 200 && !payload_hash.empty() &&
+      payload_hash != digest) {
+    return S3Error(400, "XAmzContentSHA256Mismatch",
+                   "The payload does not match x-amz-content-sha256");
+  }
+  return response;
+}
+
+Response Handle(const Request& request) {
+  if (options.s3) return HandleS3(request);
+  if (request.method == "GET" || request.method == "HEAD")
+    return Get(request);
+  if (request.method == "PUT") return Put(request);
+  if (request.method == "PROPFIND") return Propfind(request);
+  if (request.method == "MKCOL") return MkCol(request);
+  if (request.method == "DELETE") return Delete(request);
+  if (request.method == "MOVE") return Move(request);
+  if (request.method == "OPTIONS") {
+    request.body->Discard();
+    Response response;
+    response.Header("DAV", "1");
+    response.Header("Allow",
+                    "GET, HEAD, PUT, PROPFIND, MKCOL, DELETE, MOVE, OPTIONS");
+    return response;
+  }
+  request.body->Discard();
+  return Status(501);
+}
+
+//------------------------------------------------------------------------------
+// Serving
+//------------------------------------------------------------------------------
+
+bool ReadRequest(Connection& connection, Request* request) {
+  std::string line;
+  do {
+    if (!connection.ReadLine(&line)) return false;
+  } while (line.empty());
+
+  // "GET /path?query HTTP/1.1"
+  const auto first = line.find(' ');
+  const auto last = line.rfind(' ');
+  if (first == std::string::npos || last == first) return false;
+  request->method = line.substr(0, first);
+  const std::string target = line.substr(first + 1, last - first - 1);
+  const std::string version = line.substr(last + 1);
+
+  const auto mark = target.find('?');
+  request->raw_path = target.substr(0, mark);
+  request->raw_query =
+      mark == std::string::npos ? "" : target.substr(mark + 1);
+  request->path = Decode(request->raw_path, false);
+  request->query.clear();
+  for (size_t position = 0; position < request->raw_query.size();) {
+    auto end = request->raw_query.find('&', position);
+    if (end == std::string::npos) end = request->raw_query.size();
+    const std::string param =
+        request->raw_query.substr(position, end - position);
+    const auto equal = param.find('=');
+    request->query.emplace_back(
+        Decode(param.substr(0, equal), true),
+        equal == std::string::npos ? ""
+                                   : Decode(param.substr(equal + 1), true));
+    position = end + 1;
+  }
+
+  request->headers.clear();
+  while (connection.ReadLine(&line) && !line.empty()) {
+    const auto colon = line.find(':');
+    if (colon == std::string::npos) continue;
+    auto& value = request->headers[Lower(line.substr(0, colon))];
+    if (!value.empty()) value += ", ";
+    value += Trim(line.substr(colon + 1));
+  }
+
+  const std::string connection_header = Lower(request->Header("connection"));
+  request->keep_alive = version == "HTTP/1.1"
+                            ? connection_header != "close"
+                            : connection_header == "keep-alive";
+  return true;
+}
+
+bool SafePath(const std::string& path) {
+  return !path.empty() && path[0] == '/' &&
+         (path + "/").find("/../") == std::string::npos &&
+         path.compare(0, sizeof(kUploadsDir) - 1, kUploadsDir) != 0;
+}
+
+// Whether faults may hit request: with --data-faults, only the requests
+// moving file data, which the plug-in retries
+bool Faulty(const Request& request) {
+  return !options.data_faults || request.method == "PUT" ||
+         (request.method == "GET" && !request.Header("range").empty());
+}
+
+void Log(const Request& request, const Response& response, bool reset) {
+  if (!log_file) return;
+  const std::string range = request.Header("range");
+  std::lock_guard<std::mutex> lock(log_mutex);
+  fprintf(log_file, "%s %s%s%s %d %s%s\n", request.method.c_str(),
+          request.raw_path.c_str(), request.raw_query.empty() ? "" : "?",
+          request.raw_query.c_str(), response.status,
+          range.empty() ? "-" : range.c_str(), reset ? " reset" : "");
+  fflush(log_file);
+}
+
+// Sends the answer, or cuts it midway with a reset; false when the
+// connection is done with
+bool Send(Connection& connection, const Request& request,
+          const Response& response, bool reset) {
+  const bool head = request.method == "HEAD";
+  const uint64_t size = response.Size();
+  std::string header = "HTTP/1.1 " + std::to_string(response.status) + " " +
+                       Reason(response.status) + "\r\n";
+  bool has_length = false;
+  for (const auto& field : response.headers) {
+    header += field.first + ": " + field.second + "\r\n";
+    has_length = has_length || field.first == "Content-Length";
+  }
+  header += "Date: " + HttpDate(time(nullptr)) + "\r\n";
+  if (!has_length && response.status != 304 && response.status != 204)
+    header += "Content-Length: " + std::to_string(size) + "\r\n";
+  if (!request.keep_alive) header += "Connection: close\r\n";
+  header += "\r\n";
+
+  connection.StartAnswer();
+  if (!connection.Write(header)) return false;
+  if (head) return request.keep_alive;
+
+  const uint64_t cut = reset ? size / 2 : size;
+  uint64_t sent = 0;
+  std::vector<char> buffer(65536);
+  for (const auto& segment : response.body) {
+    if (!segment.file) {
+      const size_t n = std::min<uint64_t>(segment.text.size(), cut - sent);
+      if (!connection.Write(segment.text.data(), n)) return false;
+      sent += n;
+    }
+    for (uint64_t done = 0; segment.file && done < segment.length &&
+                            sent < cut;) {
+      const size_t wanted = std::min<uint64_t>(
+          {buffer.size(), segment.length - done, cut - sent});
+      const ssize_t n = pread(segment.file->fd, buffer.data(), wanted,
+                              segment.offset + done);
+      if (n <= 0 || !connection.Write(buffer.data(), n)) return false;
+      done += n;
+      sent += n;
+    }
+    if (sent == cut && reset) {
+      connection.Reset();
+      return false;
+    }
+  }
+  return request.keep_alive;
+}
+
+void Serve(int fd) {
+  Connection connection(fd);
+  Request request;
+  while (ReadRequest(connection, &request)) {
+    uint64_t length = 0;
+    const bool chunked =
+        Lower(request.Header("transfer-encoding")).find("chunked") !=
+        std::string::npos;
+    if (!chunked)
+      length = strtoull(request.Header("content-length").c_str(), nullptr, 10);
+    Body body(connection, chunked, length);
+    request.body = &body;
+
+    if (Lower(request.Header("expect")) == "100-continue" &&
+        !connection.Write("HTTP/1.1 100 Continue\r\n\r\n")) {
+      return;
+    }
+
+    Response response;
+    if (!SafePath(request.path)) {
+      body.Discard();
+      response = Status(403);
+    }
+    else if (Faulty(request) && Draw(options.error_percent)) {
+      body.Discard();
+      response = Status(options.error_code);
+    }
+    else {
+      response = Handle(request);
+      if (!body.Discard()) request.keep_alive = false;
+    }
+
+    unsigned delay = options.latency_ms;
+    if (Draw(options.tail_percent)) delay += options.tail_ms;
+    if (delay) std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+
+    const bool reset = Faulty(request) && Draw(options.reset_percent);
+    Log(request, response, reset);
+    if (!Send(connection, request, response, reset)) return;
+  }
+}
+
+void Usage(const char* program) {
+  fprintf(stderr,
+          "Usage: %s --root DIR [--port N] [--pidfile FILE] "
+          "[--s3 ACCESS_KEY:SECRET_KEY]\n"
+          "          [--log FILE] [--replica URL...]\n"
+          "          [--latency MS] [--tail MS:PERCENT] [--bandwidth BYTES]\n"
+          "          [--reset PERCENT] [--error PERCENT[:CODE]] "
+          "[--ignore-range]\n"
+          "          [--data-faults] [--seed N]\n",
+          program);
+  exit(2);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--ignore-range") {
+      options.ignore_range = true;
+      continue;
+    }
+    if (arg == "--data-faults") {
+      options.data_faults = true;
+      continue;
+    }
+    if (i + 1 == argc) Usage(argv[0]);
+    const std::string value = argv[++i];
+    const auto colon = value.find(':');
+    if (arg == "--root") {
+      options.root = value;
+    }
+    else if (arg == "--port") {
+      options.port = atoi(value.c_str());
+    }
+    else if (arg == "--pidfile") {
+      options.pidfile = value;
+    }
+    else if (arg == "--s3" && colon != std::string::npos) {
+      options.s3 = true;
+      options.access_key = value.substr(0, colon);
+      options.secret_key = value.substr(colon + 1);
+    }
+    else if (arg == "--latency") {
+      options.latency_ms = strtoul(value.c_str(), nullptr, 10);
+    }
+    else if (arg == "--tail" && colon != std::string::npos) {
+      options.tail_ms = strtoul(value.c_str(), nullptr, 10);
+      options.tail_percent = atof(value.c_str() + colon + 1);
+    }
+    else if (arg == "--bandwidth") {
+      options.bandwidth = strtoull(value.c_str(), nullptr, 10);
+    }
+    else if (arg == "--reset") {
+      options.reset_percent = atof(value.c_str());
+    }
+    else if (arg == "--error") {
+      options.error_percent = atof(value.c_str());
+      if (colon != std::string::npos)
+        options.error_code = atoi(value.c_str() + colon + 1);
+    }
+    else if (arg == "--replica") {
+      std::string replica = value;
+      while (!replica.empty() && replica.back() == '/') replica.pop_back();
+      options.replicas.push_back(replica);
+    }
+    else if (arg == "--log") {
+      options.log = value;
+    }
+    else if (arg == "--seed") {
+      options.seed = strtoull(value.c_str(), nullptr, 10);
+    }
+    else {
+      Usage(argv[0]);
+    }
+  }
+  while (options.root.size() > 1 && options.root.back() == '/')
+    options.root.pop_back();
+  if (options.root.empty() || !IsDir(options.root)) Usage(argv[0]);
+  random_generator.seed(options.seed);
+  if (options.s3) MakeDirs(options.root + kUploadsDir);
+  if (!options.log.empty() && !(log_file = fopen(options.log.c_str(), "a"))) {
+    perror("Could not open the log");
+    return 1;
+  }
+
+  signal(SIGPIPE, SIG_IGN);
+  const int listener = socket(AF_INET, SOCK_STREAM, 0);
+  const int on = 1;
+  setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(options.port);
+  if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) ||
+      listen(listener, 512)) {
+    perror("Could not listen");
+    return 1;
+  }
+  socklen_t length = sizeof(address);
+  getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length);
+  printf("Listening on 127.0.0.1:%d\n", ntohs(address.sin_port));
+  fflush(stdout);
+
+  if (!options.pidfile.empty()) {
+    if (FILE* file = fopen(options.pidfile.c_str(), "w")) {
+      fprintf(file, "%d\n", int(getpid()));
+      fclose(file);
+    }
+  }
+
+  while (true) {
+    const int fd = accept(listener, nullptr, nullptr);
+    if (fd < 0) continue;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    std::thread(Serve, fd).detach();
+  }
+}
@@ -0,0 +1,30 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+#ifndef __HTTP_UNIT_TEST_
+#define __HTTP_UNIT_TEST_
+
+// Minimal checks for the unit tests: a failed CHECK is reported and counted,
+// and the test's main returns UNIT_TEST_RESULT(), non-zero on failures
+
+#include <cstdio>
+
+namespace {
+
+int unit_test_failures = 0;
+
+}  // namespace
+
+#define CHECK(condition)                                              \
+  do {                                                                \
+    if (!(condition)) {                                               \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, \
+              #condition);                                            \
+      ++unit_test_failures;                                           \
+    }                                                                 \
+  } while (0)
+
+#define UNIT_TEST_RESULT() (unit_test_failures ? 1 : 0)
+
+#endif  // __HTTP_UNIT_TEST_
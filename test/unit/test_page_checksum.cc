@@ -0,0 +1,83 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+// PageChecksums and ParallelPageChecksums against a bitwise CRC32C, for
+// buffers starting and ending off page boundaries
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "XrdSys/XrdSysPageSize.hh"
+
+#include "HttpPageChecksum.hh"
+#include "UnitTest.hh"
+
+using namespace XrdCl;
+
+namespace {
+
+uint32_t Crc32c(const char* data, size_t length) {
+  uint32_t crc = 0xffffffff;
+  for (size_t i = 0; i < length; ++i) {
+    crc ^= static_cast<unsigned char>(data[i]);
+    for (int bit = 0; bit < 8; ++bit)
+      crc = (crc >> 1) ^ (0x82f63b78 & (0 - (crc & 1)));
+  }
+  return ~crc;
+}
+
+// One checksum per file page the buffer touches
+std::vector<uint32_t> Expected(uint64_t offset, const char* data,
+                               size_t length) {
+  std::vector<uint32_t> cksums;
+  while (length > 0) {
+    const size_t page =
+        std::min<size_t>(length, XrdSys::PageSize - offset % XrdSys::PageSize);
+    cksums.push_back(Crc32c(data, page));
+    data += page;
+    offset += page;
+    length -= page;
+  }
+  return cksums;
+}
+
+void Check(uint64_t offset, size_t length, bool parallel) {
+  std::vector<char> data(length);
+  for (size_t i = 0; i < length; ++i) data[i] = char(i * 7 + offset);
+
+  const auto expected = Expected(offset, data.data(), length);
+  CHECK(PageCount(offset, length) == expected.size());
+
+  std::vector<uint32_t> cksums(PageCount(offset, length));
+  if (parallel)
+    ParallelPageChecksums(offset, data.data(), length, cksums.data());
+  else
+    PageChecksums(offset, data.data(), length, cksums.data());
+  CHECK(cksums == expected);
+}
+
+}  // namespace
+
+int main() {
+  const uint64_t page = XrdSys::PageSize;
+
+  CHECK(PageCount(0, 0) == 0);
+  CHECK(PageCount(100, 0) == 0);
+  CHECK(PageCount(0, page) == 1);
+  CHECK(PageCount(page - 1, 2) == 2);
+
+  for (bool parallel : {false, true}) {
+    // Aligned, then starting or ending within a page, or within one page
+    Check(0, 3 * page, parallel);
+    Check(100, 3 * page, parallel);
+    Check(0, 3 * page + 100, parallel);
+    Check(page - 1, 2, parallel);
+    Check(10, 20, parallel);
+    Check(5 * page + 4000, page + 200, parallel);
+  }
+  // Large enough to be split over several threads, misaligned both ends
+  Check(123, 4 * 1024 * 1024 + 7, true);
+  return UNIT_TEST_RESULT();
+}
@@ -0,0 +1,192 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+// HttpRangeReader against synthetic answers: multipart boundaries,
+// overlapping and merged chunks, and parts cut short
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "HttpRangeReader.hh"
+#include "UnitTest.hh"
+
+using namespace XrdCl;
+
+namespace {
+
+const char kBoundary[] = "3d6b6a416f9b5";
+
+struct Answer {
+  explicit Answer(std::string body) : body(std::move(body)), position(0) {}
+
+  std::string body;
+  size_t position;
+
+  int64_t Read(char* buffer, uint64_t size) {
+    size = std::min<uint64_t>(size, body.size() - position);
+    std::memcpy(buffer, body.data() + position, size);
+    position += size;
+    return size;
+  }
+
+  HttpRangeReader::Source Source() {
+    return [this](char* buffer, uint64_t size) { return Read(buffer, size); };
+  }
+};
+
+std::vector<char> Object(size_t size) {
+  std::vector<char> object(size);
+  for (size_t i = 0; i < size; ++i) object[i] = char(i * 131 + i / 7);
+  return object;
+}
+
+std::string Part(const std::vector<char>& object, uint64_t offset,
+                 uint64_t length) {
+  return "\r\n--" + std::string(kBoundary) +
+         "\r\nContent-Type: application/octet-stream\r\n"
+         "Content-Range: bytes " + std::to_string(offset) + "-" +
+         std::to_string(offset + length - 1) + "/" +
+         std::to_string(object.size()) + "\r\n\r\n" +
+         std::string(object.data() + offset, length);
+}
+
+std::string Multipart(const std::vector<char>& object,
+                      const std::vector<std::pair<uint64_t, uint64_t>>& parts) {
+  std::string body = "preamble to be ignored";
+  for (const auto& part : parts)
+    body += Part(object, part.first, part.second);
+  return body + "\r\n--" + kBoundary + "--\r\n";
+}
+
+struct Chunks {
+  std::vector<std::vector<char>> buffers;
+  ChunkList list;
+
+  explicit Chunks(const std::vector<std::pair<uint64_t, uint32_t>>& ranges) {
+    for (const auto& range : ranges)
+      buffers.emplace_back(range.second, '\0');
+    for (size_t i = 0; i < ranges.size(); ++i)
+      list.push_back(
+          ChunkInfo(ranges[i].first, ranges[i].second, buffers[i].data()));
+  }
+
+  bool Match(const std::vector<char>& object) const {
+    for (const auto& chunk : list) {
+      if (std::memcmp(chunk.buffer, object.data() + chunk.offset,
+                      chunk.length))
+        return false;
+    }
+    return true;
+  }
+};
+
+void TestMultipartOutOfOrder() {
+  const auto object = Object(100000);
+  Chunks chunks({{50000, 1000}, {10, 20}, {90000, 9999}});
+  Answer answer(Multipart(object, {{90000, 9999}, {10, 20}, {50000, 1000}}));
+  HttpRangeReader reader(chunks.list);
+  CHECK(reader.ReadMultipart(kBoundary, answer.Source()).IsOK());
+  CHECK(reader.Complete());
+  CHECK(chunks.Match(object));
+  CHECK(reader.BytesCopied() == 0);
+  CHECK(reader.BytesDiscarded() == 0);
+}
+
+void TestBoundaryInData() {
+  // Part data that looks like a delimiter is read as data: parts are read
+  // by their Content-Range length, not scanned for the boundary
+  std::vector<char> object(4096, 'x');
+  const std::string fake = "\r\n--" + std::string(kBoundary) + "--\r\n";
+  std::copy(fake.begin(), fake.end(), object.begin() + 100);
+  Chunks chunks({{0, 4096}});
+  Answer answer(Multipart(object, {{0, 2048}, {2048, 2048}}));
+  HttpRangeReader reader(chunks.list);
+  CHECK(reader.ReadMultipart(kBoundary, answer.Source()).IsOK());
+  CHECK(reader.Complete());
+  CHECK(chunks.Match(object));
+}
+
+void TestOverlappingChunks() {
+  const auto object = Object(10000);
+  // The second chunk lies within the first, the third overlaps its end
+  Chunks chunks({{1000, 2000}, {1500, 100}, {2900, 600}});
+  Answer answer(Multipart(object, {{1000, 2500}}));
+  HttpRangeReader reader(chunks.list);
+  CHECK(reader.ReadMultipart(kBoundary, answer.Source()).IsOK());
+  CHECK(reader.Complete());
+  CHECK(chunks.Match(object));
+  CHECK(reader.BytesCopied() == 100 + 100);
+}
+
+void TestMergedGap() {
+  const auto object = Object(10000);
+  Chunks chunks({{100, 10}, {5000, 10}});
+  Answer answer(Multipart(object, {{100, 4910}}));
+  HttpRangeReader reader(chunks.list);
+  CHECK(reader.ReadMultipart(kBoundary, answer.Source()).IsOK());
+  CHECK(reader.Complete());
+  CHECK(chunks.Match(object));
+  CHECK(reader.BytesDiscarded() == 4890);
+}
+
+void TestSinglePart() {
+  // A server coalescing all ranges into one 206, or ignoring Range
+  const auto object = Object(10000);
+  Chunks chunks({{0, 10}, {9990, 10}});
+  Answer answer(std::string(object.begin(), object.end()));
+  HttpRangeReader reader(chunks.list);
+  CHECK(reader.ReadPart(0, object.size(), answer.Source()).IsOK());
+  CHECK(reader.Complete());
+  CHECK(chunks.Match(object));
+}
+
+void TestTruncatedPart() {
+  const auto object = Object(10000);
+  Chunks chunks({{0, 1000}, {5000, 1000}});
+  auto body = Multipart(object, {{0, 1000}, {5000, 1000}});
+  // Connection lost in the middle of the second part's data
+  body.resize(body.size() - 500);
+  Answer answer(body);
+  HttpRangeReader reader(chunks.list);
+  CHECK(reader.ReadMultipart(kBoundary, answer.Source()).IsError());
+  CHECK(!reader.Complete());
+}
+
+void TestMissingPart() {
+  // A well-formed answer leaving out a requested range
+  const auto object = Object(10000);
+  Chunks chunks({{0, 1000}, {5000, 1000}});
+  Answer answer(Multipart(object, {{0, 1000}}));
+  HttpRangeReader reader(chunks.list);
+  CHECK(reader.ReadMultipart(kBoundary, answer.Source()).IsOK());
+  CHECK(!reader.Complete());
+}
+
+void TestPartWithoutContentRange() {
+  const auto object = Object(100);
+  Chunks chunks({{0, 10}});
+  Answer answer("\r\n--" + std::string(kBoundary) +
+                "\r\nContent-Type: application/octet-stream\r\n\r\n" +
+                std::string(object.data(), 10) + "\r\n--" + kBoundary +
+                "--\r\n");
+  HttpRangeReader reader(chunks.list);
+  CHECK(reader.ReadMultipart(kBoundary, answer.Source()).IsError());
+}
+
+}  // namespace
+
+int main() {
+  TestMultipartOutOfOrder();
+  TestBoundaryInData();
+  TestOverlappingChunks();
+  TestMergedGap();
+  TestSinglePart();
+  TestTruncatedPart();
+  TestMissingPart();
+  TestPartWithoutContentRange();
+  return UNIT_TEST_RESULT();
+}
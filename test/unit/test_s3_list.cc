@@ -0,0 +1,78 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+// ParseS3ListPage on ListObjectsV2 documents: keys, prefixes and tokens
+// with XML character references
+
+#include <string>
+
+#include "HttpS3List.hh"
+#include "UnitTest.hh"
+
+using namespace XrdCl;
+
+namespace {
+
+void TestPage() {
+  const std::string xml =
+      "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+      "<ListBucketResult xmlns=\"http://s3.amazonaws.com/doc/2006-03-01/\">"
+      "<Name>bucket</Name><Prefix>dir/</Prefix><KeyCount>2</KeyCount>"
+      "<IsTruncated>true</IsTruncated>"
+      "<Contents><Key>dir/a&amp;b &lt;1&gt;.txt</Key>"
+      "<LastModified>2009-10-12T17:50:30.000Z</LastModified>"
+      "<ETag>&quot;fba9dede5f27731c9771645a39863328&quot;</ETag>"
+      "<Size>434234</Size></Contents>"
+      "<Contents><Key>dir/&quot;q&quot; &apos;s&apos;&#x9;&#13;</Key>"
+      "<Size>0</Size></Contents>"
+      "<CommonPrefixes><Prefix>dir/sub&amp;dir/</Prefix></CommonPrefixes>"
+      "<NextContinuationToken>1ueGcxLPRx1Tr/XYExHnhbYLgveDs2J/wm36Hy4vbOwM="
+      "&amp;x</NextContinuationToken>"
+      "</ListBucketResult>";
+
+  S3ListPage page;
+  CHECK(ParseS3ListPage(xml, &page));
+  CHECK(page.objects.size() == 2);
+  if (page.objects.size() == 2) {
+    CHECK(page.objects[0].key == "dir/a&b <1>.txt");
+    CHECK(page.objects[0].size == 434234);
+    CHECK(page.objects[0].mtime == 1255369830);
+    CHECK(page.objects[1].key == "dir/\"q\" 's'\t\r");
+    CHECK(page.objects[1].size == 0);
+    CHECK(page.objects[1].mtime == 0);
+  }
+  CHECK(page.prefixes.size() == 1);
+  if (page.prefixes.size() == 1) CHECK(page.prefixes[0] == "dir/sub&dir/");
+  CHECK(page.truncated);
+  CHECK(page.next_token ==
+        "1ueGcxLPRx1Tr/XYExHnhbYLgveDs2J/wm36Hy4vbOwM=&x");
+}
+
+void TestUnknownEntities() {
+  // Not a reference S3 emits: kept as it is
+  const std::string xml =
+      "<ListBucketResult><IsTruncated>false</IsTruncated>"
+      "<Contents><Key>a&nbsp;b&</Key><Size>1</Size></Contents>"
+      "</ListBucketResult>";
+  S3ListPage page;
+  CHECK(ParseS3ListPage(xml, &page));
+  CHECK(page.objects.size() == 1);
+  if (page.objects.size() == 1) CHECK(page.objects[0].key == "a&nbsp;b&");
+  CHECK(!page.truncated);
+  CHECK(page.next_token.empty());
+}
+
+void TestNotAListing() {
+  S3ListPage page;
+  CHECK(!ParseS3ListPage("<Error><Code>NoSuchBucket</Code></Error>", &page));
+}
+
+}  // namespace
+
+int main() {
+  TestPage();
+  TestUnknownEntities();
+  TestNotAListing();
+  return UNIT_TEST_RESULT();
+}
@@ -0,0 +1,100 @@
+/**
+ * This file is part of XrdClHttp
+ */
+
+// HttpVectorPlanner: merging by gap and overlap, and splitting into
+// requests whose Range headers fit the budget
+
+#include <cstdlib>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "HttpVectorPlanner.hh"
+#include "UnitTest.hh"
+
+using namespace XrdCl;
+
+namespace {
+
+// Same budget as the planner's
+const size_t kMaxRangeHeader = 4000;
+
+std::string RangeHeader(const HttpVectorPlanner::Batch& batch) {
+  std::string header = "bytes=";
+  for (const auto& range : batch) {
+    if (header.size() > 6) header += ",";
+    header += std::to_string(range.offset) + "-" +
+              std::to_string(range.offset + range.length - 1);
+  }
+  return header;
+}
+
+// Every chunk planned exactly once, within the range listing it
+bool Covers(const ChunkList& chunks,
+            const std::vector<HttpVectorPlanner::Batch>& batches) {
+  std::multiset<size_t> planned;
+  for (const auto& batch : batches) {
+    for (const auto& range : batch) {
+      for (auto index : range.chunks) {
+        const auto& chunk = chunks[index];
+        if (chunk.offset < range.offset ||
+            chunk.offset + chunk.length > range.offset + range.length)
+          return false;
+        planned.insert(index);
+      }
+    }
+  }
+  if (planned.size() != chunks.size()) return false;
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    if (planned.count(i) != 1) return false;
+  }
+  return true;
+}
+
+void TestHeaderBudget() {
+  // Far apart chunks with long offsets: thousands of ranges, which can't
+  // go into one request
+  ChunkList chunks;
+  for (uint64_t i = 0; i < 5000; ++i) {
+    chunks.push_back(ChunkInfo(1000000000000ULL + i * 1000000, 100, nullptr));
+  }
+  auto batches = HttpVectorPlanner::Instance().Plan(chunks);
+  CHECK(batches.size() > 1);
+  size_t ranges = 0;
+  for (const auto& batch : batches) {
+    CHECK(!batch.empty());
+    CHECK(RangeHeader(batch).size() - 6 <= kMaxRangeHeader);
+    ranges += batch.size();
+  }
+  CHECK(ranges == chunks.size());
+  CHECK(Covers(chunks, batches));
+}
+
+void TestMerging() {
+  // Unsorted; the first two overlap, the third is right after them
+  ChunkList chunks{ChunkInfo(5000, 100, nullptr), ChunkInfo(0, 200, nullptr),
+                   ChunkInfo(150, 100, nullptr), ChunkInfo(250, 10, nullptr)};
+  auto batches = HttpVectorPlanner::Instance().Plan(chunks);
+  CHECK(Covers(chunks, batches));
+  size_t ranges = 0;
+  for (const auto& batch : batches) {
+    for (const auto& range : batch) {
+      ++ranges;
+      if (range.offset == 0) CHECK(range.length == 260);
+    }
+  }
+  CHECK(ranges == 2);
+}
+
+}  // namespace
+
+int main() {
+  // Gaps are never read, and batches are only split by the header budget
+  setenv(HTTP_PLUG_IN_VECTOR_GAP_ENV, "0", 1);
+  setenv(HTTP_PLUG_IN_VECTOR_FANOUT_ENV, "1", 1);
+
+  TestHeaderBudget();
+  TestMerging();
+  return UNIT_TEST_RESULT();
+}